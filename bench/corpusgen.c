@@ -0,0 +1,400 @@
+/*
+ * corpusgen.c - a C script to generate a synthetic page directory for benchmarking the indexer
+ * it writes numDocs pages to pageDirectory in the format of the crawler (see pagedir_save),
+ * with a .crawler file, so the indexer and querier accept it like a crawled directory
+ *
+ *
+ * Usage: ./corpusgen [-s seed] [-w words] [-v vocabulary] [-z exponent] pageDirectory numDocs
+ * where pageDirectory is an (existing) directory to write the pages into
+ * numDocs is the number of pages to write, docIDs 1 to numDocs
+ * -s seeds the random number generator (default 1), so the same arguments give the same pages
+ * -w is the average number of words of text in a page (default 300); each page has between
+ * half and one and a half times as many
+ * -v is the number of distinct words (default 50000)
+ * -z is the exponent of the Zipf distribution the words are drawn from (default 1.0): the word
+ * of rank r occurs in proportion to 1 / r^exponent, as words do in natural text
+ *
+ * Each page is HTML with a head and title, a navigation bar of links to other pages, headings,
+ * paragraphs with some bold and linked words, and the occasional list; the words are made-up
+ * lowercase words of two or more syllables (so all of them are indexed)
+ *
+ * Exit with 0 means succesful
+ * Exit with 1 means wrong number of inputs
+ * Exit with 2 means wrong type of inputs or inputs out of range
+ * Exit with 3 means a page could not be written
+ *
+ * Cooper LaPorte, March 2023
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+#include "mem.h"
+#include "webpage.h"
+#include "pagedir.h"
+
+
+
+/**************** file-local constants ****************/
+static const char CONSONANTS[] = "bcdfghjklmnprstvwz";
+static const char VOWELS[] = "aeiou";
+static const char* SITE = "http://bench.tse/pages/";   // the URLs of the pages are SITE docID.html
+
+
+/**************** local types ****************/
+/* genopts: the options given before the arguments */
+typedef struct genopts {
+    uint64_t seed;      // seed of the random numbers (-s)
+    int words;          // average words of text per page (-w)
+    int vocabulary;     // number of distinct words (-v)
+    double exponent;    // exponent of the Zipf distribution (-z)
+} genopts_t;
+
+/* corpus: what is needed to make pages */
+typedef struct corpus {
+    char** words;       // words[rank], the word of each rank
+    double* cdf;        // cdf[rank], the chance of a word of that rank or lower
+    int vocabulary;
+    int numDocs;
+    uint64_t state;     // of the random number generator
+} corpus_t;
+
+/* htmlbuf: a growing string of HTML */
+typedef struct htmlbuf {
+    char* text;
+    size_t len;
+    size_t cap;
+} htmlbuf_t;
+
+
+static int parseOpts(const int argc, char* argv[], genopts_t* opts);
+static void parseArgs(char* argv[], char** pageDirectory, int* numDocs);
+static void corpusInit(corpus_t* corpus, genopts_t* opts, const int numDocs);
+static char* makeWord(int rank);
+static char* makePage(corpus_t* corpus, const int docID, const int numWords);
+static const char* randomWord(corpus_t* corpus);
+static int randomDoc(corpus_t* corpus);
+static uint64_t randomNext(corpus_t* corpus);
+static double randomUniform(corpus_t* corpus);
+static void html_add(htmlbuf_t* buf, const char* text);
+static void html_addLink(htmlbuf_t* buf, const int docID, const char* text);
+
+/* ***************** main ********************** */
+
+int
+main(const int argc, char* argv[])
+{
+genopts_t opts = { 1, 300, 50000, 1.0 };
+int arg = parseOpts(argc, argv, &opts); // index of the first argument after the options
+if (argc - arg == 2){
+    // two arguments
+    char* pageDirectory = NULL;
+    int numDocs = 0;
+    parseArgs(&argv[arg], &pageDirectory, &numDocs);
+    corpus_t corpus;
+    corpusInit(&corpus, &opts, numDocs);
+    for(int docID = 1; docID <= numDocs; docID++){
+      int numWords = opts.words / 2 + randomNext(&corpus) % (opts.words + 1);
+      char* url = mem_malloc_assert(strlen(SITE) + 20, "Error allocating memory");
+      sprintf(url, "%s%d.html", SITE, docID);
+      int depth = docID == 1 ? 0 : 1 + randomNext(&corpus) % 3;
+      webpage_t* page = mem_assert(webpage_new(url, depth, makePage(&corpus, docID, numWords)), "Error allocating memory");
+      if(!pagedir_save(page, pageDirectory, docID)){
+        exit(3);
+      }
+      webpage_delete(page); // frees the url and the HTML
+    }
+    for(int rank = 0; rank < corpus.vocabulary; rank++){
+      mem_free(corpus.words[rank]);
+    }
+    mem_free(corpus.words);
+    mem_free(corpus.cdf);
+  } else{
+    // too few or many arguments
+    fprintf(stderr,"*** need to pass exactly two arguments\n");
+    exit(1);
+  }
+exit(0);
+}
+
+
+
+/* ****************** parseOpts ********************** */
+/*
+ * Takes the options at the front of the arguments given to corpusgen.c and checks them
+ * returns the index in argv of the first argument that is not an option
+ */
+
+static int
+parseOpts(const int argc, char* argv[], genopts_t* opts){
+  int arg = 1;
+  while(arg < argc && argv[arg][0] == '-'){
+    if(arg + 1 >= argc){
+      fprintf(stderr,"*** option %s needs a value\n", argv[arg]);
+      exit(2);
+    }
+    char* end;
+    if(strcmp(argv[arg], "-s") == 0){
+      opts->seed = strtoull(argv[arg + 1], &end, 10);
+    } else if(strcmp(argv[arg], "-w") == 0){
+      long words = strtol(argv[arg + 1], &end, 10);
+      if(words < 1 || words > 1000000){
+        end = argv[arg + 1];
+      }
+      opts->words = words;
+    } else if(strcmp(argv[arg], "-v") == 0){
+      long vocabulary = strtol(argv[arg + 1], &end, 10);
+      if(vocabulary < 1 || vocabulary > 100000000){
+        end = argv[arg + 1];
+      }
+      opts->vocabulary = vocabulary;
+    } else if(strcmp(argv[arg], "-z") == 0){
+      opts->exponent = strtod(argv[arg + 1], &end);
+      if(opts->exponent < 0 || opts->exponent > 10){
+        end = argv[arg + 1];
+      }
+    } else{
+      fprintf(stderr,"*** unknown option %s\n", argv[arg]);
+      exit(2);
+    }
+    if(end == argv[arg + 1] || *end != '\0'){
+      fprintf(stderr,"*** bad value %s for option %s\n", argv[arg + 1], argv[arg]);
+      exit(2);
+    }
+    arg += 2;
+  }
+  return arg;
+}
+
+
+
+/* ****************** parseArgs ********************** */
+/*
+ * Takes the two arguments given to corpusgen.c (after any options) and checks them
+ * marks the pageDirectory as a crawler directory (writes its .crawler file)
+ * and makes sure numDocs is a positive number
+ */
+
+static void
+parseArgs(char* argv[], char** pageDirectory, int* numDocs){
+  char* end;
+  long n = strtol(argv[1], &end, 10);
+  if(end == argv[1] || *end != '\0' || n < 1 || n > 100000000){
+    fprintf(stderr,"*** numDocs must be a number from 1 to 100000000\n");
+    exit(2);
+  }
+  *numDocs = n;
+  *pageDirectory = argv[0];
+  if(!pagedir_init(*pageDirectory)){
+    fprintf(stderr,"*** need to pass an existing, writable directory\n");
+    exit(2);
+  }
+}
+
+
+
+/* ****************** corpusInit ********************** */
+/*
+ * Makes the words of the vocabulary and the cumulative Zipf distribution over them
+ */
+
+static void
+corpusInit(corpus_t* corpus, genopts_t* opts, const int numDocs){
+  corpus->vocabulary = opts->vocabulary;
+  corpus->numDocs = numDocs;
+  corpus->state = opts->seed * 2685821657736338717ULL + 1;
+  if(corpus->state == 0){ // xorshift never leaves 0
+    corpus->state = 1;
+  }
+  corpus->words = mem_malloc_assert(corpus->vocabulary * sizeof(char*), "Error allocating memory");
+  corpus->cdf = mem_malloc_assert(corpus->vocabulary * sizeof(double), "Error allocating memory");
+  double sum = 0;
+  for(int rank = 0; rank < corpus->vocabulary; rank++){
+    corpus->words[rank] = makeWord(rank);
+    sum += 1 / pow(rank + 1, opts->exponent);
+    corpus->cdf[rank] = sum;
+  }
+  for(int rank = 0; rank < corpus->vocabulary; rank++){
+    corpus->cdf[rank] /= sum;
+  }
+}
+
+
+
+/* ****************** makeWord ********************** */
+/*
+ * Returns the made-up word of a rank: the digits of rank + 90 in base 90, each a syllable of
+ * a consonant and a vowel, so every rank has its own word of at least two syllables
+ */
+
+static char*
+makeWord(int rank){
+  const int consonants = strlen(CONSONANTS);
+  const int vowels = strlen(VOWELS);
+  const int syllables = consonants * vowels;
+  char* word = mem_malloc_assert(32, "Error allocating memory");
+  int len = 0;
+  for(int n = rank + syllables; n > 0; n /= syllables){
+    word[len++] = CONSONANTS[(n % syllables) / vowels];
+    word[len++] = VOWELS[(n % syllables) % vowels];
+  }
+  word[len] = '\0';
+  return word;
+}
+
+
+
+/* ****************** makePage ********************** */
+/*
+ * Returns the HTML of a page with numWords words of text, which the caller must free
+ */
+
+static char*
+makePage(corpus_t* corpus, const int docID, const int numWords){
+  htmlbuf_t buf = { NULL, 0, 0 };
+  char line[64];
+  html_add(&buf, "<!DOCTYPE html>\n<html lang=\"en\">\n<head>\n<meta charset=\"utf-8\">\n<title>");
+  int words = 0;
+  for(int i = 0; i < 3; i++, words++){
+    html_add(&buf, i == 0 ? "" : " ");
+    html_add(&buf, randomWord(corpus));
+  }
+  html_add(&buf, "</title>\n<link rel=\"stylesheet\" href=\"/style.css\">\n</head>\n<body>\n<div class=\"nav\">\n");
+  for(int i = 0; i < 5; i++, words++){
+    html_addLink(&buf, randomDoc(corpus), randomWord(corpus));
+  }
+  sprintf(line, "</div>\n<div class=\"content\" id=\"page-%d\">\n", docID);
+  html_add(&buf, line);
+  while(words < numWords){
+    // a heading, then a paragraph (or sometimes a list) of 20 to 80 words
+    html_add(&buf, "<h2>");
+    for(int i = 0; i < 2 && words < numWords; i++, words++){
+      html_add(&buf, i == 0 ? "" : " ");
+      html_add(&buf, randomWord(corpus));
+    }
+    html_add(&buf, "</h2>\n");
+    bool list = randomNext(corpus) % 8 == 0;
+    html_add(&buf, list ? "<ul>\n<li>" : "<p>");
+    int length = 20 + randomNext(corpus) % 61;
+    for(int i = 0; i < length && words < numWords; i++, words++){
+      int r = randomNext(corpus) % 40;
+      if(i > 0){
+        html_add(&buf, list && i % 6 == 0 ? "</li>\n<li>" : (r == 0 ? ", " : " "));
+      }
+      if(r == 1){
+        html_add(&buf, "<b>");
+        html_add(&buf, randomWord(corpus));
+        html_add(&buf, "</b>");
+      } else if(r == 2){
+        html_addLink(&buf, randomDoc(corpus), randomWord(corpus));
+      } else{
+        html_add(&buf, randomWord(corpus));
+      }
+    }
+    html_add(&buf, list ? "</li>\n</ul>\n" : ".</p>\n");
+  }
+  html_add(&buf, "</div>\n<div class=\"footer\">&copy; bench.tse</div>\n</body>\n</html>\n");
+  return buf.text;
+}
+
+
+
+/* ****************** randomWord ********************** */
+/*
+ * Returns a word drawn from the Zipf distribution (binary search of the cdf)
+ */
+
+static const char*
+randomWord(corpus_t* corpus){
+  double u = randomUniform(corpus);
+  int lo = 0;
+  int hi = corpus->vocabulary - 1;
+  while(lo < hi){
+    int mid = (lo + hi) / 2;
+    if(corpus->cdf[mid] < u){
+      lo = mid + 1;
+    } else{
+      hi = mid;
+    }
+  }
+  return corpus->words[lo];
+}
+
+
+
+/* ****************** randomDoc ********************** */
+/*
+ * Returns a docID of the corpus to link to
+ */
+
+static int
+randomDoc(corpus_t* corpus){
+  return 1 + randomNext(corpus) % corpus->numDocs;
+}
+
+
+
+/* ****************** randomNext ********************** */
+/*
+ * Returns the next random number (xorshift64*), the same on every platform for a seed
+ */
+
+static uint64_t
+randomNext(corpus_t* corpus){
+  corpus->state ^= corpus->state >> 12;
+  corpus->state ^= corpus->state << 25;
+  corpus->state ^= corpus->state >> 27;
+  return (corpus->state * 2685821657736338717ULL) >> 11;
+}
+
+
+
+/* ****************** randomUniform ********************** */
+/*
+ * Returns a random number in [0, 1)
+ */
+
+static double
+randomUniform(corpus_t* corpus){
+  return randomNext(corpus) / 9007199254740992.0; // 2^53
+}
+
+
+
+/* ****************** html_add ********************** */
+/*
+ * Helper function to append text to the HTML
+ */
+
+static void
+html_add(htmlbuf_t* buf, const char* text){
+  size_t len = strlen(text);
+  if(buf->len + len + 1 > buf->cap){
+    buf->cap = buf->cap == 0 ? 4096 : buf->cap;
+    while(buf->len + len + 1 > buf->cap){
+      buf->cap *= 2;
+    }
+    buf->text = mem_assert(realloc(buf->text, buf->cap), "Error allocating memory");
+  }
+  memcpy(buf->text + buf->len, text, len + 1);
+  buf->len += len;
+}
+
+
+
+/* ****************** html_addLink ********************** */
+/*
+ * Helper function to append a link to a page of the corpus, with text
+ */
+
+static void
+html_addLink(htmlbuf_t* buf, const int docID, const char* text){
+  char link[96];
+  sprintf(link, "<a href=\"%s%d.html\">", SITE, docID);
+  html_add(buf, link);
+  html_add(buf, text);
+  html_add(buf, "</a>\n");
+}
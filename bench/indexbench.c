@@ -0,0 +1,189 @@
+/*
+ * indexbench.c - a C script to run the indexer on a page directory and report how fast it was
+ * it runs the given indexer command line as a child process and prints the number of pages,
+ * the size of the page directory, the time taken, pages per second, MB of pages per second,
+ * the peak resident memory of the indexer, and the size of the index it wrote (with its
+ * dictionary, tables and other files beside it)
+ *
+ *
+ * Usage: ./indexbench indexer [options] pageDirectory indexFilename
+ * where indexer [options] pageDirectory indexFilename is the command line of the indexer,
+ * e.g. ./indexbench ../indexer/indexer -m 64 ../data/bench/corpus ../data/bench/index
+ * (the last two arguments must be the page directory and the index, as the indexer takes them)
+ *
+ * Exit with 0 means succesful
+ * Exit with 1 means wrong number of inputs
+ * Exit with 2 means wrong type of inputs or inputs out of range
+ * Exit with 3 means the indexer could not be run or failed
+ *
+ * Cooper LaPorte, March 2023
+ */
+
+#define _POSIX_C_SOURCE 200809L   // fork, execv, clock_gettime
+#define _DEFAULT_SOURCE           // wait4
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <libgen.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "mem.h"
+#include "pagedir.h"
+
+
+
+/**************** local types ****************/
+/* pagestats: the size of the page directory */
+typedef struct pagestats {
+    int numDocs;
+    long long bytes;
+} pagestats_t;
+
+
+static pagestats_t pageStats(const char* pageDirectory);
+static long long indexSize(const char* indexFilename);
+static long long fileSize(const char* path);
+
+/* ***************** main ********************** */
+
+int
+main(const int argc, char* argv[])
+{
+if (argc >= 4){
+    const char* pageDirectory = argv[argc - 2];
+    const char* indexFilename = argv[argc - 1];
+    if(!pagedir_hasCrawler(pageDirectory)){
+      fprintf(stderr,"*** need to pass a valid path to a directory created by crawler (or corpusgen)\n");
+      exit(2);
+    }
+    pagestats_t pages = pageStats(pageDirectory);
+
+    struct timespec start;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    fflush(stdout);
+    pid_t pid = fork();
+    if(pid == 0){ // child: become the indexer
+      execv(argv[1], &argv[1]);
+      fprintf(stderr,"*** could not run %s\n", argv[1]);
+      _exit(127);
+    } else if(pid < 0){
+      fprintf(stderr,"*** could not start the indexer\n");
+      exit(3);
+    }
+    int status;
+    struct rusage usage;
+    if(wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0){
+      fprintf(stderr,"*** the indexer failed\n");
+      exit(3);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    double megabytes = pages.bytes / 1e6;
+
+    printf("indexer:     ");
+    for(int arg = 1; arg < argc; arg++){
+      printf("%s%s", arg == 1 ? "" : " ", argv[arg]);
+    }
+    printf("\n");
+    printf("pages:       %d (%.1f MB)\n", pages.numDocs, megabytes);
+    printf("time:        %.2f s (user %.2f s, system %.2f s)\n", seconds,
+           usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6,
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6);
+    printf("docs/s:      %.0f\n", seconds > 0 ? pages.numDocs / seconds : 0);
+    printf("MB/s:        %.2f\n", seconds > 0 ? megabytes / seconds : 0);
+    printf("peak RSS:    %.1f MB\n", usage.ru_maxrss / 1024.0); // ru_maxrss is in kilobytes
+    printf("index size:  %.1f MB (index %.1f MB)\n", indexSize(indexFilename) / 1e6,
+           fileSize(indexFilename) / 1e6);
+  } else{
+    // too few arguments
+    fprintf(stderr,"*** need to pass an indexer command line: indexer [options] pageDirectory indexFilename\n");
+    exit(1);
+  }
+exit(0);
+}
+
+
+
+/* ****************** pageStats ********************** */
+/*
+ * Counts the pages of pageDirectory (files 1, 2, ... until one is missing) and adds up their sizes
+ */
+
+static pagestats_t
+pageStats(const char* pageDirectory){
+  pagestats_t pages = { 0, 0 };
+  char* path = mem_malloc_assert(strlen(pageDirectory) + 12, "Error allocating memory"); // room for '/', the digits of docID, and '\0'
+  struct stat st;
+  while(true){
+    sprintf(path, "%s/%d", pageDirectory, pages.numDocs + 1);
+    if(stat(path, &st) != 0){
+      break;
+    }
+    pages.numDocs++;
+    pages.bytes += st.st_size;
+  }
+  mem_free(path);
+  return pages;
+}
+
+
+
+/* ****************** indexSize ********************** */
+/*
+ * Returns the size of the index: indexFilename and every file beside it named
+ * indexFilename.something, or every file in it for an index directory
+ */
+
+static long long
+indexSize(const char* indexFilename){
+  struct stat st;
+  bool isDir = stat(indexFilename, &st) == 0 && S_ISDIR(st.st_mode);
+  char* copy = mem_malloc_assert(strlen(indexFilename) + 1, "Error allocating memory");
+  strcpy(copy, indexFilename);
+  const char* dir = isDir ? indexFilename : dirname(copy);
+  char* copy2 = mem_malloc_assert(strlen(indexFilename) + 1, "Error allocating memory");
+  strcpy(copy2, indexFilename);
+  const char* base = basename(copy2);
+  long long total = 0;
+  DIR* dp = opendir(dir);
+  struct dirent* entry;
+  while(dp != NULL && (entry = readdir(dp)) != NULL){
+    size_t len = strlen(base);
+    if(isDir || strcmp(entry->d_name, base) == 0
+       || (strncmp(entry->d_name, base, len) == 0 && entry->d_name[len] == '.')){
+      char* path = mem_malloc_assert(strlen(dir) + strlen(entry->d_name) + 2, "Error allocating memory");
+      sprintf(path, "%s/%s", dir, entry->d_name);
+      if(stat(path, &st) == 0 && S_ISREG(st.st_mode)){
+        total += st.st_size;
+      }
+      mem_free(path);
+    }
+  }
+  if(dp != NULL){
+    closedir(dp);
+  }
+  mem_free(copy);
+  mem_free(copy2);
+  return total;
+}
+
+
+
+/* ****************** fileSize ********************** */
+/*
+ * Returns the size of a file, or 0 if it is not a file
+ */
+
+static long long
+fileSize(const char* path){
+  struct stat st;
+  return stat(path, &st) == 0 && S_ISREG(st.st_mode) ? st.st_size : 0;
+}
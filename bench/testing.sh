@@ -0,0 +1,40 @@
+#!/bin/bash
+#
+# testing.sh - testing the corpus generator and the indexer benchmark
+#
+# Cooper LaPorte, March 2023
+
+mkdir -p ../data
+
+# First, a sequence of invocations with erroneous arguments, testing each of the possible mistakes that can be made.
+### Calling corpusgen with too few arguments
+./corpusgen ../data/gen
+
+### Calling corpusgen with a number of pages that is not a positive number
+mkdir -p ../data/gen
+./corpusgen ../data/gen zero
+./corpusgen ../data/gen 0
+
+### Calling corpusgen with an unknown option, and an option with a bad value
+./corpusgen -x 3 ../data/gen 10
+./corpusgen -w many ../data/gen 10
+
+### Calling indexbench with too few arguments, and on a directory without a .crawler file
+./indexbench ../indexer/indexer ../data/gen
+./indexbench ../indexer/indexer ../data ../data/genindex
+
+
+
+# Second, runs with valid arguments.
+### Generating 100 pages twice with the same seed
+### (The two directories should be the same)
+mkdir -p ../data/gen2
+./corpusgen -s 7 -w 50 ../data/gen 100
+./corpusgen -s 7 -w 50 ../data/gen2 100
+diff -r ../data/gen ../data/gen2 && echo "same pages"
+
+### Running the benchmark on the 100 pages, then with a memory budget
+### (Both indexes should be the same)
+./indexbench ../indexer/indexer ../data/gen ../data/genindex
+./indexbench ../indexer/indexer -m 1 ../data/gen ../data/genindexm
+cmp ../data/genindex ../data/genindexm && echo "same index"
@@ -0,0 +1,254 @@
+/*
+ * bm25.c - CS50 'bm25' module
+ *
+ * see bm25.h for more information.
+ *
+ * Cooper LaPorte, March 2023
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include "mem.h"
+#include "postings.h"
+#include "termindex.h"
+#include "docs.h"
+#include "bm25.h"
+
+
+/**************** file-local constants ****************/
+static const double K1 = 1.2;   // how quickly repeats of a word stop adding to the score
+static const double B = 0.75;   // how much the document length normalizes the score
+
+
+/**************** local types ****************/
+struct bm25 {
+  termindex_t* terms;
+  double* idfs;        // idfs[ordinal], the idf of the word
+  double* norms;       // norms[docID], the length norm of the document
+  double minNorm;      // the smallest norm of any document
+  int maxDoc;
+  int numDocs;
+};
+
+/* the state of bm25_accumulate while it walks one postings list */
+typedef struct bm25acc {
+  bm25_t* bm;
+  double idf;
+  double* scores;
+  int* hits;
+} bm25acc_t;
+
+
+static void bm25_idf_helper(void* arg, const int ordinal, const char* word, postings_t* postings);
+static void bm25_accumulate_helper(void* arg, const int key, const int count);
+
+
+/**************** bm25_new ****************/
+/* see bm25.h for description */
+
+bm25_t*
+bm25_new(termindex_t* terms, docs_t* docs){
+  if(terms == NULL || docs == NULL){
+    return NULL;
+  }
+  bm25_t* bm = mem_malloc_assert(sizeof(bm25_t), "Error allocating memory");
+  bm->maxDoc = docs_maxDoc(docs);
+  bm->numDocs = docs_numDocs(docs);
+  bm->norms = mem_malloc_assert((bm->maxDoc + 1) * sizeof(double), "Error allocating memory");
+  double avgLength = docs_avgLength(docs);
+  for(int docID = 0; docID <= bm->maxDoc; docID++){
+    double ratio = avgLength > 0 ? docs_length(docs, docID) / avgLength : 1;
+    bm->norms[docID] = K1 * (1 - B + B * ratio);
+  }
+  bm->minNorm = -1;   // over the documents with words, the only ones in postings
+  for(int docID = 1; docID <= bm->maxDoc; docID++){
+    if(docs_length(docs, docID) > 0 && (bm->minNorm < 0 || bm->norms[docID] < bm->minNorm)){
+      bm->minNorm = bm->norms[docID];
+    }
+  }
+  if(bm->minNorm < 0){
+    bm->minNorm = K1 * (1 - B);
+  }
+  bm->terms = terms;
+  bm->idfs = mem_malloc_assert((termindex_numTerms(terms) + 1) * sizeof(double), "Error allocating memory");
+  termindex_iterate(terms, bm, bm25_idf_helper);
+  return bm;
+}
+
+
+/**************** bm25_maxDoc ****************/
+/* see bm25.h for description */
+
+int
+bm25_maxDoc(bm25_t* bm){
+  return bm == NULL ? 0 : bm->maxDoc;
+}
+
+
+/**************** bm25_dfFilename ****************/
+/* see bm25.h for description */
+
+char*
+bm25_dfFilename(const char* indexFilename){
+  if(indexFilename == NULL){
+    return NULL;
+  }
+  char* file = mem_malloc_assert(strlen(indexFilename) + 4, "Error allocating memory");
+  sprintf(file, "%s.df", indexFilename);
+  return file;
+}
+
+
+/**************** bm25_loadDf ****************/
+/* see bm25.h for description */
+
+bool
+bm25_loadDf(bm25_t* bm, const char* file){
+  if(bm == NULL || file == NULL){
+    return false;
+  }
+  FILE* fp = fopen(file, "r");
+  if(fp == NULL){
+    return false;
+  }
+  int numTerms = termindex_numTerms(bm->terms);
+  double* idfs = mem_malloc_assert((numTerms + 1) * sizeof(double), "Error allocating memory");
+  bool ok = true;
+  int df;
+  for(int ordinal = 0; ordinal < numTerms && ok; ordinal++){
+    ok = fscanf(fp, "%d", &df) == 1 && df > 0;
+    idfs[ordinal] = ok ? bm25_dfIdf(bm, df) : 0;
+  }
+  ok = ok && fscanf(fp, "%d", &df) == EOF; // and no more
+  fclose(fp);
+  if(!ok){
+    mem_free(idfs);
+    return false;
+  }
+  mem_free(bm->idfs);
+  bm->idfs = idfs;
+  return true;
+}
+
+
+/**************** bm25_idf ****************/
+/* see bm25.h for description */
+
+double
+bm25_idf(bm25_t* bm, const char* term, postings_t* postings){
+  if(bm == NULL || term == NULL){
+    return 0;
+  }
+  int ordinal = termindex_ordinal(bm->terms, term);
+  if(ordinal >= 0){
+    return bm->idfs[ordinal];
+  }
+  return bm25_dfIdf(bm, postings_size(postings));
+}
+
+
+/**************** bm25_accumulate ****************/
+/* see bm25.h for description */
+
+void
+bm25_accumulate(bm25_t* bm, const double idf, postings_t* postings,
+                double* scores, int* hits){
+  if(bm == NULL || postings == NULL || scores == NULL || hits == NULL){
+    return;
+  }
+  bm25acc_t acc = { bm, idf, scores, hits };
+  postings_iterate(postings, &acc, bm25_accumulate_helper);
+}
+
+
+/**************** bm25_score ****************/
+/* see bm25.h for description */
+
+double
+bm25_score(bm25_t* bm, const double idf, const int docID, const int count){
+  if(bm == NULL || docID <= 0 || docID > bm->maxDoc || count <= 0){
+    return 0;
+  }
+  return idf * count * (K1 + 1) / (count + bm->norms[docID]);
+}
+
+
+/**************** bm25_bound ****************/
+/* see bm25.h for description */
+
+double
+bm25_bound(bm25_t* bm, const double idf, const int maxCount){
+  if(bm == NULL || maxCount <= 0){
+    return 0;
+  }
+  return idf * maxCount * (K1 + 1) / (maxCount + bm->minNorm);
+}
+
+
+/**************** bm25_delete ****************/
+/* see bm25.h for description */
+
+void
+bm25_delete(bm25_t* bm){
+  if(bm != NULL){
+    mem_free(bm->idfs);
+    mem_free(bm->norms);
+    mem_free(bm);
+  }
+}
+
+
+/**************** bm25_docScore ****************/
+/* see bm25.h for description
+ *
+ * the idf and the norm are worked out as bm25_new works them out, so the scores match
+ */
+
+double
+bm25_docScore(docs_t* docs, const int df, const int docID, const int count){
+  if(docs == NULL || !docs_has(docs, docID) || count <= 0){
+    return 0;
+  }
+  double avgLength = docs_avgLength(docs);
+  double ratio = avgLength > 0 ? docs_length(docs, docID) / avgLength : 1;
+  double norm = K1 * (1 - B + B * ratio);
+  int numDocs = docs_numDocs(docs);
+  double idf = log(1 + (numDocs - df + 0.5) / (df + 0.5));
+  return idf * count * (K1 + 1) / (count + norm);
+}
+
+
+/**************** bm25_dfIdf ****************/
+/* see bm25.h for description */
+
+double
+bm25_dfIdf(bm25_t* bm, const int df){
+  return log(1 + (bm->numDocs - df + 0.5) / (df + 0.5));
+}
+
+
+/**************** bm25_idf_helper ****************/
+/* Helper function for termindex_iterate to work out the idf of each word of the index */
+
+static void
+bm25_idf_helper(void* arg, const int ordinal, const char* word, postings_t* postings){
+  bm25_t* bm = arg;
+  bm->idfs[ordinal] = bm25_dfIdf(bm, postings_size(postings));
+}
+
+
+/**************** bm25_accumulate_helper ****************/
+/* Helper function for postings_iterate to add the score of one posting */
+
+static void
+bm25_accumulate_helper(void* arg, const int key, const int count){
+  bm25acc_t* acc = arg;
+  if(key <= 0 || key > acc->bm->maxDoc || count <= 0){
+    return;
+  }
+  acc->scores[key] += acc->idf * count * (K1 + 1) / (count + acc->bm->norms[key]);
+  acc->hits[key]++;
+}
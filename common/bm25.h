@@ -0,0 +1,116 @@
+/*
+ * bm25.h - header file for the bm25 (ranking) module
+ *
+ * scores documents for a word with Okapi BM25:
+ *
+ *   idf(word) * count * (K1 + 1) / (count + K1 * (1 - B + B * length / avgLength))
+ *
+ * Everything that does not depend on the count is worked out once when the
+ * ranker is made: the idf of every word in the index and the length norm
+ *   K1 * (1 - B + B * length / avgLength)
+ * of every document, so scoring a postings list is one multiply-add per posting.
+ *
+ * Cooper LaPorte March 2023
+ */
+
+#ifndef __BM25_H
+#define __BM25_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "postings.h"
+#include "termindex.h"
+#include "docs.h"
+
+/**************** global types ****************/
+typedef struct bm25 bm25_t;  // opaque to users of the module
+
+/**************** bm25_new ****************/
+/* Make a ranker for an index.
+ *
+ * Caller provides:
+ *   the index and its document table
+ * We return:
+ *   pointer to the new ranker, or NULL on bad arguments;
+ *   caller must later call bm25_delete
+ * Notes:
+ *   the ranker keeps a pointer to the index (to look up the ordinals of
+ *   words), which must outlive it, but not to the document table
+ */
+bm25_t* bm25_new(termindex_t* terms, docs_t* docs);
+
+/**************** bm25_dfFilename ****************/
+/* Return the pathname of the document frequency table of indexFilename
+ * (indexFilename.df), written for a pruned index; caller must free it
+ */
+char* bm25_dfFilename(const char* indexFilename);
+
+/**************** bm25_loadDf ****************/
+/* Take the idf of every word from a document frequency table instead of its postings.
+ *
+ * Caller provides:
+ *   ranker, and the pathname of a table with the number of documents of each word of
+ *   the index, one per line in the order of the words (as index_prune writes it)
+ * We return:
+ *   true if the table was read, false (leaving the ranker as it was) if it cannot be
+ *   read or does not have one number for each word of the index
+ * Notes:
+ *   a pruned index keeps only some of the postings of a word; with the table of the
+ *   index it was pruned from, its words score as they did there
+ */
+bool bm25_loadDf(bm25_t* bm, const char* file);
+
+/**************** bm25_maxDoc ****************/
+/* Return the largest docID the ranker knows; score arrays need bm25_maxDoc + 1 entries */
+int bm25_maxDoc(bm25_t* bm);
+
+/**************** bm25_dfIdf ****************/
+/* Return the idf of a term in df documents: log(1 + (N - df + 0.5) / (df + 0.5)) */
+double bm25_dfIdf(bm25_t* bm, const int df);
+
+/**************** bm25_idf ****************/
+/* Return the idf of a term: the precomputed idf if term is a word of the index,
+ * otherwise (e.g. a phrase) the idf worked out from the number of documents in postings.
+ */
+double bm25_idf(bm25_t* bm, const char* term, postings_t* postings);
+
+/**************** bm25_accumulate ****************/
+/* Add the score of a term to every document in its postings.
+ *
+ * Caller provides:
+ *   ranker, the idf of the term (from bm25_idf) and its postings, and two
+ *   arrays of bm25_maxDoc + 1 entries
+ * We do:
+ *   scores[docID] += score of the term in docID, and hits[docID]++,
+ *   for every docID in postings
+ * Notes:
+ *   docIDs the ranker does not know (beyond bm25_maxDoc) are ignored
+ */
+void bm25_accumulate(bm25_t* bm, const double idf, postings_t* postings,
+                     double* scores, int* hits);
+
+/**************** bm25_score ****************/
+/* Return the score of a term with the given idf that occurs count times in docID,
+ * or 0 for a docID the ranker does not know.
+ */
+double bm25_score(bm25_t* bm, const double idf, const int docID, const int count);
+
+/**************** bm25_bound ****************/
+/* Return an upper bound on the score of a term with the given idf in any document
+ * where it occurs at most maxCount times (e.g. the largest count of a block of postings).
+ */
+double bm25_bound(bm25_t* bm, const double idf, const int maxCount);
+
+/**************** bm25_docScore ****************/
+/* Return the score of a word that is in df of the documents of docs and occurs count
+ * times in docID, as a ranker made with docs would score it (the same double), or 0
+ * for a docID docs does not have; for scoring an index a line at a time, without a ranker
+ */
+double bm25_docScore(docs_t* docs, const int df, const int docID, const int count);
+
+/**************** bm25_delete ****************/
+/* Delete the ranker */
+void bm25_delete(bm25_t* bm);
+
+#endif // __BM25_H
@@ -0,0 +1,504 @@
+/*
+ * crc.c - CS50 'crc' module
+ *
+ * see crc.h for more information.
+ *
+ * Cooper LaPorte, March 2023
+ */
+
+#define _POSIX_C_SOURCE 200809L   // mmap, sysconf
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mem.h"
+#include "docs.h"
+#include "urls.h"
+#include "dict.h"
+#include "postings.h"
+#include "positions.h"
+#include "bm25.h"
+#include "crc.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <nmmintrin.h>
+#define CRC_HARD __attribute__((target("sse4.2")))
+#elif defined(__GNUC__) && defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CRC_HARD   // built for a processor that has the instructions
+#endif
+
+
+/**************** file-local constants ****************/
+static const char MAGIC[] = "TSECRC1";
+static const size_t CRC_SECTION = 4 * 1024 * 1024;  // bytes of a file per checksum
+static const int CRC_THREADS_MAX = 16;              // most threads checking sections
+static const uint32_t POLY = 0x82f63b78;            // CRC32C, bits reversed
+
+/* the files checksummed: the index itself, and the tables the modules write beside it */
+static const struct {
+  const char* name;
+  char* (*filename)(const char* indexFilename);
+} TABLES[] = {
+  { "index", NULL },
+  { "docs", docs_filename },
+  { "urls", urls_filename },
+  { "dict", dict_filename },
+  { "blocks", postings_blocksFilename },
+  { "pos", positions_filename },
+  { "df", bm25_dfFilename }
+};
+static const int NUM_TABLES = sizeof(TABLES) / sizeof(TABLES[0]);
+
+
+/**************** local types ****************/
+/* crcfile: one file being checksummed, mapped, and the checksums of its sections */
+typedef struct crcfile {
+  const char* name;
+  size_t size;
+  const unsigned char* map;   // NULL for an empty file
+  int nsec;
+  uint32_t* crcs;             // crcs[section], computed
+  uint32_t* want;             // crcs[section], from the checksum file (when verifying)
+} crcfile_t;
+
+/* crcwork: the sections checksummed by one thread: every nthreads-th, from first */
+typedef struct crcwork {
+  crcfile_t* files;
+  int nfiles;
+  int first;
+  int nthreads;
+  bool threaded;
+} crcwork_t;
+
+/**************** file-local global variables ****************/
+static uint32_t table[8][256];       // for the checksums without the instructions
+static bool hard = false;            // the processor has the instructions
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+
+static void crc_init(void);
+static uint32_t crc_soft(uint32_t crc, const unsigned char* p, size_t len);
+#ifdef CRC_HARD
+static uint32_t crc_hard(uint32_t crc, const unsigned char* p, size_t len);
+#endif
+static bool crcfile_map(crcfile_t* f, const char* path);
+static void crcfile_unmap(crcfile_t* f);
+static bool crc_parseLine(const char* indexFilename, const char* line, const ssize_t len,
+                          crcfile_t* files, int* nfiles, bool* listed, const char** bad);
+static void crc_sections(crcfile_t* files, const int nfiles);
+static void* crcwork_run(void* arg);
+static char* crc_path(const char* indexFilename, const int t);
+
+
+/**************** crc_update ****************/
+/* see crc.h for description */
+
+uint32_t
+crc_update(uint32_t crc, const void* buf, const size_t len){
+  pthread_once(&once, crc_init);
+  crc = ~crc;
+#ifdef CRC_HARD
+  if(hard){
+    return ~crc_hard(crc, buf, len);
+  }
+#endif
+  return ~crc_soft(crc, buf, len);
+}
+
+
+/**************** crc_filename ****************/
+/* see crc.h for description */
+
+char*
+crc_filename(const char* indexFilename){
+  if(indexFilename == NULL){
+    return NULL;
+  }
+  char* file = mem_malloc_assert(strlen(indexFilename) + 5, "Error allocating memory");
+  sprintf(file, "%s.crc", indexFilename);
+  return file;
+}
+
+
+/**************** crc_save ****************/
+/* see crc.h for description */
+
+bool
+crc_save(const char* indexFilename, const char* crcFile){
+  if(indexFilename == NULL || crcFile == NULL){
+    return false;
+  }
+  crcfile_t files[NUM_TABLES];
+  int nfiles = 0;
+  bool ok = true;
+  for(int t = 0; t < NUM_TABLES && ok; t++){
+    char* path = crc_path(indexFilename, t);
+    if(t == 0 || access(path, F_OK) == 0){ // the index, and each table there is
+      files[nfiles].name = TABLES[t].name;
+      ok = crcfile_map(&files[nfiles], path);
+      nfiles += ok;
+    }
+    mem_free(path);
+  }
+  FILE* fp = ok ? fopen(crcFile, "w") : NULL;
+  if(fp != NULL){
+    crc_sections(files, nfiles);
+    fprintf(fp, "%s %zu\n", MAGIC, CRC_SECTION);
+    for(int f = 0; f < nfiles; f++){
+      fprintf(fp, "%s %zu", files[f].name, files[f].size);
+      for(int s = 0; s < files[f].nsec; s++){
+        fprintf(fp, " %08x", (unsigned int)files[f].crcs[s]);
+      }
+      fprintf(fp, "\n");
+    }
+    ok = !ferror(fp);
+    if(fclose(fp) != 0){
+      ok = false;
+    }
+  } else{
+    ok = false;
+  }
+  for(int f = 0; f < nfiles; f++){
+    crcfile_unmap(&files[f]);
+  }
+  return ok;
+}
+
+
+/**************** crc_verify ****************/
+/* see crc.h for description
+ *
+ * every file listed is mapped and its size checked first; only then are the
+ * sections of all of them checksummed together, so the threads are kept busy
+ * even when the tables are much smaller than the index
+ */
+
+bool
+crc_verify(const char* indexFilename, const char* crcFile, const char** bad){
+  const char* dummy;
+  if(bad == NULL){
+    bad = &dummy;
+  }
+  *bad = NULL;
+  if(indexFilename == NULL || crcFile == NULL){
+    return false;
+  }
+  *bad = "crc";
+  FILE* fp = fopen(crcFile, "r");
+  if(fp == NULL){
+    return false;
+  }
+  crcfile_t files[NUM_TABLES];
+  bool listed[NUM_TABLES];
+  memset(listed, 0, sizeof(listed));
+  int nfiles = 0;
+  char header[32];
+  snprintf(header, sizeof(header), "%s %zu\n", MAGIC, CRC_SECTION);
+  char* line = NULL;  // allocated by getline
+  size_t cap = 0;
+  bool ok = getline(&line, &cap, fp) > 0 && strcmp(line, header) == 0;
+  ssize_t len;
+  while(ok && (len = getline(&line, &cap, fp)) > 0){
+    ok = crc_parseLine(indexFilename, line, len, files, &nfiles, listed, bad);
+  }
+  free(line); // allocated by getline
+  fclose(fp);
+  for(int t = 0; t < NUM_TABLES && ok; t++){ // the index, and every table beside it, listed
+    if(!listed[t]){
+      char* path = crc_path(indexFilename, t);
+      if(t == 0 || access(path, F_OK) == 0){
+        ok = false;
+        *bad = TABLES[t].name;
+      }
+      mem_free(path);
+    }
+  }
+  if(ok){
+    crc_sections(files, nfiles);
+    for(int f = 0; f < nfiles && ok; f++){
+      for(int s = 0; s < files[f].nsec && ok; s++){
+        if(files[f].crcs[s] != files[f].want[s]){
+          ok = false;
+          *bad = files[f].name;
+        }
+      }
+    }
+  }
+  if(ok){
+    *bad = NULL;
+  }
+  for(int f = 0; f < nfiles; f++){
+    crcfile_unmap(&files[f]);
+  }
+  return ok;
+}
+
+
+/**************** crc_parseLine ****************/
+/* Parse one line of a checksum file, "name size crc crc ...\n", of len characters:
+ * map the file it names into files[*nfiles] and keep the checksums of its sections;
+ * returns false (with *bad set to the name of the file, or to "crc" for a line
+ * that is malformed, cut short, or names a file listed already) if it does not fit
+ */
+
+static bool
+crc_parseLine(const char* indexFilename, const char* line, const ssize_t len,
+              crcfile_t* files, int* nfiles, bool* listed, const char** bad){
+  char name[16];  // longer than any name of TABLES
+  size_t size;
+  int pos;
+  *bad = "crc";
+  if(line[len - 1] != '\n' || sscanf(line, "%15s %zu%n", name, &size, &pos) != 2){
+    return false;  // cut short, or not a file
+  }
+  int t = 0;
+  while(t < NUM_TABLES && strcmp(TABLES[t].name, name) != 0){
+    t++;
+  }
+  if(t == NUM_TABLES || listed[t]){ // a name we do not know, or one listed twice
+    return false;
+  }
+  listed[t] = true;
+  crcfile_t* f = &files[*nfiles];
+  char* path = crc_path(indexFilename, t);
+  f->name = TABLES[t].name;
+  bool ok = crcfile_map(f, path);
+  mem_free(path);
+  if(ok){
+    (*nfiles)++;
+  }
+  if(!ok || f->size != size){ // missing, or cut short (or grown)
+    *bad = TABLES[t].name;
+    return false;
+  }
+  f->want = mem_malloc_assert((f->nsec + 1) * sizeof(uint32_t), "Error allocating memory");
+  const char* p = line + pos;
+  for(int s = 0; s < f->nsec; s++){ // " " and 8 hex digits per section
+    if(p[0] != ' ' || strspn(p + 1, "0123456789abcdef") != 8){
+      return false;
+    }
+    f->want[s] = (uint32_t)strtoul(p + 1, NULL, 16);
+    p += 9;
+  }
+  return *p == '\n';
+}
+
+
+/**************** crc_init ****************/
+/* Build the tables for checksums without the instructions (slicing by 8 bytes),
+ * and find out whether the processor has the instructions; run once
+ */
+
+static void
+crc_init(void){
+  for(int b = 0; b < 256; b++){
+    uint32_t crc = b;
+    for(int bit = 0; bit < 8; bit++){
+      crc = (crc & 1) ? (crc >> 1) ^ POLY : crc >> 1;
+    }
+    table[0][b] = crc;
+  }
+  for(int b = 0; b < 256; b++){
+    for(int k = 1; k < 8; k++){
+      table[k][b] = (table[k - 1][b] >> 8) ^ table[0][table[k - 1][b] & 0xff];
+    }
+  }
+#if defined(CRC_HARD) && defined(__x86_64__)
+  hard = __builtin_cpu_supports("sse4.2");
+#elif defined(CRC_HARD)
+  hard = true; // built for a processor that has them
+#endif
+}
+
+
+/**************** crc_soft ****************/
+/* Checksum len bytes at p with the tables, 8 bytes at a time (crc not inverted) */
+
+static uint32_t
+crc_soft(uint32_t crc, const unsigned char* p, size_t len){
+  while(len >= 8){
+    uint32_t lo = crc ^ ((uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24);
+    crc = table[7][lo & 0xff] ^ table[6][(lo >> 8) & 0xff] ^ table[5][(lo >> 16) & 0xff] ^ table[4][lo >> 24]
+          ^ table[3][p[4]] ^ table[2][p[5]] ^ table[1][p[6]] ^ table[0][p[7]];
+    p += 8;
+    len -= 8;
+  }
+  while(len-- > 0){
+    crc = (crc >> 8) ^ table[0][(crc ^ *p++) & 0xff];
+  }
+  return crc;
+}
+
+
+#ifdef CRC_HARD
+/**************** crc_hard ****************/
+/* Checksum len bytes at p with the instructions, 8 bytes at a time (crc not inverted) */
+
+CRC_HARD static uint32_t
+crc_hard(uint32_t crc, const unsigned char* p, size_t len){
+  uint64_t c = crc;
+  while(len >= 8){
+    uint64_t v;
+    memcpy(&v, p, 8);
+#ifdef __x86_64__
+    c = _mm_crc32_u64(c, v);
+#else
+    c = __crc32cd((uint32_t)c, v);
+#endif
+    p += 8;
+    len -= 8;
+  }
+  crc = (uint32_t)c;
+  while(len-- > 0){
+#ifdef __x86_64__
+    crc = _mm_crc32_u8(crc, *p++);
+#else
+    crc = __crc32cb(crc, *p++);
+#endif
+  }
+  return crc;
+}
+#endif
+
+
+/**************** crcfile_map ****************/
+/* Map the file at path read-only into f, with room for the checksums of its sections;
+ * returns false if it cannot be opened or mapped
+ */
+
+static bool
+crcfile_map(crcfile_t* f, const char* path){
+  f->map = NULL;
+  f->size = 0;
+  f->nsec = 0;
+  f->crcs = NULL;
+  f->want = NULL;
+  int fd = open(path, O_RDONLY);
+  if(fd < 0){
+    return false;
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0){
+    close(fd);
+    return false;
+  }
+  f->size = st.st_size;
+  if(f->size > 0){
+    void* map = mmap(NULL, f->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(map == MAP_FAILED){
+      close(fd);
+      return false;
+    }
+    f->map = map;
+  }
+  close(fd); // the mapping stays valid
+  f->nsec = (int)((f->size + CRC_SECTION - 1) / CRC_SECTION);
+  f->crcs = mem_malloc_assert((f->nsec + 1) * sizeof(uint32_t), "Error allocating memory");
+  return true;
+}
+
+
+/**************** crcfile_unmap ****************/
+/* Unmap the file and free its checksums */
+
+static void
+crcfile_unmap(crcfile_t* f){
+  if(f->map != NULL){
+    munmap((void*)f->map, f->size);
+  }
+  if(f->crcs != NULL){
+    mem_free(f->crcs);
+  }
+  if(f->want != NULL){
+    mem_free(f->want);
+  }
+}
+
+
+/**************** crc_sections ****************/
+/* Checksum every section of the files, with one thread per CPU (at most
+ * CRC_THREADS_MAX, and no more than there are sections)
+ */
+
+static void
+crc_sections(crcfile_t* files, const int nfiles){
+  int total = 0;
+  for(int f = 0; f < nfiles; f++){
+    total += files[f].nsec;
+  }
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  int nthreads = cpus > 0 ? (int)cpus : 1;
+  if(nthreads > CRC_THREADS_MAX){
+    nthreads = CRC_THREADS_MAX;
+  }
+  if(nthreads > total){
+    nthreads = total > 0 ? total : 1;
+  }
+  crcwork_t* work = mem_calloc_assert(nthreads, sizeof(crcwork_t), "Error allocating memory");
+  pthread_t* threads = mem_malloc_assert(nthreads * sizeof(pthread_t), "Error allocating memory");
+  for(int w = 0; w < nthreads; w++){
+    work[w].files = files;
+    work[w].nfiles = nfiles;
+    work[w].first = w;
+    work[w].nthreads = nthreads;
+  }
+  for(int w = 1; w < nthreads; w++){ // this thread does the sections of work 0 itself
+    work[w].threaded = pthread_create(&threads[w], NULL, crcwork_run, &work[w]) == 0;
+    if(!work[w].threaded){
+      crcwork_run(&work[w]);  // could not start a thread: do them here
+    }
+  }
+  crcwork_run(&work[0]);
+  for(int w = 1; w < nthreads; w++){
+    if(work[w].threaded){
+      pthread_join(threads[w], NULL);
+    }
+  }
+  mem_free(threads);
+  mem_free(work);
+}
+
+
+/**************** crcwork_run ****************/
+/* thread function: checksum the sections given to one thread; the sections of all the
+ * files are numbered one after the other, and the thread takes every nthreads-th
+ */
+
+static void*
+crcwork_run(void* arg){
+  crcwork_t* work = arg;
+  int base = 0;   // number of the first section of file f
+  for(int f = 0; f < work->nfiles; f++){
+    crcfile_t* file = &work->files[f];
+    int s = ((work->first - base) % work->nthreads + work->nthreads) % work->nthreads;
+    for(; s < file->nsec; s += work->nthreads){
+      size_t off = (size_t)s * CRC_SECTION;
+      size_t len = file->size - off < CRC_SECTION ? file->size - off : CRC_SECTION;
+      file->crcs[s] = crc_update(0, file->map + off, len);
+    }
+    base += file->nsec;
+  }
+  return NULL;
+}
+
+
+/**************** crc_path ****************/
+/* Return the pathname of file t of TABLES for indexFilename; caller must free it */
+
+static char*
+crc_path(const char* indexFilename, const int t){
+  if(TABLES[t].filename != NULL){
+    return TABLES[t].filename(indexFilename);
+  }
+  char* path = mem_malloc_assert(strlen(indexFilename) + 1, "Error allocating memory");
+  strcpy(path, indexFilename);
+  return path;
+}
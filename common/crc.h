@@ -0,0 +1,76 @@
+/*
+ * crc.h - header file for the crc (index checksum) module
+ *
+ * CRC32C (Castagnoli) checksums of an index file and the tables written beside
+ * it, so a truncated or corrupted index is refused instead of loaded in part.
+ * Each file is cut into sections of CRC_SECTION bytes (4MB) and every section has
+ * its own checksum, so the sections can be checked by several threads at once.
+ * The indexer (and indexmerge and indexprune) write the checksums beside the
+ * index (indexFilename.crc) once everything else is written, and beside each
+ * segment of an index directory before it is published:
+ *
+ *   "TSECRC1" sectionSize
+ *   then per file: name size crc crc ...
+ *
+ * where name is "index" for the index file itself, or the suffix of a table
+ * ("docs", "urls", "dict", "blocks", "pos", "df"), and each crc is 8 hex digits.
+ * The checksums use the SSE4.2 (x86-64) or CRC32 (ARMv8) instructions when the
+ * processor has them, and a table otherwise.
+ *
+ * Cooper LaPorte March 2023
+ */
+
+#ifndef __CRC_H
+#define __CRC_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**************** crc_update ****************/
+/* Return the CRC32C of the len bytes at buf following the bytes whose CRC32C is crc
+ * (0 to start), so a file can be checksummed a piece at a time.
+ */
+uint32_t crc_update(uint32_t crc, const void* buf, const size_t len);
+
+/**************** crc_filename ****************/
+/* Return the pathname of the checksums that go with an index file,
+ * indexFilename.crc; caller must free the pathname.
+ */
+char* crc_filename(const char* indexFilename);
+
+/**************** crc_save ****************/
+/* Write the checksums of an index file and of the tables beside it.
+ *
+ * Caller provides:
+ *   pathname of an index file (written, with its tables), and the file to write to
+ * We return:
+ *   true if the checksums were written;
+ *   false if the index cannot be read or the file cannot be written
+ * Notes:
+ *   only the tables that exist are checksummed; call it after they are all written
+ */
+bool crc_save(const char* indexFilename, const char* crcFile);
+
+/**************** crc_verify ****************/
+/* Check an index file and the tables beside it against their checksums.
+ *
+ * Caller provides:
+ *   pathname of an index file, the file of its checksums, and where to put the
+ *   name of a file that does not match (may be NULL)
+ * We return:
+ *   true if crcFile lists the index file and every table there is beside it, and
+ *   every section of each matches its checksum;
+ *   false otherwise: if crcFile is missing, malformed or cut short (*bad is then
+ *   set to "crc"), or the index or a table beside it is not listed, or a file
+ *   listed is missing, has another size, or has a section that does not match
+ *   (*bad is then set to its name, e.g. "index" or "docs")
+ * Notes:
+ *   the files are mapped, and their sections checked by up to one thread per CPU;
+ *   an index from before checksums has no crcFile, so the caller decides whether
+ *   to load it unchecked
+ */
+bool crc_verify(const char* indexFilename, const char* crcFile, const char** bad);
+
+#endif // __CRC_H
@@ -0,0 +1,683 @@
+/*
+ * dict.c - CS50 'dict' module
+ *
+ * see dict.h for more information.
+ *
+ * Cooper LaPorte, March 2023
+ */
+
+#define _POSIX_C_SOURCE 200809L   // getline
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "mem.h"
+#include "memtag.h"
+#include "dict.h"
+
+
+/**************** file-local constants ****************/
+static const char MAGIC[8] = "TSEDICT1";   // header of a dictionary file
+static const int DICT_BLOCK = 16;          // words per front-coded block
+
+
+/**************** local types ****************/
+struct dict {
+  unsigned char* data;   // the front-coded blocks
+  size_t len;
+  size_t cap;
+  uint64_t* blocks;      // offset in data of each block
+  int numBlocks;
+  int blockCap;
+  int n;                 // number of words
+  int maxLen;            // length of the longest word
+  char* last;            // the last word added, while building
+  int lastLen;
+};
+
+/* dictcursor: a word of the dictionary being decoded in order, for dict_fuzzy */
+typedef struct dictcursor {
+  const unsigned char* p;   // the entry of the word after it in data
+  int ordinal;              // its ordinal (-1 before the first word)
+  char* buf;                // the word (maxLen + 1 bytes), not terminated
+  int len;
+} dictcursor_t;
+
+/* dict file header, after MAGIC */
+typedef struct dicthead {
+  uint32_t n;
+  uint32_t numBlocks;
+  uint32_t maxLen;
+  uint32_t pad;
+  uint64_t len;
+} dicthead_t;
+
+
+static void dict_put(dict_t* dict, unsigned int value);
+static void dict_putBytes(dict_t* dict, const char* bytes, const int n);
+static inline unsigned int dict_get(const unsigned char** pp);
+static int dict_cmpFirst(dict_t* dict, const int block, const char* word, const int wordLen);
+static int dict_lowerBound(dict_t* dict, const char* word, const int wordLen);
+static int dict_step(dict_t* dict, dictcursor_t* cur);
+static int dict_seek(dict_t* dict, dictcursor_t* cur, const char* word, const int wordLen);
+static int dict_row(const char* word, const int m, const int maxEdits, int* rows, const int d, const char c);
+static int dict_skip(dict_t* dict, dictcursor_t* cur, const char* word, const int m, const int maxEdits,
+                     int* rows, char* next, int len);
+
+
+/**************** dict_filename ****************/
+/* see dict.h for description */
+
+char*
+dict_filename(const char* indexFilename){
+  if(indexFilename == NULL){
+    return NULL;
+  }
+  char* file = mem_malloc_assert(strlen(indexFilename) + 6, "Error allocating memory");
+  sprintf(file, "%s.dict", indexFilename);
+  return file;
+}
+
+
+/**************** dict_new ****************/
+/* see dict.h for description */
+
+dict_t*
+dict_new(void){
+  dict_t* dict = memtag_malloc(MEMTAG_DICTIONARY, sizeof(dict_t), "Error allocating memory");
+  dict->cap = 1024;
+  dict->len = 0;
+  dict->data = memtag_malloc(MEMTAG_DICTIONARY, dict->cap, "Error allocating memory");
+  dict->blockCap = 64;
+  dict->numBlocks = 0;
+  dict->blocks = memtag_malloc(MEMTAG_DICTIONARY, dict->blockCap * sizeof(uint64_t), "Error allocating memory");
+  dict->n = 0;
+  dict->maxLen = 0;
+  dict->last = NULL;
+  dict->lastLen = 0;
+  return dict;
+}
+
+
+/**************** dict_add ****************/
+/* see dict.h for description */
+
+bool
+dict_add(dict_t* dict, const char* word){
+  if(dict == NULL || word == NULL || (dict->last != NULL && strcmp(dict->last, word) >= 0)){
+    return false;
+  }
+  int wordLen = strlen(word);
+  if(dict->n % DICT_BLOCK == 0){ // first word of a new block: stored whole
+    if(dict->numBlocks == dict->blockCap){
+      dict->blockCap *= 2;
+      dict->blocks = memtag_realloc(MEMTAG_DICTIONARY, dict->blocks, dict->blockCap * sizeof(uint64_t), "Error allocating memory");
+    }
+    dict->blocks[dict->numBlocks++] = dict->len;
+    dict_put(dict, wordLen);
+    dict_putBytes(dict, word, wordLen);
+  } else{ // the prefix shared with the last word, then the rest
+    int prefix = 0;
+    while(prefix < dict->lastLen && prefix < wordLen && dict->last[prefix] == word[prefix]){
+      prefix++;
+    }
+    dict_put(dict, prefix);
+    dict_put(dict, wordLen - prefix);
+    dict_putBytes(dict, word + prefix, wordLen - prefix);
+  }
+  if(wordLen > dict->maxLen || dict->last == NULL){
+    dict->last = memtag_realloc(MEMTAG_DICTIONARY, dict->last, wordLen + 1, "Error allocating memory");
+    if(wordLen > dict->maxLen){
+      dict->maxLen = wordLen;
+    }
+  }
+  strcpy(dict->last, word);
+  dict->lastLen = wordLen;
+  dict->n++;
+  return true;
+}
+
+
+/**************** dict_find ****************/
+/* see dict.h for description */
+
+int
+dict_find(dict_t* dict, const char* word){
+  if(dict == NULL || word == NULL || dict->n == 0){
+    return -1;
+  }
+  int wordLen = strlen(word);
+  if(wordLen > dict->maxLen){
+    return -1;
+  }
+  // binary search for the last block whose first word is <= word
+  int lo = 0;
+  int hi = dict->numBlocks - 1;
+  if(dict_cmpFirst(dict, 0, word, wordLen) < 0){
+    return -1;
+  }
+  while(lo < hi){
+    int mid = (lo + hi + 1) / 2;
+    if(dict_cmpFirst(dict, mid, word, wordLen) < 0){
+      hi = mid - 1;
+    } else{
+      lo = mid;
+    }
+  }
+  // scan the block, rebuilding each word from the one before it
+  char stackBuf[256];
+  char* buf = dict->maxLen < sizeof(stackBuf) ? stackBuf
+              : mem_malloc_assert(dict->maxLen + 1, "Error allocating memory");
+  const unsigned char* p = dict->data + dict->blocks[lo];
+  int found = -1;
+  int ordinal = lo * DICT_BLOCK;
+  int len = dict_get(&p);
+  memcpy(buf, p, len);
+  p += len;
+  for(int i = 0; ; i++){
+    int cmp = memcmp(buf, word, len < wordLen ? len : wordLen);
+    if(cmp == 0){
+      cmp = len - wordLen;
+    }
+    if(cmp == 0){
+      found = ordinal + i;
+      break;
+    }
+    if(cmp > 0 || i + 1 == DICT_BLOCK || ordinal + i + 1 == dict->n){ // passed it, or end of the block
+      break;
+    }
+    int prefix = dict_get(&p);
+    int suffix = dict_get(&p);
+    memcpy(buf + prefix, p, suffix);
+    p += suffix;
+    len = prefix + suffix;
+  }
+  if(buf != stackBuf){
+    mem_free(buf);
+  }
+  return found;
+}
+
+
+/**************** dict_range ****************/
+/* see dict.h for description */
+
+int
+dict_range(dict_t* dict, const char* prefix, int* end){
+  if(dict == NULL || prefix == NULL){
+    *end = 0;
+    return 0;
+  }
+  int len = strlen(prefix);
+  int first = dict_lowerBound(dict, prefix, len);
+  // the words with the prefix end before the first word >= the prefix with its last byte
+  // incremented (a last byte of 0xff is dropped first, as no byte comes after it)
+  char* next = mem_malloc_assert(len + 1, "Error allocating memory");
+  memcpy(next, prefix, len);
+  while(len > 0 && (unsigned char)next[len - 1] == 0xff){
+    len--;
+  }
+  if(len == 0){ // every word from first on
+    *end = dict->n;
+  } else{
+    next[len - 1] = (unsigned char)next[len - 1] + 1;
+    *end = dict_lowerBound(dict, next, len);
+  }
+  mem_free(next);
+  return first;
+}
+
+
+/**************** dict_fuzzy ****************/
+/* see dict.h for description */
+
+void
+dict_fuzzy(dict_t* dict, const char* word, const int maxEdits, void* arg,
+           void (*itemfunc)(void* arg, const int ordinal, const char* word, const int edits)){
+  if(dict == NULL || word == NULL || maxEdits < 0 || itemfunc == NULL){
+    return;
+  }
+  // rows[d * (m + 1) + j] is the edit distance from the first d bytes of the word in the
+  // cursor to the first j bytes of word; a row past m + maxEdits is always over maxEdits,
+  // and so is an entry with |d - j| > maxEdits: those are left at maxEdits + 1 (see dict_row)
+  int m = strlen(word);
+  int* rows = mem_malloc_assert((m + maxEdits + 2) * (m + 1) * sizeof(int), "Error allocating memory");
+  for(int i = 0; i < (m + maxEdits + 2) * (m + 1); i++){
+    rows[i] = i <= m ? i : maxEdits + 1;
+  }
+  dictcursor_t cur = { dict->data, -1, mem_malloc_assert(dict->maxLen + 1, "Error allocating memory"), 0 };
+  char* next = mem_malloc_assert(dict->maxLen + 1, "Error allocating memory"); // for dict_skip
+  int valid = 0;   // the rows of cur.buf up to valid are worked out, each with an entry within maxEdits
+  int shared = dict_step(dict, &cur);
+  while(cur.ordinal < dict->n){
+    if(shared < valid){
+      valid = shared;
+    }
+    while(valid < cur.len
+          && dict_row(word, m, maxEdits, rows, valid + 1, cur.buf[valid]) <= maxEdits){
+      valid++;
+    }
+    if(valid < cur.len){ // no word that starts with the first valid + 1 bytes of this one is within maxEdits
+      shared = dict_skip(dict, &cur, word, m, maxEdits, rows, next, valid);
+    } else{
+      int edits = rows[cur.len * (m + 1) + m];
+      if(edits <= maxEdits){
+        cur.buf[cur.len] = '\0';
+        (*itemfunc)(arg, cur.ordinal, cur.buf, edits);
+      }
+      shared = dict_step(dict, &cur);
+    }
+  }
+  mem_free(next);
+  mem_free(cur.buf);
+  mem_free(rows);
+}
+
+
+/**************** dict_size ****************/
+/* see dict.h for description */
+
+int
+dict_size(dict_t* dict){
+  return dict == NULL ? 0 : dict->n;
+}
+
+
+/**************** dict_iterate ****************/
+/* see dict.h for description */
+
+void
+dict_iterate(dict_t* dict, void* arg,
+             void (*itemfunc)(void* arg, const int ordinal, const char* word)){
+  if(dict == NULL || itemfunc == NULL){
+    return;
+  }
+  char* buf = mem_malloc_assert(dict->maxLen + 1, "Error allocating memory");
+  const unsigned char* p = dict->data;
+  int len = 0;
+  for(int ordinal = 0; ordinal < dict->n; ordinal++){
+    int prefix = 0;
+    if(ordinal % DICT_BLOCK != 0){
+      prefix = dict_get(&p);
+    }
+    int suffix = dict_get(&p);
+    memcpy(buf + prefix, p, suffix);
+    p += suffix;
+    len = prefix + suffix;
+    buf[len] = '\0';
+    (*itemfunc)(arg, ordinal, buf);
+  }
+  mem_free(buf);
+}
+
+
+/**************** dict_save ****************/
+/* see dict.h for description */
+
+bool
+dict_save(dict_t* dict, const char* file){
+  if(dict == NULL || file == NULL){
+    return false;
+  }
+  FILE* fp = fopen(file, "w");
+  if(fp == NULL){
+    return false;
+  }
+  dicthead_t head = { dict->n, dict->numBlocks, dict->maxLen, 0, dict->len };
+  fwrite(MAGIC, 1, sizeof(MAGIC), fp);
+  fwrite(&head, sizeof(head), 1, fp);
+  fwrite(dict->blocks, sizeof(uint64_t), dict->numBlocks, fp);
+  fwrite(dict->data, 1, dict->len, fp);
+  bool ok = !ferror(fp);
+  return (fclose(fp) == 0) && ok;
+}
+
+
+/**************** dict_saveIndex ****************/
+/* see dict.h for description */
+
+bool
+dict_saveIndex(const char* indexFilename, const char* file){
+  FILE* fp = indexFilename == NULL ? NULL : fopen(indexFilename, "r");
+  if(fp == NULL){
+    return false;
+  }
+  dict_t* dict = dict_new();
+  bool ok = true;
+  char* line = NULL;
+  size_t size = 0;
+  while(ok && getline(&line, &size, fp) > 0){
+    line[strcspn(line, " \n")] = '\0';
+    ok = dict_add(dict, line);
+  }
+  fclose(fp);
+  free(line);   // allocated by getline
+  ok = ok && dict_save(dict, file);
+  dict_delete(dict);
+  return ok;
+}
+
+
+/**************** dict_load ****************/
+/* see dict.h for description */
+
+dict_t*
+dict_load(const char* file){
+  FILE* fp = file == NULL ? NULL : fopen(file, "r");
+  if(fp == NULL){
+    return NULL;
+  }
+  char magic[sizeof(MAGIC)];
+  dicthead_t head;
+  if(fread(magic, 1, sizeof(magic), fp) != sizeof(magic) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0
+     || fread(&head, sizeof(head), 1, fp) != 1
+     || head.numBlocks != (head.n + DICT_BLOCK - 1) / DICT_BLOCK){
+    fclose(fp);
+    return NULL;
+  }
+  dict_t* dict = memtag_malloc(MEMTAG_DICTIONARY, sizeof(dict_t), "Error allocating memory");
+  dict->n = head.n;
+  dict->numBlocks = head.numBlocks;
+  dict->blockCap = head.numBlocks + 1;
+  dict->maxLen = head.maxLen;
+  dict->len = head.len;
+  dict->cap = head.len + 1;
+  dict->last = NULL;
+  dict->lastLen = 0;
+  dict->blocks = memtag_malloc(MEMTAG_DICTIONARY, dict->blockCap * sizeof(uint64_t), "Error allocating memory");
+  dict->data = memtag_malloc(MEMTAG_DICTIONARY, dict->cap, "Error allocating memory");
+  bool ok = fread(dict->blocks, sizeof(uint64_t), dict->numBlocks, fp) == dict->numBlocks
+            && fread(dict->data, 1, dict->len, fp) == dict->len;
+  for(int b = 0; ok && b < dict->numBlocks; b++){
+    ok = dict->blocks[b] < dict->len;
+  }
+  fclose(fp);
+  if(!ok){
+    dict_delete(dict);
+    return NULL;
+  }
+  return dict;
+}
+
+
+/**************** dict_delete ****************/
+/* see dict.h for description */
+
+void
+dict_delete(dict_t* dict){
+  if(dict != NULL){
+    memtag_free(dict->data);
+    memtag_free(dict->blocks);
+    memtag_free(dict->last);
+    memtag_free(dict);
+  }
+}
+
+
+/**************** dict_put ****************/
+/* Append value to the data as a varint */
+
+static void
+dict_put(dict_t* dict, unsigned int value){
+  if(dict->len + 5 > dict->cap){
+    dict->cap *= 2;
+    dict->data = memtag_realloc(MEMTAG_DICTIONARY, dict->data, dict->cap, "Error allocating memory");
+  }
+  while(value >= 0x80){
+    dict->data[dict->len++] = (value & 0x7f) | 0x80;
+    value >>= 7;
+  }
+  dict->data[dict->len++] = value;
+}
+
+
+/**************** dict_putBytes ****************/
+/* Append n bytes to the data */
+
+static void
+dict_putBytes(dict_t* dict, const char* bytes, const int n){
+  while(dict->len + n > dict->cap){
+    dict->cap *= 2;
+    dict->data = memtag_realloc(MEMTAG_DICTIONARY, dict->data, dict->cap, "Error allocating memory");
+  }
+  memcpy(dict->data + dict->len, bytes, n);
+  dict->len += n;
+}
+
+
+/**************** dict_get ****************/
+/* Read a varint at *pp and step over it */
+
+static inline unsigned int
+dict_get(const unsigned char** pp){
+  const unsigned char* p = *pp;
+  unsigned int value = 0;
+  int shift = 0;
+  while(*p & 0x80){
+    value |= (unsigned int)(*p++ & 0x7f) << shift;
+    shift += 7;
+  }
+  value |= (unsigned int)(*p++) << shift;
+  *pp = p;
+  return value;
+}
+
+
+/**************** dict_cmpFirst ****************/
+/* Compare word with the first word of block, like strcmp(word, first) */
+
+static int
+dict_cmpFirst(dict_t* dict, const int block, const char* word, const int wordLen){
+  const unsigned char* p = dict->data + dict->blocks[block];
+  int len = dict_get(&p);
+  int cmp = memcmp(word, p, wordLen < len ? wordLen : len);
+  if(cmp == 0){
+    cmp = wordLen - len;
+  }
+  return cmp;
+}
+
+
+/**************** dict_lowerBound ****************/
+/* Return the ordinal of the first word that is not less than word (wordLen bytes),
+ * or the number of words if every word is less: a binary search over the first
+ * words of the blocks, then a scan of one block, as dict_find does
+ */
+
+static int
+dict_lowerBound(dict_t* dict, const char* word, const int wordLen){
+  if(dict->n == 0 || dict_cmpFirst(dict, 0, word, wordLen) <= 0){
+    return 0;
+  }
+  // binary search for the last block whose first word is < word
+  int lo = 0;
+  int hi = dict->numBlocks - 1;
+  while(lo < hi){
+    int mid = (lo + hi + 1) / 2;
+    if(dict_cmpFirst(dict, mid, word, wordLen) <= 0){
+      hi = mid - 1;
+    } else{
+      lo = mid;
+    }
+  }
+  // scan the block for the first word >= word; the first word of the next block is, if none is
+  char stackBuf[256];
+  char* buf = dict->maxLen < sizeof(stackBuf) ? stackBuf
+              : mem_malloc_assert(dict->maxLen + 1, "Error allocating memory");
+  const unsigned char* p = dict->data + dict->blocks[lo];
+  int ordinal = lo * DICT_BLOCK;
+  int last = ordinal + DICT_BLOCK < dict->n ? ordinal + DICT_BLOCK : dict->n;
+  int len = dict_get(&p);
+  memcpy(buf, p, len);
+  p += len;
+  while(++ordinal < last){
+    int prefix = dict_get(&p);
+    int suffix = dict_get(&p);
+    memcpy(buf + prefix, p, suffix);
+    p += suffix;
+    len = prefix + suffix;
+    int cmp = memcmp(buf, word, len < wordLen ? len : wordLen);
+    if(cmp > 0 || (cmp == 0 && len >= wordLen)){
+      break;
+    }
+  }
+  if(buf != stackBuf){
+    mem_free(buf);
+  }
+  return ordinal;
+}
+
+
+/**************** dict_step ****************/
+/* Decode the word after the one in the cursor (or move past the end, to ordinal n,
+ * from the last word); return the length of the prefix it shares with the word that
+ * was there (at least)
+ */
+
+static int
+dict_step(dict_t* dict, dictcursor_t* cur){
+  int ordinal = ++cur->ordinal;
+  if(ordinal >= dict->n){
+    return 0;
+  }
+  if(ordinal % DICT_BLOCK == 0){ // first word of a block: stored whole
+    cur->p = dict->data + dict->blocks[ordinal / DICT_BLOCK];
+    int len = dict_get(&cur->p);
+    int shared = 0;
+    while(shared < len && shared < cur->len && cur->buf[shared] == (char)cur->p[shared]){
+      shared++;
+    }
+    memcpy(cur->buf, cur->p, len);
+    cur->p += len;
+    cur->len = len;
+    return shared;
+  }
+  int prefix = dict_get(&cur->p);
+  int suffix = dict_get(&cur->p);
+  memcpy(cur->buf + prefix, cur->p, suffix);
+  cur->p += suffix;
+  cur->len = prefix + suffix;
+  return prefix;
+}
+
+
+/**************** dict_seek ****************/
+/* Move the cursor forward to the first word not less than word (wordLen bytes), which
+ * comes after the word in it (or past the end, to ordinal n, if every word is less);
+ * return the length of the prefix it shares with the word that was there (at least)
+ * the block is found by galloping over the first words of the blocks from the cursor's
+ * (steps of 1, 2, 4, ... blocks, then a binary search of the last step), since the words
+ * sought by dict_fuzzy are mostly near, and then the cursor decodes its way to the word
+ */
+
+static int
+dict_seek(dict_t* dict, dictcursor_t* cur, const char* word, const int wordLen){
+  int block = cur->ordinal / DICT_BLOCK;
+  int lo = block;   // the first word of block lo is less than word
+  int step = 1;
+  while(lo + step < dict->numBlocks && dict_cmpFirst(dict, lo + step, word, wordLen) > 0){
+    lo += step;
+    step *= 2;
+  }
+  int hi = lo + step < dict->numBlocks ? lo + step : dict->numBlocks;   // not less, or past the end
+  while(hi - lo > 1){
+    int mid = (lo + hi) / 2;
+    if(dict_cmpFirst(dict, mid, word, wordLen) > 0){
+      lo = mid;
+    } else{
+      hi = mid;
+    }
+  }
+  if(lo != block){ // decode from the start of block lo
+    cur->ordinal = lo * DICT_BLOCK - 1;
+  }
+  int shared = cur->len;
+  while(true){
+    int prefix = dict_step(dict, cur);
+    if(prefix < shared){
+      shared = prefix;
+    }
+    if(cur->ordinal >= dict->n){
+      return shared;
+    }
+    int cmp = memcmp(cur->buf, word, cur->len < wordLen ? cur->len : wordLen);
+    if(cmp > 0 || (cmp == 0 && cur->len >= wordLen)){
+      return shared;
+    }
+  }
+}
+
+
+/**************** dict_row ****************/
+/* Work out the row of edit distances at depth d (rows[d * (m + 1) + j], from a prefix of d
+ * bytes to the first j bytes of word, for j in [0..m]) from the row before it, for a prefix
+ * whose last byte is c; return the least of them
+ * only the entries with |d - j| <= maxEdits can be within maxEdits, so only those are worked
+ * out: the others stay at maxEdits + 1, which is no more than they are, so an entry worked
+ * out from them is within maxEdits only if it truly is, and then right
+ */
+
+static int
+dict_row(const char* word, const int m, const int maxEdits, int* rows, const int d, const char c){
+  const int* prev = rows + (d - 1) * (m + 1);
+  int* row = rows + d * (m + 1);
+  int lo = d - maxEdits > 1 ? d - maxEdits : 1;
+  int hi = d + maxEdits < m ? d + maxEdits : m;
+  row[0] = d;
+  int least = row[0];
+  for(int j = lo; j <= hi; j++){
+    int edits = prev[j - 1] + (word[j - 1] != c);   // match or substitute
+    if(prev[j] + 1 < edits){                        // delete c
+      edits = prev[j] + 1;
+    }
+    if(row[j - 1] + 1 < edits){                     // insert word[j - 1]
+      edits = row[j - 1] + 1;
+    }
+    row[j] = edits;
+    if(edits < least){
+      least = edits;
+    }
+  }
+  return least;
+}
+
+
+/**************** dict_skip ****************/
+/* Move the cursor past the words that start with its first len + 1 bytes, given that the
+ * rows of its first len bytes are within maxEdits of word and the next is not, to the next
+ * word that can be within maxEdits: the first word not less than the first len bytes followed
+ * by the smallest byte after the next one whose row is within maxEdits, or, if there is none,
+ * the first len - 1 bytes followed by the smallest byte after the byte len - 1 whose row is,
+ * and so on (past the end if none can be); only the bytes of word can do better than any
+ * other byte, so those are the only ones tried past the one after the next byte
+ * next is room for the word sought (maxLen + 1 bytes); returns as dict_seek
+ */
+
+static int
+dict_skip(dict_t* dict, dictcursor_t* cur, const char* word, const int m, const int maxEdits,
+          int* rows, char* next, int len){
+  for(; len >= 0; len--){ // the row at depth len + 1 is worked out again for each byte tried
+    unsigned char after = cur->buf[len];
+    int best = 256; // the smallest byte after cur->buf[len] whose row is within maxEdits
+    if(after < 0xff && dict_row(word, m, maxEdits, rows, len + 1, (char)0) <= maxEdits){
+      best = after + 1; // a byte not in word keeps within maxEdits, so any byte does
+    }
+    int lo = len + 1 - maxEdits > 1 ? len + 1 - maxEdits : 1;
+    int hi = len + 1 + maxEdits < m ? len + 1 + maxEdits : m;
+    for(int j = lo; j <= hi; j++){ // a byte of word further from depth len + 1 does no better than another byte
+      unsigned char c = word[j - 1];
+      if(c > after && c < best && dict_row(word, m, maxEdits, rows, len + 1, (char)c) <= maxEdits){
+        best = c;
+      }
+    }
+    if(best < 256){
+      memcpy(next, cur->buf, len);
+      next[len] = (char)best;
+      return dict_seek(dict, cur, next, len + 1);
+    }
+  }
+  cur->ordinal = dict->n;
+  return 0;
+}
@@ -0,0 +1,124 @@
+/*
+ * dict.h - header file for the dict (term dictionary) module
+ *
+ * a read-only dictionary of the words of an index, in sorted order; each word
+ * is known by its ordinal, its place in that order (which, for an index file
+ * written by the indexer, is also its line in the file).
+ *
+ * The words are front coded in blocks of DICT_BLOCK: the first word of a block
+ * is stored whole, and each other word as the length of the prefix it shares
+ * with the word before it and the rest of the word.  Only the offset of each
+ * block is kept besides, so a lookup is a binary search over the first words
+ * of the blocks and then a scan of one block: O(log n), in a small fraction
+ * of the memory of a hashtable of separately allocated words.  The words
+ * with a given prefix are next to each other in that order, so they are
+ * found by two such searches (dict_range).
+ *
+ * The indexer saves the dictionary of an index beside it (indexFilename.dict)
+ * with dict_save; the querier loads it with dict_load.
+ *
+ * Cooper LaPorte March 2023
+ */
+
+#ifndef __DICT_H
+#define __DICT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/**************** global types ****************/
+typedef struct dict dict_t;  // opaque to users of the module
+
+/**************** dict_filename ****************/
+/* Return the pathname of the dictionary that goes with an index file,
+ * indexFilename.dict; caller must free the pathname.
+ */
+char* dict_filename(const char* indexFilename);
+
+/**************** dict_new ****************/
+/* Create a new (empty) dictionary; caller must later call dict_delete */
+dict_t* dict_new(void);
+
+/**************** dict_add ****************/
+/* Add word to the end of the dictionary; its ordinal is the number of words before it.
+ *
+ * We return:
+ *   true if the word was added
+ *   false if it does not come after the last word added (the words must be
+ *   added in strictly increasing strcmp order)
+ */
+bool dict_add(dict_t* dict, const char* word);
+
+/**************** dict_find ****************/
+/* Return the ordinal of word, or -1 if it is not in the dictionary */
+int dict_find(dict_t* dict, const char* word);
+
+/**************** dict_range ****************/
+/* Return the ordinal of the first word that starts with prefix, and set *end to
+ * one past the ordinal of the last; the words in between are those that start
+ * with prefix, and there are none if the two are the same.
+ */
+int dict_range(dict_t* dict, const char* prefix, int* end);
+
+/**************** dict_fuzzy ****************/
+/* Call itemfunc on each word within maxEdits edits of word, in sorted order.
+ *
+ * Caller provides:
+ *   valid dictionary, word, the most edits (0 or more), arbitrary arg, and
+ *   itemfunc, given arg, the ordinal of the word, the word, and its edits
+ * Notes:
+ *   an edit inserts, deletes or substitutes one byte (Levenshtein distance), so a
+ *   letter outside ASCII (two bytes or more in UTF-8) may take more than one edit;
+ *   the words are walked in sorted order with the rows of the edit distance from
+ *   word to each prefix of the word walked (the states of a Levenshtein automaton),
+ *   kept for the prefix it shares with the word before; once the row of a prefix
+ *   has no entry within maxEdits, no word that starts with it can match, and the walk
+ *   seeks past them all with a binary search, so it reads only the words near word
+ *   and not the whole dictionary; the word passed to itemfunc is only valid
+ *   during the call
+ */
+void dict_fuzzy(dict_t* dict, const char* word, const int maxEdits, void* arg,
+                void (*itemfunc)(void* arg, const int ordinal, const char* word, const int edits));
+
+/**************** dict_size ****************/
+/* Return the number of words in the dictionary */
+int dict_size(dict_t* dict);
+
+/**************** dict_iterate ****************/
+/* Call itemfunc on each word of the dictionary with its ordinal, in order */
+void dict_iterate(dict_t* dict, void* arg,
+                  void (*itemfunc)(void* arg, const int ordinal, const char* word));
+
+/**************** dict_save ****************/
+/* Write the dictionary to file.
+ *
+ * We return:
+ *   true if the file was written, false otherwise
+ */
+bool dict_save(dict_t* dict, const char* file);
+
+/**************** dict_saveIndex ****************/
+/* Write the dictionary of the index file indexFilename to file, reading the words
+ * back one line at a time (the lines are sorted by word, so the ordinal of a word is its line).
+ *
+ * We return:
+ *   true if the file was written, false if the index cannot be read,
+ *   is not sorted by word, or the file cannot be written
+ */
+bool dict_saveIndex(const char* indexFilename, const char* file);
+
+/**************** dict_load ****************/
+/* Read a dictionary written by dict_save.
+ *
+ * We return:
+ *   pointer to the new dictionary, or NULL if the file cannot be read or is
+ *   not a dictionary; caller must later call dict_delete
+ */
+dict_t* dict_load(const char* file);
+
+/**************** dict_delete ****************/
+/* Delete the dictionary */
+void dict_delete(dict_t* dict);
+
+#endif // __DICT_H
@@ -0,0 +1,247 @@
+/*
+ * docs.c - CS50 'docs' module
+ *
+ * see docs.h for more information.
+ *
+ * Cooper LaPorte, March 2023
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "mem.h"
+#include "postings.h"
+#include "termindex.h"
+#include "segment.h"
+#include "docs.h"
+
+
+/**************** local types ****************/
+struct docs {
+  int* lengths;      // lengths[docID], -1 if docID is not in the table
+  int cap;           // size of lengths
+  int maxDoc;        // largest docID in the table
+  int numDocs;
+  long totalWords;   // sum of the lengths
+};
+
+
+static void docs_grow(docs_t* docs, const int docID);
+static void docs_index_helper(void* arg, const int ordinal, const char* word, postings_t* postings);
+static void docs_postings_helper(void* arg, const int key, const int count);
+
+
+/**************** docs_new ****************/
+/* see docs.h for description */
+
+docs_t*
+docs_new(void){
+  docs_t* docs = mem_malloc_assert(sizeof(docs_t), "Error allocating memory");
+  docs->cap = 0;
+  docs->lengths = NULL;
+  docs->maxDoc = 0;
+  docs->numDocs = 0;
+  docs->totalWords = 0;
+  return docs;
+}
+
+
+/**************** docs_filename ****************/
+/* see docs.h for description */
+
+char*
+docs_filename(const char* indexFilename){
+  if(indexFilename == NULL){
+    return NULL;
+  }
+  char* file = mem_malloc_assert(strlen(indexFilename) + 6, "Error allocating memory");
+  if(segment_isIndexDir(indexFilename)){
+    sprintf(file, "%s/docs", indexFilename);
+  } else{
+    sprintf(file, "%s.docs", indexFilename);
+  }
+  return file;
+}
+
+
+/**************** docs_add ****************/
+/* see docs.h for description */
+
+void
+docs_add(docs_t* docs, const int docID, const int length){
+  if(docs == NULL || docID <= 0 || length < 0){
+    return;
+  }
+  docs_grow(docs, docID);
+  if(docs->lengths[docID] < 0){
+    docs->numDocs++;
+  } else{
+    docs->totalWords -= docs->lengths[docID];
+  }
+  docs->lengths[docID] = length;
+  docs->totalWords += length;
+  if(docID > docs->maxDoc){
+    docs->maxDoc = docID;
+  }
+}
+
+
+/**************** docs_load ****************/
+/* see docs.h for description */
+
+docs_t*
+docs_load(const char* file){
+  FILE* fp = file == NULL ? NULL : fopen(file, "r");
+  if(fp == NULL){
+    return NULL;
+  }
+  int numDocs;
+  long totalWords;
+  if(fscanf(fp, "%d %ld", &numDocs, &totalWords) != 2 || numDocs < 0){
+    fclose(fp);
+    return NULL;
+  }
+  docs_t* docs = docs_new();
+  int docID;
+  int length;
+  while(fscanf(fp, "%d %d", &docID, &length) == 2){
+    docs_add(docs, docID, length);
+  }
+  fclose(fp);
+  if(docs->numDocs != numDocs || docs->totalWords != totalWords){ // truncated or corrupt
+    docs_delete(docs);
+    return NULL;
+  }
+  return docs;
+}
+
+
+/**************** docs_fromIndex ****************/
+/* see docs.h for description */
+
+docs_t*
+docs_fromIndex(termindex_t* index){
+  if(index == NULL){
+    return NULL;
+  }
+  docs_t* docs = docs_new();
+  termindex_iterate(index, docs, docs_index_helper);
+  return docs;
+}
+
+
+/**************** docs_save ****************/
+/* see docs.h for description */
+
+bool
+docs_save(docs_t* docs, const char* file){
+  if(docs == NULL || file == NULL){
+    return false;
+  }
+  char* tmp = mem_malloc_assert(strlen(file) + 5, "Error allocating memory");
+  sprintf(tmp, "%s.tmp", file);
+  FILE* fp = fopen(tmp, "w");
+  bool ok = fp != NULL;
+  if(ok){
+    fprintf(fp, "%d %ld\n", docs->numDocs, docs->totalWords);
+    for(int docID = 1; docID <= docs->maxDoc; docID++){
+      if(docs->lengths[docID] >= 0){
+        fprintf(fp, "%d %d\n", docID, docs->lengths[docID]);
+      }
+    }
+    ok = !ferror(fp);
+    ok = (fclose(fp) == 0) && ok;
+    ok = ok && rename(tmp, file) == 0;
+  }
+  mem_free(tmp);
+  return ok;
+}
+
+
+/**************** getters ****************/
+/* see docs.h for description */
+
+int
+docs_length(docs_t* docs, const int docID){
+  if(docs == NULL || docID <= 0 || docID > docs->maxDoc || docs->lengths[docID] < 0){
+    return 0;
+  }
+  return docs->lengths[docID];
+}
+
+bool
+docs_has(docs_t* docs, const int docID){
+  return docs != NULL && docID > 0 && docID <= docs->maxDoc && docs->lengths[docID] >= 0;
+}
+
+int
+docs_numDocs(docs_t* docs){
+  return docs == NULL ? 0 : docs->numDocs;
+}
+
+int
+docs_maxDoc(docs_t* docs){
+  return docs == NULL ? 0 : docs->maxDoc;
+}
+
+double
+docs_avgLength(docs_t* docs){
+  if(docs == NULL || docs->numDocs == 0){
+    return 0;
+  }
+  return (double)docs->totalWords / docs->numDocs;
+}
+
+
+/**************** docs_delete ****************/
+/* see docs.h for description */
+
+void
+docs_delete(docs_t* docs){
+  if(docs != NULL){
+    if(docs->lengths != NULL){
+      mem_free(docs->lengths);
+    }
+    mem_free(docs);
+  }
+}
+
+
+/**************** docs_grow ****************/
+/* make room in the table for docID */
+
+static void
+docs_grow(docs_t* docs, const int docID){
+  if(docID < docs->cap){
+    return;
+  }
+  int cap = docs->cap == 0 ? 1024 : docs->cap;
+  while(cap <= docID){
+    cap *= 2;
+  }
+  docs->lengths = mem_assert(realloc(docs->lengths, cap * sizeof(int)), "Error allocating memory");
+  for(int d = docs->cap; d < cap; d++){
+    docs->lengths[d] = -1;
+  }
+  docs->cap = cap;
+}
+
+
+/**************** docs_index_helper ****************/
+/* Helper function for termindex_iterate to add up the counts of every word */
+
+static void
+docs_index_helper(void* arg, const int ordinal, const char* word, postings_t* postings){
+  postings_iterate(postings, arg, docs_postings_helper);
+}
+
+
+/**************** docs_postings_helper ****************/
+/* Helper function for postings_iterate to add a count to the length of its document */
+
+static void
+docs_postings_helper(void* arg, const int key, const int count){
+  docs_t* docs = arg;
+  docs_add(docs, key, docs_length(docs, key) + count);
+}
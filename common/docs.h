@@ -0,0 +1,106 @@
+/*
+ * docs.h - header file for the docs (document table) module
+ *
+ * keeps the length (number of indexed words) of every document, and the
+ * corpus statistics that go with them, and reads and writes them in a file
+ * beside the index:
+ *
+ *   numDocs totalWords
+ *   docID length
+ *   docID length
+ *   ...
+ *
+ * The indexer writes the file as it indexes pages; the querier reads it to
+ * rank documents with BM25, which normalizes by document length.
+ *
+ * Cooper LaPorte March 2023
+ */
+
+#ifndef __DOCS_H
+#define __DOCS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "termindex.h"
+
+/**************** global types ****************/
+typedef struct docs docs_t;  // opaque to users of the module
+
+/**************** docs_new ****************/
+/* Create a new (empty) document table.
+ * We return:
+ *   pointer to the new table; caller must later call docs_delete
+ */
+docs_t* docs_new(void);
+
+/**************** docs_filename ****************/
+/* Return the pathname of the document table that goes with an index;
+ * that is indexFilename.docs for an index file, or indexDir/docs for an
+ * index directory.  Caller must free the pathname.
+ */
+char* docs_filename(const char* indexFilename);
+
+/**************** docs_add ****************/
+/* Record that the document docID has length indexed words.
+ *
+ * Caller provides:
+ *   valid table, docID > 0, and length >= 0
+ * Notes:
+ *   adding a docID that is already in the table replaces its length
+ */
+void docs_add(docs_t* docs, const int docID, const int length);
+
+/**************** docs_load ****************/
+/* Read a document table from a file written by docs_save.
+ *
+ * We return:
+ *   pointer to the new table, or NULL if the file cannot be read or is malformed
+ */
+docs_t* docs_load(const char* file);
+
+/**************** docs_fromIndex ****************/
+/* Build a document table from an index, for indexes that have no table file;
+ * the length of a document is the sum of the counts of all words in it.
+ *
+ * We return:
+ *   pointer to the new table, or NULL if index is NULL
+ */
+docs_t* docs_fromIndex(termindex_t* index);
+
+/**************** docs_save ****************/
+/* Write the document table to file.
+ *
+ * We return:
+ *   true if the file was written, false otherwise
+ * Notes:
+ *   the file is written under a temporary name and renamed into place,
+ *   so readers never see a partial table
+ */
+bool docs_save(docs_t* docs, const char* file);
+
+/**************** docs_length ****************/
+/* Return the length of docID, or 0 if it is not in the table */
+int docs_length(docs_t* docs, const int docID);
+
+/**************** docs_has ****************/
+/* Return true if docID is in the table (even with length 0) */
+bool docs_has(docs_t* docs, const int docID);
+
+/**************** docs_numDocs ****************/
+/* Return the number of documents in the table */
+int docs_numDocs(docs_t* docs);
+
+/**************** docs_maxDoc ****************/
+/* Return the largest docID in the table (0 if empty) */
+int docs_maxDoc(docs_t* docs);
+
+/**************** docs_avgLength ****************/
+/* Return the average length of the documents in the table (0 if empty) */
+double docs_avgLength(docs_t* docs);
+
+/**************** docs_delete ****************/
+/* Delete the document table */
+void docs_delete(docs_t* docs);
+
+#endif // __DOCS_H
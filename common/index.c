@@ -7,19 +7,80 @@
  */
 
 
+#define _POSIX_C_SOURCE 200809L   // getline, mmap, sysconf
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <limits.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "webpage.h"
 #include "mem.h"
 #include "hashtable.h"
 #include "counters.h"
+#include "file.h"
+#include "index.h"
+
 
+/**************** file-local constants ****************/
+static const int LOAD_THREADS_MAX = 16;            // most threads parsing one index file
+static const size_t LOAD_CHUNK_MIN = 1024 * 1024;  // files are split into chunks no smaller than this
+static const int BYTES_PER_SLOT = 16;              // index bytes per hashtable slot when sizing the hashtable
+
+
+/**************** local types ****************/
+/* loadline: one parsed line of an index file; word points into the mapped file,
+ * and its postings are n of the docIDs and counts of its chunk, from first on
+ */
+typedef struct loadline {
+  const char* word;
+  size_t len;
+  size_t first;
+  int n;
+} loadline_t;
+
+/* loadchunk: the part of an index file parsed by one thread, its lines, and their postings;
+ * the arrays are allocated with plain malloc, as the mem module's counts are not thread-safe
+ */
+typedef struct loadchunk {
+  const char* beg;
+  const char* end;
+  bool threaded;     // parsed by a thread of its own
+  bool ok;           // false if a malformed line was found
+  int n;
+  int cap;
+  loadline_t* lines;
+  size_t numPostings;
+  size_t postingsCap;
+  int* docIDs;
+  int* counts;
+} loadchunk_t;
+
+/* mergecursor: the current line of one index file during index_merge */
+typedef struct mergecursor {
+  FILE* fp;
+  char* line;        // current line, split into word\0postings
+  size_t size;       // size of the line buffer, for getline
+  char* postings;    // the part of the line after the word
+} mergecursor_t;
 
 
 static void printToFile(void* arg, const char* key, void* item);
 static void countersPrint(void* arg, const int key, const int count);
+static void* loadchunk_parse(void* arg);
+static inline bool parseInt(const char** pp, const char* end, int* value);
+static void index_load_helper(void* arg, const char* word, const int* docIDs, const int* counts, const int n);
+static void counters_delete_helper(void* item);
+static bool mergecursor_advance(mergecursor_t* cur);
+static bool mergecursor_shift(mergecursor_t* cur, const int shift, FILE* out);
+static int prune_compare(const void* a, const void* b);
+static bool mergecursor_less(mergecursor_t* curs, const int a, const int b);
+static void heap_down(mergecursor_t* curs, int* heap, const int n, int i);
 
 /**************** index_fill ****************/
 /* see index.h for description */
@@ -36,6 +97,572 @@ index_fill(hashtable_t* index, const char* file){
 }
 
 
+/**************** index_read ****************/
+/* see index.h for description */
+
+hashtable_t*
+index_read(const char* file){
+  int slots = index_slots(file);
+  if(slots <= 0){
+    return NULL;
+  }
+  hashtable_t* index = mem_assert(hashtable_new(slots), "Error allocating memory");
+  if(!index_load(index, file)){
+    hashtable_delete(index, counters_delete_helper);
+    return NULL;
+  }
+  return index;
+}
+
+
+/**************** index_slots ****************/
+/* see index.h for description */
+
+int
+index_slots(const char* file){
+  struct stat st;
+  if(file == NULL || stat(file, &st) != 0){
+    return 0;
+  }
+  return (int)(st.st_size / BYTES_PER_SLOT) + 1;
+}
+
+
+/**************** index_load ****************/
+/* see index.h for description */
+
+bool
+index_load(hashtable_t* index, const char* file){
+  if(index == NULL){
+    return false;
+  }
+  return index_scan(file, index, index_load_helper);
+}
+
+
+/**************** index_scan ****************/
+/* see index.h for description
+ *
+ * the file is mapped into memory and cut into one chunk per thread at line
+ * boundaries; each thread parses its lines with parseInt into arrays of
+ * docIDs and counts (no lookups, so a line takes time in its length), then
+ * the lines are handed to itemfunc in file order, which is the only part
+ * that cannot run in parallel
+ */
+
+bool
+index_scan(const char* file, void* arg,
+           void (*itemfunc)(void* arg, const char* word, const int* docIDs, const int* counts, const int n)){
+  if(file == NULL || itemfunc == NULL){
+    return false;
+  }
+  int fd = open(file, O_RDONLY);
+  if(fd < 0){
+    return false;
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0){
+    close(fd);
+    return false;
+  }
+  size_t size = st.st_size;
+  if(size == 0){ // an empty index
+    close(fd);
+    return true;
+  }
+  char* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // the mapping stays valid
+  if(map == MAP_FAILED){
+    return false;
+  }
+
+  // one chunk per thread, each starting at the beginning of a line
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  int nchunks = (int)(size / LOAD_CHUNK_MIN) + 1;
+  if(nchunks > cpus){
+    nchunks = cpus > 0 ? (int)cpus : 1;
+  }
+  if(nchunks > LOAD_THREADS_MAX){
+    nchunks = LOAD_THREADS_MAX;
+  }
+  loadchunk_t* chunks = mem_calloc_assert(nchunks, sizeof(loadchunk_t), "Error allocating memory");
+  const char* end = map + size;
+  const char* beg = map;
+  for(int c = 0; c < nchunks; c++){
+    const char* cut = (c == nchunks - 1) ? end : map + (size / nchunks) * (c + 1);
+    if(cut < beg){
+      cut = beg;
+    }
+    while(cut < end && cut > map && cut[-1] != '\n'){ // move the cut to the next line
+      cut++;
+    }
+    chunks[c].beg = beg;
+    chunks[c].end = cut;
+    beg = cut;
+  }
+
+  pthread_t* threads = mem_malloc_assert(nchunks * sizeof(pthread_t), "Error allocating memory");
+  int started = 0;
+  for(int c = 1; c < nchunks; c++){ // this thread parses chunk 0 itself
+    if(pthread_create(&threads[c], NULL, loadchunk_parse, &chunks[c]) == 0){
+      chunks[c].threaded = true;
+      started++;
+    } else{
+      loadchunk_parse(&chunks[c]);  // could not start a thread: parse it here
+    }
+  }
+  loadchunk_parse(&chunks[0]);
+  for(int c = 1; c < nchunks; c++){
+    if(chunks[c].threaded){
+      pthread_join(threads[c], NULL);
+    }
+  }
+
+  // hand the parsed lines to itemfunc, in order
+  bool ok = true;
+  size_t keySize = 64;
+  char* key = mem_malloc_assert(keySize, "Error allocating memory");
+  for(int c = 0; c < nchunks; c++){
+    ok = ok && chunks[c].ok;
+    for(int l = 0; ok && l < chunks[c].n; l++){
+      loadline_t* line = &chunks[c].lines[l];
+      if(line->len + 1 > keySize){
+        keySize = line->len + 1;
+        key = mem_assert(realloc(key, keySize), "Error allocating memory");
+      }
+      memcpy(key, line->word, line->len);
+      key[line->len] = '\0';
+      (*itemfunc)(arg, key, &chunks[c].docIDs[line->first], &chunks[c].counts[line->first], line->n);
+    }
+    free(chunks[c].lines);   // allocated by the thread with plain malloc
+    free(chunks[c].docIDs);
+    free(chunks[c].counts);
+  }
+  mem_free(key);
+  mem_free(threads);
+  mem_free(chunks);
+  munmap(map, size);
+  return ok;
+}
+
+
+/**************** loadchunk_parse ****************/
+/* thread function: parse the lines of one chunk of an index file into words and
+ * arrays of docIDs and counts; stops and clears chunk->ok at a malformed line
+ */
+
+static void*
+loadchunk_parse(void* arg){
+  loadchunk_t* chunk = arg;
+  const char* p = chunk->beg;
+  const char* end = chunk->end;
+  chunk->ok = true;
+  chunk->n = 0;
+  chunk->cap = 0;
+  chunk->lines = NULL;
+  chunk->numPostings = 0;
+  chunk->postingsCap = 0;
+  chunk->docIDs = NULL;
+  chunk->counts = NULL;
+  while(p < end){
+    const char* word = p;
+    while(p < end && *p != ' ' && *p != '\n'){
+      p++;
+    }
+    if(p == word){ // empty line: skip it
+      if(p < end){
+        p++;
+      }
+      continue;
+    }
+    if(chunk->n == chunk->cap){
+      chunk->cap = chunk->cap == 0 ? 1024 : chunk->cap * 2;
+      chunk->lines = mem_assert(realloc(chunk->lines, chunk->cap * sizeof(loadline_t)), "Error allocating memory");
+    }
+    loadline_t* line = &chunk->lines[chunk->n++];
+    line->word = word;
+    line->len = p - word;
+    line->first = chunk->numPostings;
+    line->n = 0;
+    while(true){ // docID count pairs
+      while(p < end && *p == ' '){
+        p++;
+      }
+      if(p == end || *p == '\n'){
+        break;
+      }
+      if(chunk->numPostings == chunk->postingsCap){
+        chunk->postingsCap = chunk->postingsCap == 0 ? 4096 : chunk->postingsCap * 2;
+        chunk->docIDs = mem_assert(realloc(chunk->docIDs, chunk->postingsCap * sizeof(int)), "Error allocating memory");
+        chunk->counts = mem_assert(realloc(chunk->counts, chunk->postingsCap * sizeof(int)), "Error allocating memory");
+      }
+      if(!parseInt(&p, end, &chunk->docIDs[chunk->numPostings])
+         || !parseInt(&p, end, &chunk->counts[chunk->numPostings])){
+        chunk->ok = false;
+        return NULL;
+      }
+      chunk->numPostings++;
+      line->n++;
+    }
+    if(p < end){
+      p++;  // the newline
+    }
+  }
+  return NULL;
+}
+
+
+/**************** parseInt ****************/
+/* skip spaces and read a non-negative decimal number at *pp, moving *pp past it;
+ * returns false if the line ends first, something other than digits is there, or the
+ * number is larger than INT_MAX (*pp is then left at the digit that would overflow)
+ */
+
+static inline bool
+parseInt(const char** pp, const char* end, int* value){
+  const char* p = *pp;
+  while(p < end && *p == ' '){
+    p++;
+  }
+  if(p == end || *p < '0' || *p > '9'){
+    *pp = p;
+    return false;
+  }
+  int v = 0;
+  while(p < end && *p >= '0' && *p <= '9'){
+    int digit = *p - '0';
+    if(v > (INT_MAX - digit) / 10){
+      *pp = p;
+      return false;
+    }
+    v = v * 10 + digit;
+    p++;
+  }
+  *pp = p;
+  *value = v;
+  return p == end || *p == ' ' || *p == '\n';
+}
+
+
+/**************** index_load_helper ****************/
+/* Helper function for index_scan to put a word and its postings into the hashtable;
+ * the word may already have postings from another file, which are added to
+ */
+
+static void
+index_load_helper(void* arg, const char* word, const int* docIDs, const int* counts, const int n){
+  hashtable_t* index = arg;
+  counters_t* ctrs = hashtable_find(index, word);
+  if(ctrs == NULL){
+    ctrs = mem_assert(counters_new(), "Error allocating memory");
+    if(!hashtable_insert(index, word, ctrs)){
+      mem_assert(NULL, "Error allocating memory");
+    }
+  }
+  for(int i = 0; i < n; i++){
+    if(!counters_set(ctrs, docIDs[i], counts[i])){
+      mem_assert(NULL, "Error allocating memory");
+    }
+  }
+}
+
+
+/**************** counters_delete_helper ****************/
+/* Helper function for hashtable_delete on an index */
+
+static void
+counters_delete_helper(void* item){
+  counters_t* ctrs = item;
+  counters_delete(ctrs);
+}
+
+
+/**************** index_merge ****************/
+/* see index.h for description
+ *
+ * a min-heap of cursors, one per input file, is ordered by (word, file number);
+ * all the lines for the smallest word come off the heap in file order, and their
+ * postings are concatenated after a single copy of the word
+ */
+
+bool
+index_merge(const char** files, const int k, const char* file){
+  return index_mergeShift(files, k, NULL, file);
+}
+
+
+/**************** index_mergeShift ****************/
+/* see index.h for description
+ *
+ * a min-heap of cursors, one per input file, is ordered by (word, file number);
+ * all the lines for the smallest word come off the heap in file order, and their
+ * postings are concatenated after a single copy of the word (rewritten with their
+ * docIDs shifted, for a file with a shift); a file whose next word is not after
+ * the word just written is out of order, and fails the merge
+ */
+
+bool
+index_mergeShift(const char** files, const int k, const int* shifts, const char* file){
+  if(files == NULL || k <= 0 || file == NULL){
+    return false;
+  }
+  FILE* out = fopen(file, "w");
+  if(out == NULL){
+    return false;
+  }
+  mergecursor_t* curs = mem_calloc_assert(k, sizeof(mergecursor_t), "Error allocating memory");
+  int* heap = mem_malloc_assert(k * sizeof(int), "Error allocating memory");
+  int n = 0;
+  bool ok = true;
+  for(int f = 0; f < k; f++){
+    curs[f].fp = fopen(files[f], "r");
+    if(curs[f].fp == NULL){
+      ok = false;
+    } else if(mergecursor_advance(&curs[f])){
+      heap[n++] = f;
+    }
+  }
+  for(int i = n / 2 - 1; i >= 0; i--){
+    heap_down(curs, heap, n, i);
+  }
+
+  while(ok && n > 0){
+    mergecursor_t* top = &curs[heap[0]];
+    char* word = mem_malloc_assert(strlen(top->line) + 1, "Error allocating memory");
+    strcpy(word, top->line);
+    fprintf(out, "%s ", word);
+    while(ok && n > 0 && strcmp(curs[heap[0]].line, word) == 0){
+      int f = heap[0];
+      mergecursor_t* cur = &curs[f];
+      if(shifts == NULL || shifts[f] == 0){
+        fputs(cur->postings, out);
+      } else{
+        ok = mergecursor_shift(cur, shifts[f], out);
+      }
+      if(!mergecursor_advance(cur)){ // this file is done: shrink the heap
+        heap[0] = heap[--n];
+      } else if(strcmp(cur->line, word) <= 0){ // not sorted by word
+        ok = false;
+      }
+      heap_down(curs, heap, n, 0);
+    }
+    fprintf(out, "\n");
+    mem_free(word);
+  }
+
+  for(int f = 0; f < k; f++){
+    if(curs[f].fp != NULL){
+      fclose(curs[f].fp);
+    }
+    free(curs[f].line); // allocated by getline
+  }
+  mem_free(curs);
+  mem_free(heap);
+  ok = ok && !ferror(out);
+  if(fclose(out) != 0){
+    ok = false;
+  }
+  return ok;
+}
+
+
+/**************** index_prune ****************/
+/* see index.h for description
+ *
+ * each line is read with a mergecursor, its postings parsed into arrays that grow to
+ * the longest line, and z found by sorting a copy of the scores
+ */
+
+bool
+index_prune(const char* file, const char* prunedFile, const char* dfFile, const int k,
+            const double fraction, const double threshold, void* arg,
+            double (*scorefunc)(void* arg, const int df, const int docID, const int count),
+            long* kept, long* total){
+  if(file == NULL || prunedFile == NULL || k <= 0 || fraction < 0 || fraction > 1 || threshold < 0){
+    return false;
+  }
+  mergecursor_t cur = { fopen(file, "r"), NULL, 0, NULL };
+  if(cur.fp == NULL){
+    return false;
+  }
+  FILE* out = fopen(prunedFile, "w");
+  FILE* dfs = dfFile == NULL ? NULL : fopen(dfFile, "w");
+  if(out == NULL || (dfFile != NULL && dfs == NULL)){
+    fclose(cur.fp);
+    if(out != NULL){
+      fclose(out);
+    }
+    return false;
+  }
+  int cap = 64;
+  int* docIDs = mem_malloc_assert(cap * sizeof(int), "Error allocating memory");
+  int* counts = mem_malloc_assert(cap * sizeof(int), "Error allocating memory");
+  double* scores = mem_malloc_assert(cap * sizeof(double), "Error allocating memory");
+  double* sorted = mem_malloc_assert(cap * sizeof(double), "Error allocating memory");
+  long nKept = 0;
+  long nTotal = 0;
+  bool ok = true;
+  while(ok && mergecursor_advance(&cur)){
+    const char* p = cur.postings;
+    const char* end = p + strlen(p);
+    int n = 0;
+    int docID;
+    while(ok && parseInt(&p, end, &docID)){
+      if(n == cap){
+        cap *= 2;
+        docIDs = mem_assert(realloc(docIDs, cap * sizeof(int)), "Error allocating memory");
+        counts = mem_assert(realloc(counts, cap * sizeof(int)), "Error allocating memory");
+        scores = mem_assert(realloc(scores, cap * sizeof(double)), "Error allocating memory");
+        sorted = mem_assert(realloc(sorted, cap * sizeof(double)), "Error allocating memory");
+      }
+      docIDs[n] = docID;
+      ok = parseInt(&p, end, &counts[n]);
+      n++;
+    }
+    if(!ok || p != end || n == 0){ // not docID count pairs
+      ok = false;
+      break;
+    }
+    for(int i = 0; i < n; i++){
+      scores[i] = scorefunc == NULL ? counts[i] : scorefunc(arg, n, docIDs[i], counts[i]);
+      sorted[i] = scores[i];
+    }
+    qsort(sorted, n, sizeof(double), prune_compare);
+    double z = sorted[(n < k ? n : k) - 1];
+    double cut = fraction * z > threshold ? fraction * z : threshold;
+    if(cut > z){
+      cut = z;
+    }
+    fprintf(out, "%s ", cur.line);
+    for(int i = 0; i < n; i++){
+      if(scores[i] >= cut){
+        fprintf(out, "%d %d ", docIDs[i], counts[i]);
+        nKept++;
+      }
+    }
+    fprintf(out, "\n");
+    if(dfs != NULL){
+      fprintf(dfs, "%d\n", n);
+    }
+    nTotal += n;
+  }
+  fclose(cur.fp);
+  free(cur.line); // allocated by getline
+  mem_free(docIDs);
+  mem_free(counts);
+  mem_free(scores);
+  mem_free(sorted);
+  ok = ok && !ferror(out);
+  if(fclose(out) != 0){
+    ok = false;
+  }
+  if(dfs != NULL){
+    ok = ok && !ferror(dfs);
+    if(fclose(dfs) != 0){
+      ok = false;
+    }
+  }
+  if(kept != NULL){
+    *kept = nKept;
+  }
+  if(total != NULL){
+    *total = nTotal;
+  }
+  return ok;
+}
+
+
+/**************** prune_compare ****************/
+/* qsort order for index_prune: scores from highest to lowest */
+
+static int
+prune_compare(const void* a, const void* b){
+  double x = *(const double*)a;
+  double y = *(const double*)b;
+  return (x < y) - (x > y);
+}
+
+
+/**************** mergecursor_advance ****************/
+/* read the next line of the file, splitting it into word and postings;
+ * returns false at end of the file
+ */
+
+static bool
+mergecursor_advance(mergecursor_t* cur){
+  ssize_t len;
+  while((len = getline(&cur->line, &cur->size, cur->fp)) > 0){
+    if(cur->line[len - 1] == '\n'){
+      cur->line[--len] = '\0';
+    }
+    char* space = strchr(cur->line, ' ');
+    if(space != NULL){
+      *space = '\0';
+      cur->postings = space + 1;
+      return true;
+    } // skip malformed (empty) lines
+  }
+  return false;
+}
+
+
+/**************** mergecursor_shift ****************/
+/* write the postings of the current line to out with shift added to each docID;
+ * returns false if the postings are not docID count pairs
+ */
+
+static bool
+mergecursor_shift(mergecursor_t* cur, const int shift, FILE* out){
+  const char* p = cur->postings;
+  const char* end = p + strlen(p);
+  int docID;
+  int count;
+  while(parseInt(&p, end, &docID)){
+    if(!parseInt(&p, end, &count) || docID <= 0 || docID > INT_MAX - shift){
+      return false;
+    }
+    fprintf(out, "%d %d ", docID + shift, count);
+  }
+  return p == end; // parseInt stops at the end, or at something that is not a number
+}
+
+
+/**************** mergecursor_less ****************/
+/* heap order: by word, then by file number */
+
+static bool
+mergecursor_less(mergecursor_t* curs, const int a, const int b){
+  int cmp = strcmp(curs[a].line, curs[b].line);
+  return cmp < 0 || (cmp == 0 && a < b);
+}
+
+
+/**************** heap_down ****************/
+/* restore the heap below position i */
+
+static void
+heap_down(mergecursor_t* curs, int* heap, const int n, int i){
+  while(true){
+    int min = i;
+    int left = 2 * i + 1;
+    int right = left + 1;
+    if(left < n && mergecursor_less(curs, heap[left], heap[min])){
+      min = left;
+    }
+    if(right < n && mergecursor_less(curs, heap[right], heap[min])){
+      min = right;
+    }
+    if(min == i){
+      return;
+    }
+    int tmp = heap[i];
+    heap[i] = heap[min];
+    heap[min] = tmp;
+    i = min;
+  }
+}
+
+
 /**************** printToFile ****************/
 /* helper function passed into hashtable iterate to print the word then associated docIDs and counts */
 
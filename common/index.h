@@ -3,11 +3,15 @@
  *
  * can take a path to a file and an index hashtable with the node pairs being a word and a counters with each counters key being a docID
  * it will print the hashtable in a specific form in the file
+ * it can also load such a file back into a hashtable, and merge several
+ * sorted index files into one
  * 
  *
  * Cooper LaPorte Febuary 2023
  */
 
+#ifndef __INDEX_H
+#define __INDEX_H
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -32,4 +36,136 @@
  *   False if the hashtable is null
  */
 
-bool index_fill(hashtable_t* index, const char* file);
\ No newline at end of file
+bool index_fill(hashtable_t* index, const char* file);
+
+
+/**************** index_read ****************/
+/* Create a hashtable of the form used by index_fill from an index file
+ *
+ * Caller provides:
+ *   Pathname of a readable index file
+ * Returns:
+ *   the new hashtable (caller must delete it and its counters)
+ *   NULL if the file cannot be read or is malformed
+ */
+hashtable_t* index_read(const char* file);
+
+
+/**************** index_slots ****************/
+/* Suggest how many hashtable slots to use for the words of an index file
+ *
+ * Caller provides:
+ *   Pathname of an index file
+ * Notes:
+ *   the estimate comes from the size of the file, so the file is not read
+ * Returns:
+ *   number of slots, or 0 if the file cannot be found
+ */
+int index_slots(const char* file);
+
+
+/**************** index_load ****************/
+/* Load an index file into a hashtable of the form used by index_fill
+ *
+ * Caller provides:
+ *   Valid hashtable (possibly holding words already) and pathname of a readable index file
+ * Notes:
+ *   if a word of the file is already in the hashtable, its docIDs and counts
+ *   are added to the counters of that word
+ *   the file is mapped into memory and its lines are parsed by several threads
+ * Returns:
+ *   True if the file was read into the hashtable
+ *   False if the hashtable or file is null, the file cannot be opened, or a line
+ *   is malformed (the lines before it may have been loaded)
+ */
+bool index_load(hashtable_t* index, const char* file);
+
+
+/**************** index_scan ****************/
+/* Call itemfunc on each line of an index file, in file order
+ *
+ * Caller provides:
+ *   Pathname of a readable index file, arbitrary arg, and the function to call
+ * Notes:
+ *   itemfunc gets the word of the line and the n docIDs and counts of the line, in
+ *   the order of the line; the word and the arrays are only good during the call
+ *   the file is mapped into memory and its lines are parsed by several threads
+ * Returns:
+ *   True if every line of the file was read
+ *   False if the file is null, cannot be opened, or a line is malformed (anything but
+ *   docID count pairs of numbers up to INT_MAX after the word)
+ *   (itemfunc may have been called on the lines before it)
+ */
+bool index_scan(const char* file, void* arg,
+                void (*itemfunc)(void* arg, const char* word, const int* docIDs, const int* counts, const int n));
+
+
+/**************** index_merge ****************/
+/* Merge k index files, each sorted by word, into one sorted index file
+ *
+ * Caller provides:
+ *   Array of k pathnames of readable sorted index files, and a pathname to write
+ * Notes:
+ *   when a word appears in several files, its postings are written in the order
+ *   of the files; so if every docID of files[i] is less than every docID of files[i+1],
+ *   each line of the result keeps its docIDs in increasing order
+ *   reads each file one line at a time, so memory does not grow with the size of the files
+ * Returns:
+ *   True if the merged index was written
+ *   False if any file could not be opened, read, or written
+ */
+bool index_merge(const char** files, const int k, const char* file);
+
+
+/**************** index_mergeShift ****************/
+/* Merge k index files, each sorted by word, into one sorted index file, adding
+ * shifts[i] to every docID read from files[i]
+ *
+ * Caller provides:
+ *   as for index_merge, and an array of k shifts (or NULL for none)
+ * Notes:
+ *   with shifts[i+1] at least shifts[i] plus the largest docID of files[i], the
+ *   docIDs of the files cannot collide and each line of the result keeps its docIDs
+ *   in increasing order; this is how separate indexes are combined into one
+ *   reads each file one line at a time, so memory does not grow with the size of the files
+ * Returns:
+ *   True if the merged index was written
+ *   False if any file could not be opened, read, or written, has a malformed line,
+ *   or is not sorted by word
+ */
+bool index_mergeShift(const char** files, const int k, const int* shifts, const char* file);
+
+
+/**************** index_prune ****************/
+/* Copy an index file, dropping the postings of each word that score too low to matter
+ *
+ * Caller provides:
+ *   pathname of a readable index file, a pathname to write the pruned index to,
+ *   a pathname to write the document frequency table to (or NULL for none),
+ *   k (1 or more), fraction (0 to 1) and threshold (0 or more), an arg and a scorefunc
+ *   giving the score of a posting (a docID and count of a word in df documents),
+ *   or NULL to score each posting by its count; kept and total may be NULL
+ * We do:
+ *   for each word, find z, the score of its kth best posting (its worst, if it has k
+ *   or fewer), and keep the postings scoring at least the smaller of z and the larger
+ *   of fraction * z and threshold; every other posting of the word is dropped
+ * Notes:
+ *   the postings scoring z or more are always kept (ties too), so for a query of one
+ *   word the k best documents and their order are the same with the pruned index;
+ *   with fraction 1 and threshold 0 each word keeps just those
+ *   every word keeps at least one posting, so the words of the index are unchanged
+ *   the table has the number of documents each word was in before pruning (one per line,
+ *   in the order of the words; see bm25_loadDf), so BM25 can score the pruned index as
+ *   it scored the index
+ *   reads the file one line at a time, so memory does not grow with the size of the file
+ *   *kept and *total are set to the number of postings kept and read
+ * Returns:
+ *   True if the pruned index was written
+ *   False if the file could not be opened, read, or written, or has a malformed line
+ */
+bool index_prune(const char* file, const char* prunedFile, const char* dfFile, const int k,
+                 const double fraction, const double threshold, void* arg,
+                 double (*scorefunc)(void* arg, const int df, const int docID, const int count),
+                 long* kept, long* total);
+
+#endif // __INDEX_H
@@ -0,0 +1,394 @@
+/*
+ * lexer.c - CS50 'lexer' module
+ *
+ * see lexer.h for more information.
+ *
+ * Cooper LaPorte, March 2023
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "memtag.h"
+#include "lexer.h"
+
+
+/**************** file-local constants ****************/
+/* the kinds of byte that are not letters; letters are their lowercase selves, from 'a' */
+enum { L_END, L_SEP, L_TAG, L_ENT, L_HI };
+
+/* what each byte is: an ASCII letter folded to lowercase, the end of the page,
+ * a separator, the start of a tag or an entity, or a byte of a UTF-8 sequence
+ */
+static const unsigned char LEX[256] = {
+  L_END, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP,   // 0x00
+  L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP,   // 0x10
+  L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_ENT, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP,   // 0x20
+  L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_SEP, L_TAG, L_SEP, L_SEP, L_SEP,   // 0x30
+  L_SEP,   'a',   'b',   'c',   'd',   'e',   'f',   'g',   'h',   'i',   'j',   'k',   'l',   'm',   'n',   'o',   // 0x40
+    'p',   'q',   'r',   's',   't',   'u',   'v',   'w',   'x',   'y',   'z', L_SEP, L_SEP, L_SEP, L_SEP, L_SEP,   // 0x50
+  L_SEP,   'a',   'b',   'c',   'd',   'e',   'f',   'g',   'h',   'i',   'j',   'k',   'l',   'm',   'n',   'o',   // 0x60
+    'p',   'q',   'r',   's',   't',   'u',   'v',   'w',   'x',   'y',   'z', L_SEP, L_SEP, L_SEP, L_SEP, L_SEP,   // 0x70
+  L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI ,   // 0x80
+  L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI ,   // 0x90
+  L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI ,   // 0xA0
+  L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI ,   // 0xB0
+  L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI ,   // 0xC0
+  L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI ,   // 0xD0
+  L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI ,   // 0xE0
+  L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI , L_HI ,   // 0xF0
+};
+
+static const int ENTITY_MAX = 10;    // longest entity name we look for
+static const int WORD_MIN = 64;      // initial size of the word buffer
+
+/* the names of the entities for U+00C0 to U+00FF (all letters but times and divide) */
+static const char* LATIN1[64] = {
+  "Agrave", "Aacute", "Acirc", "Atilde", "Auml", "Aring", "AElig", "Ccedil",
+  "Egrave", "Eacute", "Ecirc", "Euml", "Igrave", "Iacute", "Icirc", "Iuml",
+  "ETH", "Ntilde", "Ograve", "Oacute", "Ocirc", "Otilde", "Ouml", "times",
+  "Oslash", "Ugrave", "Uacute", "Ucirc", "Uuml", "Yacute", "THORN", "szlig",
+  "agrave", "aacute", "acirc", "atilde", "auml", "aring", "aelig", "ccedil",
+  "egrave", "eacute", "ecirc", "euml", "igrave", "iacute", "icirc", "iuml",
+  "eth", "ntilde", "ograve", "oacute", "ocirc", "otilde", "ouml", "divide",
+  "oslash", "ugrave", "uacute", "ucirc", "uuml", "yacute", "thorn", "yuml"
+};
+
+
+/**************** local types ****************/
+struct lexer {
+  char* buf;      // the word being built
+  size_t cap;     // size of buf
+};
+
+
+static void lexer_put(lexer_t* lex, const size_t len, const unsigned char c);
+static int lexer_utf8(const unsigned char* p, int* bytes);
+static int lexer_entity(const unsigned char* p, int* bytes);
+static bool lexer_isLetter(const int cp);
+static int lexer_encode(const int cp, unsigned char* out);
+static size_t lexer_skipTag(const unsigned char* doc, size_t i);
+static bool lexer_tagIs(const unsigned char* p, const char* name);
+
+
+/**************** lexer_new ****************/
+/* see lexer.h for description */
+
+lexer_t*
+lexer_new(void){
+  lexer_t* lex = memtag_malloc(MEMTAG_TOKENIZER, sizeof(lexer_t), "Error allocating memory");
+  lex->cap = WORD_MIN;
+  lex->buf = memtag_malloc(MEMTAG_TOKENIZER, lex->cap, "Error allocating memory");
+  return lex;
+}
+
+
+/**************** lexer_next ****************/
+/* see lexer.h for description
+ *
+ * letters are copied (folded) into the buffer one table lookup at a time; a word
+ * ends at the first byte that is not part of a letter, and that byte is left for
+ * the next call, so a '<' right after a word is skipped as a tag next time
+ */
+
+char*
+lexer_next(lexer_t* lex, const char* html, int* pos, int* letters){
+  if(lex == NULL || html == NULL || pos == NULL){
+    return NULL;
+  }
+  const unsigned char* doc = (const unsigned char*)html;
+  size_t i = *pos;
+  size_t len = 0;    // bytes of the word so far
+  int count = 0;     // letters of the word so far
+  while(true){
+    unsigned char c = LEX[doc[i]];
+    if(c >= 'a'){ // an ASCII letter
+      lexer_put(lex, len++, c);
+      count++;
+      i++;
+      continue;
+    }
+    int bytes = 1;
+    int cp = -1;   // the character, if the bytes at i are one that may be a letter
+    if(c == L_HI){
+      cp = lexer_utf8(doc + i, &bytes);
+    } else if(c == L_ENT){
+      cp = lexer_entity(doc + i, &bytes);
+    }
+    if(cp >= 0 && cp < 0x80 && LEX[cp] >= 'a'){ // an entity for an ASCII letter
+      lexer_put(lex, len++, LEX[cp]);
+      count++;
+      i += bytes;
+    } else if(cp >= 0x80 && lexer_isLetter(cp)){
+      unsigned char utf8[4];
+      int n = c == L_HI ? bytes : lexer_encode(cp, utf8);
+      const unsigned char* from = c == L_HI ? doc + i : utf8;
+      for(int b = 0; b < n; b++){
+        lexer_put(lex, len++, from[b]);
+      }
+      count++;
+      i += bytes;
+    } else if(len > 0){ // the end of the word
+      break;
+    } else if(c == L_END){
+      *pos = i;
+      return NULL;
+    } else if(c == L_TAG){
+      i = lexer_skipTag(doc, i);
+    } else{
+      i += bytes;
+    }
+  }
+  lexer_put(lex, len, '\0');
+  *pos = i;
+  if(letters != NULL){
+    *letters = count;
+  }
+  return lex->buf;
+}
+
+
+/**************** lexer_isWord ****************/
+/* see lexer.h for description */
+
+bool
+lexer_isWord(const char* text){
+  if(text == NULL || text[0] == '\0'){
+    return false;
+  }
+  const unsigned char* p = (const unsigned char*)text;
+  while(*p != '\0'){
+    int bytes = 1;
+    if(LEX[*p] == L_HI){
+      int cp = lexer_utf8(p, &bytes);
+      if(cp < 0 || !lexer_isLetter(cp)){
+        return false;
+      }
+    } else if(LEX[*p] < 'a'){
+      return false;
+    }
+    p += bytes;
+  }
+  return true;
+}
+
+
+/**************** lexer_delete ****************/
+/* see lexer.h for description */
+
+void
+lexer_delete(lexer_t* lex){
+  if(lex != NULL){
+    memtag_free(lex->buf);
+    memtag_free(lex);
+  }
+}
+
+
+/**************** lexer_put ****************/
+/* Put byte c at place len of the word, growing the buffer if need be */
+
+static void
+lexer_put(lexer_t* lex, const size_t len, const unsigned char c){
+  if(len == lex->cap){
+    lex->cap *= 2;
+    lex->buf = memtag_realloc(MEMTAG_TOKENIZER, lex->buf, lex->cap, "Error allocating memory");
+  }
+  lex->buf[len] = c;
+}
+
+
+/**************** lexer_utf8 ****************/
+/* Decode the UTF-8 sequence at p, setting *bytes to its length;
+ * returns the character, or -1 (with *bytes 1) if p is not a whole, shortest sequence
+ */
+
+static int
+lexer_utf8(const unsigned char* p, int* bytes){
+  int n;
+  int cp;
+  if(p[0] >= 0xc2 && p[0] <= 0xdf){
+    n = 2;
+    cp = p[0] & 0x1f;
+  } else if(p[0] >= 0xe0 && p[0] <= 0xef){
+    n = 3;
+    cp = p[0] & 0x0f;
+  } else if(p[0] >= 0xf0 && p[0] <= 0xf4){
+    n = 4;
+    cp = p[0] & 0x07;
+  } else{ // a continuation byte, or a byte that never starts a sequence
+    *bytes = 1;
+    return -1;
+  }
+  for(int b = 1; b < n; b++){
+    if((p[b] & 0xc0) != 0x80){ // (which also stops at the end of the page)
+      *bytes = 1;
+      return -1;
+    }
+    cp = (cp << 6) | (p[b] & 0x3f);
+  }
+  if((n == 3 && cp < 0x800) || (n == 4 && (cp < 0x10000 || cp > 0x10ffff))
+     || (cp >= 0xd800 && cp <= 0xdfff)){ // too long, too large, or a surrogate
+    *bytes = 1;
+    return -1;
+  }
+  *bytes = n;
+  return cp;
+}
+
+
+/**************** lexer_entity ****************/
+/* Decode the entity at p (at its '&'), setting *bytes to its length: &#decimal; or
+ * &#xhex; (the ';' may be left off), or &name; for a named one
+ * returns the character, 0 for a named entity we do not know (the entity is still
+ * skipped, as a separator), or -1 (with *bytes 1) if p is not an entity
+ */
+
+static int
+lexer_entity(const unsigned char* p, int* bytes){
+  int i = 1;
+  int cp = 0;
+  if(p[1] == '#'){
+    bool hex = p[2] == 'x' || p[2] == 'X';
+    i = hex ? 3 : 2;
+    int digits = 0;
+    while(digits < 7){
+      int d = -1;
+      if(p[i] >= '0' && p[i] <= '9'){
+        d = p[i] - '0';
+      } else if(hex && LEX[p[i]] >= 'a' && LEX[p[i]] <= 'f'){
+        d = LEX[p[i]] - 'a' + 10;
+      }
+      if(d < 0){
+        break;
+      }
+      cp = cp * (hex ? 16 : 10) + d;
+      digits++;
+      i++;
+    }
+    if(digits == 0 || cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff)){
+      *bytes = 1;
+      return -1;
+    }
+    *bytes = p[i] == ';' ? i + 1 : i;
+    return cp;
+  }
+  while(i <= ENTITY_MAX && (LEX[p[i]] >= 'a' || (p[i] >= '0' && p[i] <= '9'))){
+    i++;
+  }
+  if(i == 1 || p[i] != ';'){
+    *bytes = 1;
+    return -1;
+  }
+  *bytes = i + 1;
+  int n = i - 1;
+  const char* name = (const char*)p + 1;
+  for(int c = 0; c < 64; c++){
+    if((int)strlen(LATIN1[c]) == n && strncmp(LATIN1[c], name, n) == 0){
+      return 0xc0 + c;
+    }
+  }
+  return 0; // &amp; &nbsp; &mdash; and the rest
+}
+
+
+/**************** lexer_isLetter ****************/
+/* Return true if the character cp (0x80 or more) is a letter: we take every character
+ * but the Latin-1 controls, spaces and symbols, the general punctuation, symbols,
+ * arrows and shapes (U+2000 to U+2BFF), CJK punctuation, private use, the specials,
+ * and the emoji and other symbols from U+1F000
+ */
+
+static bool
+lexer_isLetter(const int cp){
+  if(cp < 0xc0){ // but for the feminine and masculine ordinals, and micro
+    return cp == 0xaa || cp == 0xb5 || cp == 0xba;
+  }
+  return cp != 0xd7 && cp != 0xf7
+         && !(cp >= 0x2000 && cp <= 0x2bff)
+         && !(cp >= 0x3000 && cp <= 0x303f)
+         && !(cp >= 0xe000 && cp <= 0xf8ff)
+         && !(cp >= 0xfe00 && cp <= 0xfe0f)
+         && !(cp >= 0xfff0)
+         && cp != 0xfeff
+         && !(cp >= 0x1f000 && cp <= 0x1faff);
+}
+
+
+/**************** lexer_encode ****************/
+/* Write the character cp (0x80 or more) to out as UTF-8; returns the number of bytes */
+
+static int
+lexer_encode(const int cp, unsigned char* out){
+  if(cp < 0x800){
+    out[0] = 0xc0 | (cp >> 6);
+    out[1] = 0x80 | (cp & 0x3f);
+    return 2;
+  }
+  if(cp < 0x10000){
+    out[0] = 0xe0 | (cp >> 12);
+    out[1] = 0x80 | ((cp >> 6) & 0x3f);
+    out[2] = 0x80 | (cp & 0x3f);
+    return 3;
+  }
+  out[0] = 0xf0 | (cp >> 18);
+  out[1] = 0x80 | ((cp >> 12) & 0x3f);
+  out[2] = 0x80 | ((cp >> 6) & 0x3f);
+  out[3] = 0x80 | (cp & 0x3f);
+  return 4;
+}
+
+
+/**************** lexer_skipTag ****************/
+/* Skip the tag that starts at doc[i] (a '<'), matching it with the next '>' as
+ * webpage_getNextWord did; a comment <!-- ... --> is skipped to its -->, and the tag
+ * <script> or <style> to the end of its closing tag, with its body
+ * returns the place after what was skipped (the end of the page if it runs out)
+ */
+
+static size_t
+lexer_skipTag(const unsigned char* doc, size_t i){
+  const char* at = (const char*)doc + i;
+  if(strncmp(at, "<!--", 4) == 0){
+    const char* end = strstr(at + 4, "-->");
+    return end == NULL ? i + strlen(at) : (end + 3) - (const char*)doc;
+  }
+  const char* name = lexer_tagIs(doc + i + 1, "script") ? "script"
+                     : lexer_tagIs(doc + i + 1, "style") ? "style" : NULL;
+  const char* end = strchr(at, '>');
+  if(end == NULL){
+    return i + strlen(at);
+  }
+  if(name != NULL && end[-1] != '/'){ // skip the body, to the closing tag
+    const char* close = end;
+    while((close = strchr(close + 1, '<')) != NULL
+          && !(close[1] == '/' && lexer_tagIs((const unsigned char*)close + 2, name))){
+    }
+    if(close == NULL){
+      return i + strlen(at);
+    }
+    end = strchr(close, '>');
+    if(end == NULL){
+      return (close - (const char*)doc) + strlen(close);
+    }
+  }
+  return (end + 1) - (const char*)doc;
+}
+
+
+/**************** lexer_tagIs ****************/
+/* Return true if the tag name at p is name (in any case) */
+
+static bool
+lexer_tagIs(const unsigned char* p, const char* name){
+  int n = 0;
+  while(name[n] != '\0'){
+    if(LEX[p[n]] != (unsigned char)name[n]){
+      return false;
+    }
+    n++;
+  }
+  return p[n] == '>' || p[n] == '/' || p[n] == ' ' || p[n] == '\t' || p[n] == '\n'
+         || p[n] == '\r' || p[n] == '\f';
+}
@@ -0,0 +1,62 @@
+/*
+ * lexer.h - header file for the lexer (HTML word scanner) module
+ *
+ * finds the words of an HTML page, in place of webpage_getNextWord: a word is
+ * a run of letters, where a letter is an ASCII letter, a UTF-8 encoded letter
+ * (any character outside ASCII but for spaces, punctuation and symbols such as
+ * U+00A0, U+00AB, U+2014 and the emoji), or an HTML entity for one of them
+ * (&eacute; or &#233;).  Other entities (&amp;, &nbsp;, ...) separate words,
+ * as other characters do, instead of leaving their names as words.  Words are
+ * returned with their ASCII letters folded to lowercase; other letters are
+ * kept as they are.  Tags, comments, and the bodies of <script> and <style>
+ * are skipped.
+ *
+ * The scan is driven by a table with one entry per byte, giving a letter
+ * folded to lowercase or the kind of any other byte, so each byte of the page
+ * costs one lookup; only '<', '&' and bytes outside ASCII leave the loop.
+ *
+ * Cooper LaPorte March 2023
+ */
+
+#ifndef __LEXER_H
+#define __LEXER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/**************** global types ****************/
+typedef struct lexer lexer_t;  // opaque to users of the module
+
+/**************** lexer_new ****************/
+/* Create a new lexer (the buffer the words are built in);
+ * caller must later call lexer_delete
+ */
+lexer_t* lexer_new(void);
+
+/**************** lexer_next ****************/
+/* Find the next word of html, starting at *pos.
+ *
+ * Caller provides:
+ *   a lexer, the html of a page, and *pos (0 to start at the beginning)
+ * We return:
+ *   the word, folded to lowercase, or NULL when there are no more words;
+ *   *pos is moved past the word, and *letters (when not NULL) is set to
+ *   the number of letters (characters, not bytes) in the word
+ * Notes:
+ *   the word is in the buffer of the lexer, and is only good until the next call
+ *   (copy it to keep it); *pos is never left inside a tag
+ */
+char* lexer_next(lexer_t* lex, const char* html, int* pos, int* letters);
+
+/**************** lexer_isWord ****************/
+/* Return true if text is exactly one word, as lexer_next finds them in plain text
+ * (letters only: no tags or entities)
+ */
+bool lexer_isWord(const char* text);
+
+/**************** lexer_delete ****************/
+/* Delete the lexer */
+void lexer_delete(lexer_t* lex);
+
+#endif // __LEXER_H
@@ -0,0 +1,185 @@
+/*
+ * memtag.c - CS50 'memtag' module
+ *
+ * see memtag.h for more information.
+ *
+ * Cooper LaPorte, March 2023
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "memtag.h"
+
+
+/**************** local types ****************/
+/* memhead: the size and tag kept just before a block, padded so the block stays aligned */
+typedef union memhead {
+  struct {
+    size_t size;
+    memtag_t tag;
+  } info;
+  max_align_t align;
+} memhead_t;
+
+/* memcount: the counters of one tag */
+typedef struct memcount {
+  atomic_llong current;
+  atomic_llong peak;
+  atomic_llong allocs;
+  atomic_llong frees;
+} memcount_t;
+
+/**************** file-local global variables ****************/
+static memcount_t counts[MEMTAG_COUNT];   // static, so all zero
+static const char* names[MEMTAG_COUNT] = {
+  "other", "fetch", "frontier", "tokenizer", "dictionary", "postings", "query"
+};
+
+static void memtag_add(const memtag_t tag, const long long bytes);
+static void memtag_exit_helper(void);
+static void* memtag_check(void* ptr, const char* message);
+
+
+/**************** memtag_malloc ****************/
+/* see memtag.h for description */
+void*
+memtag_malloc(const memtag_t tag, const size_t size, const char* message){
+  memhead_t* head = memtag_check(malloc(sizeof(memhead_t) + size), message);
+  head->info.size = size;
+  head->info.tag = tag;
+  atomic_fetch_add_explicit(&counts[tag].allocs, 1, memory_order_relaxed);
+  memtag_add(tag, size);
+  return head + 1;
+}
+
+/**************** memtag_calloc ****************/
+/* see memtag.h for description */
+void*
+memtag_calloc(const memtag_t tag, const size_t nmemb, const size_t size, const char* message){
+  if(size != 0 && nmemb > ((size_t)-1 - sizeof(memhead_t)) / size){
+    memtag_check(NULL, message);
+  }
+  memhead_t* head = memtag_check(calloc(1, sizeof(memhead_t) + nmemb * size), message);
+  head->info.size = nmemb * size;
+  head->info.tag = tag;
+  atomic_fetch_add_explicit(&counts[tag].allocs, 1, memory_order_relaxed);
+  memtag_add(tag, nmemb * size);
+  return head + 1;
+}
+
+/**************** memtag_realloc ****************/
+/* see memtag.h for description */
+void*
+memtag_realloc(const memtag_t tag, void* ptr, const size_t size, const char* message){
+  if(ptr == NULL){
+    return memtag_malloc(tag, size, message);
+  }
+  memhead_t* head = (memhead_t*)ptr - 1;
+  size_t old = head->info.size;
+  head = memtag_check(realloc(head, sizeof(memhead_t) + size), message);
+  head->info.size = size;
+  memtag_add(head->info.tag, (long long)size - (long long)old);
+  return head + 1;
+}
+
+/**************** memtag_free ****************/
+/* see memtag.h for description */
+void
+memtag_free(void* ptr){
+  if(ptr != NULL){
+    memhead_t* head = (memhead_t*)ptr - 1;
+    atomic_fetch_add_explicit(&counts[head->info.tag].frees, 1, memory_order_relaxed);
+    memtag_add(head->info.tag, -(long long)head->info.size);
+    free(head);
+  }
+}
+
+/**************** memtag_charge ****************/
+/* see memtag.h for description */
+void
+memtag_charge(const memtag_t tag, const size_t bytes){
+  atomic_fetch_add_explicit(&counts[tag].allocs, 1, memory_order_relaxed);
+  memtag_add(tag, bytes);
+}
+
+/**************** memtag_release ****************/
+/* see memtag.h for description */
+void
+memtag_release(const memtag_t tag, const size_t bytes){
+  atomic_fetch_add_explicit(&counts[tag].frees, 1, memory_order_relaxed);
+  memtag_add(tag, -(long long)bytes);
+}
+
+/**************** memtag_stats ****************/
+/* see memtag.h for description */
+memtag_stats_t
+memtag_stats(const memtag_t tag){
+  memtag_stats_t stats = {
+    atomic_load_explicit(&counts[tag].current, memory_order_relaxed),
+    atomic_load_explicit(&counts[tag].peak, memory_order_relaxed),
+    atomic_load_explicit(&counts[tag].allocs, memory_order_relaxed),
+    atomic_load_explicit(&counts[tag].frees, memory_order_relaxed)
+  };
+  return stats;
+}
+
+/**************** memtag_name ****************/
+/* see memtag.h for description */
+const char*
+memtag_name(const memtag_t tag){
+  return (int)tag >= 0 && tag < MEMTAG_COUNT ? names[tag] : "unknown";
+}
+
+/**************** memtag_report ****************/
+/* see memtag.h for description */
+void
+memtag_report(FILE* fp, const char* message){
+  fprintf(fp, "%s:\n", message);
+  fprintf(fp, "  %-10s %14s %14s %12s %12s\n", "tag", "current", "peak", "allocs", "frees");
+  for(int tag = 0; tag < MEMTAG_COUNT; tag++){
+    memtag_stats_t stats = memtag_stats(tag);
+    fprintf(fp, "  %-10s %14lld %14lld %12lld %12lld\n", names[tag],
+            stats.current, stats.peak, stats.allocs, stats.frees);
+  }
+}
+
+/**************** memtag_atexit ****************/
+/* see memtag.h for description */
+void
+memtag_atexit(void){
+  if(getenv("TSE_MEMSTATS") != NULL){
+    atexit(memtag_exit_helper);
+  }
+}
+
+/**************** memtag_exit_helper ****************/
+/* Print the report when the program exits */
+static void
+memtag_exit_helper(void){
+  memtag_report(stderr, "memory by subsystem (bytes)");
+}
+
+/**************** memtag_add ****************/
+/* Add bytes (which may be negative) to the bytes held by tag, raising its peak if need be */
+static void
+memtag_add(const memtag_t tag, const long long bytes){
+  long long now = atomic_fetch_add_explicit(&counts[tag].current, bytes, memory_order_relaxed) + bytes;
+  long long peak = atomic_load_explicit(&counts[tag].peak, memory_order_relaxed);
+  while(now > peak && !atomic_compare_exchange_weak_explicit(&counts[tag].peak, &peak, now,
+                                                             memory_order_relaxed, memory_order_relaxed)){
+    // peak now holds the peak another thread set; try again while ours is higher
+  }
+}
+
+/**************** memtag_check ****************/
+/* Exit with message if ptr is NULL (as mem_malloc_assert does), otherwise return it */
+static void*
+memtag_check(void* ptr, const char* message){
+  if(ptr == NULL){
+    fprintf(stderr, "Out of memory: %s\n", message);
+    exit(99);
+  }
+  return ptr;
+}
@@ -0,0 +1,108 @@
+/*
+ * memtag.h - header file for the memtag (tagged memory accounting) module
+ *
+ * counts the memory held by each subsystem of the search engine: the pages
+ * fetched, the crawl frontier, the tokenizer, the dictionary, the postings
+ * and the queries.  For every tag we keep the bytes held now, the most bytes
+ * ever held at once, and the number of allocations and frees, so a report
+ * shows which structure is driving memory growth.
+ *
+ * Memory allocated with memtag_malloc/calloc/realloc carries its size and tag
+ * just before the block, so memtag_free and memtag_realloc know what to take
+ * back off; such memory must be freed with memtag_free (never mem_free or
+ * free), and memory from anywhere else must never be given to memtag_free.
+ * Memory allocated elsewhere (e.g. the HTML of a page, allocated by libcs50)
+ * can still be counted against a tag with memtag_charge and memtag_release.
+ *
+ * The counters are atomic, so any thread may allocate, free or read them
+ * without a lock.  The libcs50 mem module keeps counting its own calls as
+ * before; we do not change it (see libcs50/README.md).
+ *
+ * Cooper LaPorte March 2023
+ */
+
+#ifndef __MEMTAG_H
+#define __MEMTAG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/**************** global types ****************/
+/* the subsystems memory is counted against */
+typedef enum memtag {
+  MEMTAG_OTHER,        // anything not tagged below
+  MEMTAG_FETCH,        // pages fetched or read from a page directory
+  MEMTAG_FRONTIER,     // URLs waiting to be crawled or already seen by the crawler
+  MEMTAG_TOKENIZER,    // words being normalized
+  MEMTAG_DICTIONARY,   // the front-coded dictionary of words
+  MEMTAG_POSTINGS,     // postings lists, positions and blocks
+  MEMTAG_QUERY,        // scores, heaps and results of queries
+  MEMTAG_COUNT         // the number of tags, not a tag
+} memtag_t;
+
+/* a snapshot of the counters of one tag */
+typedef struct memtag_stats {
+  long long current;   // bytes held now
+  long long peak;      // most bytes held at once
+  long long allocs;    // number of allocations (resizing one does not count)
+  long long frees;     // number of frees
+} memtag_stats_t;
+
+/**************** memtag_malloc ****************/
+/* Like mem_malloc_assert, counting size bytes against tag.
+ *
+ * Caller provides:
+ *   a tag, the size wanted, and a message for the error if memory runs out
+ * We return:
+ *   the new memory; we exit with an error if there is none
+ * Notes:
+ *   free it with memtag_free
+ */
+void* memtag_malloc(const memtag_t tag, const size_t size, const char* message);
+
+/**************** memtag_calloc ****************/
+/* Like mem_calloc_assert, counting nmemb*size bytes against tag */
+void* memtag_calloc(const memtag_t tag, const size_t nmemb, const size_t size, const char* message);
+
+/**************** memtag_realloc ****************/
+/* Like realloc, for memory from memtag_malloc/calloc/realloc (or NULL, to allocate anew).
+ *
+ * We return:
+ *   the resized memory, still counted against the tag it was allocated with
+ *   (or against tag, when ptr is NULL); we exit with an error if there is none
+ */
+void* memtag_realloc(const memtag_t tag, void* ptr, const size_t size, const char* message);
+
+/**************** memtag_free ****************/
+/* Free memory from memtag_malloc/calloc/realloc, taking it off the tag it was counted against;
+ * ignores NULL.
+ */
+void memtag_free(void* ptr);
+
+/**************** memtag_charge ****************/
+/* Count bytes of memory allocated elsewhere against tag (as one allocation) */
+void memtag_charge(const memtag_t tag, const size_t bytes);
+
+/**************** memtag_release ****************/
+/* Take bytes charged with memtag_charge back off tag (as one free) */
+void memtag_release(const memtag_t tag, const size_t bytes);
+
+/**************** memtag_stats ****************/
+/* Return a snapshot of the counters of tag */
+memtag_stats_t memtag_stats(const memtag_t tag);
+
+/**************** memtag_name ****************/
+/* Return the name of tag, e.g. "postings" */
+const char* memtag_name(const memtag_t tag);
+
+/**************** memtag_report ****************/
+/* Print the counters of every tag to fp, one line each after a line with message */
+void memtag_report(FILE* fp, const char* message);
+
+/**************** memtag_atexit ****************/
+/* Print memtag_report to stderr when the program exits, if the environment variable
+ * TSE_MEMSTATS is set (to anything); call it once, at the start of main.
+ */
+void memtag_atexit(void);
+
+#endif // __MEMTAG_H
@@ -61,16 +61,21 @@ pagedir_hasCrawler(const char* pageDirectory){
 /**************** pagedir_save ****************/
 /* see pagedir.h for description */
 
-void
+bool
 pagedir_save(const webpage_t* page, const char* pageDirectory, const int docID){
    if(page != NULL && pageDirectory != NULL && docID >= 0){
-      char* path = mem_malloc(strlen(pageDirectory) + sizeof(docID) + 1);
+      char* path = mem_malloc_assert(strlen(pageDirectory) + 12, "*** out of memory"); // room for '/', the digits of docID, and '\0'
       sprintf(path, "%s/%d", pageDirectory, docID);
       FILE* fp = fopen(path, "w");
       mem_free(path);
+      if(fp == NULL){
+         fprintf(stderr, "*** could not write page %d to %s\n", docID, pageDirectory);
+         return false;
+      }
       fprintf(fp, "%s\n", webpage_getURL(page));
       fprintf(fp, "%d\n", webpage_getDepth(page));
       fprintf(fp, "%s", webpage_getHTML(page));
-      fclose(fp);
+      return fclose(fp) == 0;
    }
+   return false;
 }
\ No newline at end of file
@@ -47,7 +47,10 @@ bool pagedir_hasCrawler(const char* pageDirectory);
  *
  * Caller provides:
  *   Valid webpage_t, directory, and docID
+ * We return:
+ *   true if the page was written
+ *   false if the arguments are bad or the file could not be written
  * Notes:
  *   File will be created and will have the URL, the depth, and the contents of the webpage
  */
-void pagedir_save(const webpage_t* page, const char* pageDirectory, const int docID);
+bool pagedir_save(const webpage_t* page, const char* pageDirectory, const int docID);
@@ -0,0 +1,866 @@
+/*
+ * positions.c - CS50 'positions' module
+ *
+ * see positions.h for more information.
+ *
+ * Cooper LaPorte, March 2023
+ */
+
+#define _POSIX_C_SOURCE 200809L   // mmap
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mem.h"
+#include "memtag.h"
+#include "hashtable.h"
+#include "counters.h"
+#include "positions.h"
+
+
+/**************** file-local constants ****************/
+static const char MAGIC[8] = "TSEPOS1\n";   // header of a positions file
+static const int POSITIONS_SLOTS = 65536;    // hashtable slots while building
+static const size_t WORD_OVERHEAD = 96;      // estimated bytes of hashtable node, key copy, and poslist per word
+static const size_t COPY_CHUNK = 65536;      // bytes of a run copied at a time while merging
+
+
+/**************** local types ****************/
+/* poslist: the encoded positions of one word while building;
+ * the positions in the current document are kept decoded in cur until
+ * the next document starts, since their encoded length comes first
+ */
+typedef struct poslist {
+  unsigned char* buf;   // encoded documents so far
+  size_t len;
+  size_t cap;
+  int numDocs;          // documents in buf
+  int prevDoc;          // last docID in buf
+  int curDoc;           // docID of the positions in cur, 0 if none
+  int* cur;
+  int ncur;
+  int curcap;
+} poslist_t;
+
+struct positions {
+  hashtable_t* ht;      // word -> poslist_t
+  int numWords;
+  char* file;           // the positions file; runs go beside it, as file.run0, file.run1, ...
+  size_t budget;        // 0 means unlimited
+  size_t used;          // estimated bytes used by the positions in memory
+  int numRuns;          // number of runs written so far
+  int lastDoc;          // docID of the most recent position
+};
+
+/* posrun: the current record of one run while the runs are merged; a run is written as
+ * a positions file, but each record is the word, the number of documents, the last docID,
+ * and the length of the documents, so the records of a word can be joined without decoding them
+ */
+typedef struct posrun {
+  FILE* fp;
+  char* word;           // the word of the current record, NULL past the last
+  size_t wordCap;
+  unsigned int numDocs;
+  unsigned int lastDoc;
+  unsigned int firstDoc; // the first docID gap of the documents, which is the first docID
+  size_t left;          // bytes of the documents after the first docID gap
+} posrun_t;
+
+/* posrec: where the record of one word is in a loaded file */
+typedef struct posrec {
+  const unsigned char* p;     // first document
+  const unsigned char* end;
+  int numDocs;
+} posrec_t;
+
+struct posindex {
+  unsigned char* map;
+  size_t size;
+  hashtable_t* ht;      // word -> posrec_t
+};
+
+/* poscursor: a walk over the documents of one word in a phrase */
+typedef struct poscursor {
+  const unsigned char* p;
+  const unsigned char* end;
+  int left;             // documents not yet read
+  int docID;            // current document, INT_MAX when done
+  int npos;
+  const unsigned char* pos;   // encoded positions of the current document
+  int offset;           // offset of the word in the phrase
+  int* decoded;         // positions of the current document, when decoded
+  int cap;
+} poscursor_t;
+
+/* wordarray: the words of the positions being gathered from the hashtable to sort them */
+typedef struct wordarray {
+  int n;
+  const char** words;
+} wordarray_t;
+
+
+static bool positions_flush(positions_t* pos, const char* file, const bool run);
+static char* positions_runName(positions_t* pos, const int run);
+static bool positions_merge(positions_t* pos);
+static bool posrun_advance(posrun_t* r);
+static bool posrun_less(posrun_t* runs, const int a, const int b);
+static void posrun_down(posrun_t* runs, int* heap, const int n, int i);
+static void posrun_up(posrun_t* runs, int* heap, int i);
+static bool varint_read(FILE* fp, unsigned int* value, int* bytes);
+static poslist_t* poslist_new(void);
+static void poslist_flush(poslist_t* pl);
+static void poslist_delete(void* item);
+static void poslist_put(poslist_t* pl, unsigned int value);
+static int varint_size(unsigned int value);
+static inline bool varint_get(const unsigned char** pp, const unsigned char* end, unsigned int* value);
+static void wordarray_helper(void* arg, const char* key, void* item);
+static int word_cmp(const void* a, const void* b);
+static void poscursor_advance(poscursor_t* c);
+static bool poscursor_decode(poscursor_t* c);
+static int phrase_count(poscursor_t* curs, const int n);
+
+
+/**************** positions_filename ****************/
+/* see positions.h for description */
+
+char*
+positions_filename(const char* indexFilename){
+  if(indexFilename == NULL){
+    return NULL;
+  }
+  char* file = mem_malloc_assert(strlen(indexFilename) + 5, "Error allocating memory");
+  sprintf(file, "%s.pos", indexFilename);
+  return file;
+}
+
+
+/**************** positions_new ****************/
+/* see positions.h for description */
+
+positions_t*
+positions_new(const char* file, const size_t budget){
+  if(file == NULL){
+    return NULL;
+  }
+  positions_t* pos = mem_malloc_assert(sizeof(positions_t), "Error allocating memory");
+  pos->ht = mem_assert(hashtable_new(POSITIONS_SLOTS), "Error allocating memory");
+  pos->numWords = 0;
+  pos->file = mem_malloc_assert(strlen(file) + 1, "Error allocating memory");
+  strcpy(pos->file, file);
+  pos->budget = budget;
+  pos->used = 0;
+  pos->numRuns = 0;
+  pos->lastDoc = 0;
+  return pos;
+}
+
+
+/**************** positions_add ****************/
+/* see positions.h for description */
+
+bool
+positions_add(positions_t* pos, const char* word, const int docID, const int position){
+  if(pos == NULL || word == NULL || docID <= 0 || position < 0){
+    return false;
+  }
+  if(pos->budget != 0 && pos->used >= pos->budget && docID != pos->lastDoc){
+    // over budget: write what we have as a sorted run and start over, between
+    // documents, so the positions of a word in a document are never split across runs
+    char* run = positions_runName(pos, pos->numRuns);
+    bool ok = positions_flush(pos, run, true);
+    mem_free(run);
+    pos->numRuns++;
+    if(!ok){
+      return false;
+    }
+  }
+  pos->lastDoc = docID;
+  poslist_t* pl = hashtable_find(pos->ht, word);
+  if(pl == NULL){
+    pl = poslist_new();
+    if(!hashtable_insert(pos->ht, word, pl)){
+      mem_assert(NULL, "Error allocating memory");
+    }
+    pos->numWords++;
+    pos->used += strlen(word) + 1 + WORD_OVERHEAD + pl->cap + pl->curcap * sizeof(int);
+  }
+  size_t before = pl->cap + pl->curcap * sizeof(int);
+  if(pl->curDoc != docID){
+    poslist_flush(pl);
+    pl->curDoc = docID;
+  }
+  if(pl->ncur == pl->curcap){
+    pl->curcap *= 2;
+    pl->cur = memtag_realloc(MEMTAG_POSTINGS, pl->cur, pl->curcap * sizeof(int), "Error allocating memory");
+  }
+  pl->cur[pl->ncur++] = position;
+  pos->used += pl->cap + pl->curcap * sizeof(int) - before;
+  return true;
+}
+
+
+/**************** positions_save ****************/
+/* see positions.h for description */
+
+bool
+positions_save(positions_t* pos){
+  if(pos == NULL){
+    return false;
+  }
+  if(pos->numRuns == 0){ // everything fit in memory: write the positions file directly
+    return positions_flush(pos, pos->file, false);
+  }
+  bool ok = true;
+  if(pos->numWords > 0){ // the last partial run
+    char* run = positions_runName(pos, pos->numRuns);
+    ok = positions_flush(pos, run, true);
+    mem_free(run);
+    pos->numRuns++;
+  }
+  return ok && positions_merge(pos);
+}
+
+
+/**************** positions_delete ****************/
+/* see positions.h for description */
+
+void
+positions_delete(positions_t* pos){
+  if(pos != NULL){
+    for(int r = 0; r < pos->numRuns; r++){ // runs are no longer needed
+      char* run = positions_runName(pos, r);
+      remove(run);
+      mem_free(run);
+    }
+    hashtable_delete(pos->ht, poslist_delete);
+    mem_free(pos->file);
+    mem_free(pos);
+  }
+}
+
+
+/**************** positions_flush ****************/
+/* sort the positions in memory by word and write them to file, as a positions file or,
+ * for a run, with the number of documents, the last docID and the length of the documents
+ * in front of the documents of each word (see posrun_t); then empty the positions in memory
+ */
+
+static bool
+positions_flush(positions_t* pos, const char* file, const bool run){
+  FILE* fp = fopen(file, "w");
+  if(fp == NULL){
+    return false;
+  }
+  wordarray_t words = { 0, mem_malloc_assert((pos->numWords + 1) * sizeof(char*), "Error allocating memory") };
+  hashtable_iterate(pos->ht, &words, wordarray_helper);
+  qsort(words.words, words.n, sizeof(char*), word_cmp);
+  fwrite(MAGIC, 1, sizeof(MAGIC), fp);
+  poslist_t* head = poslist_new(); // scratch buffer for the varints in front of each record
+  for(int i = 0; i < words.n; i++){
+    poslist_t* pl = hashtable_find(pos->ht, words.words[i]);
+    poslist_flush(pl);
+    head->len = 0;
+    if(run){
+      poslist_put(head, pl->numDocs);
+      poslist_put(head, pl->prevDoc);
+      poslist_put(head, pl->len);
+    } else{
+      poslist_put(head, varint_size(pl->numDocs) + pl->len);
+      poslist_put(head, pl->numDocs);
+    }
+    fwrite(words.words[i], 1, strlen(words.words[i]) + 1, fp);
+    fwrite(head->buf, 1, head->len, fp);
+    fwrite(pl->buf, 1, pl->len, fp);
+  }
+  poslist_delete(head);
+  mem_free(words.words);
+  bool ok = !ferror(fp);
+  ok = (fclose(fp) == 0) && ok;
+  hashtable_delete(pos->ht, poslist_delete); // start over with no positions in memory
+  pos->ht = mem_assert(hashtable_new(POSITIONS_SLOTS), "Error allocating memory");
+  pos->numWords = 0;
+  pos->used = 0;
+  return ok;
+}
+
+
+/**************** positions_runName ****************/
+/* build the pathname of a run file; caller must free it */
+
+static char*
+positions_runName(positions_t* pos, const int run){
+  char* name = mem_malloc_assert(strlen(pos->file) + 20, "Error allocating memory");
+  sprintf(name, "%s.run%d", pos->file, run);
+  return name;
+}
+
+
+/**************** positions_merge ****************/
+/* merge the runs into the positions file, a word at a time: a min-heap of the runs is
+ * ordered by (word, run number), and the records of a word are written as one, in run
+ * order; the runs were written in docID order, so only the first docID gap of each record
+ * after the first changes (to the gap from the last docID of the record before it), and
+ * the rest of its documents are copied as they are, without decoding them
+ */
+
+static bool
+positions_merge(positions_t* pos){
+  FILE* out = fopen(pos->file, "w");
+  if(out == NULL){
+    return false;
+  }
+  int k = pos->numRuns;
+  posrun_t* runs = mem_calloc_assert(k, sizeof(posrun_t), "Error allocating memory");
+  int* heap = mem_malloc_assert(k * sizeof(int), "Error allocating memory");
+  int* same = mem_malloc_assert(k * sizeof(int), "Error allocating memory");
+  unsigned char* copy = mem_malloc_assert(COPY_CHUNK, "Error allocating memory");
+  int n = 0;
+  bool ok = true;
+  for(int r = 0; r < k; r++){
+    char* name = positions_runName(pos, r);
+    runs[r].fp = fopen(name, "r");
+    mem_free(name);
+    char magic[sizeof(MAGIC)];
+    if(runs[r].fp == NULL || fread(magic, 1, sizeof(magic), runs[r].fp) != sizeof(magic)){
+      ok = false;
+    } else if(posrun_advance(&runs[r])){
+      heap[n++] = r;
+    }
+  }
+  for(int i = n / 2 - 1; i >= 0; i--){
+    posrun_down(runs, heap, n, i);
+  }
+  fwrite(MAGIC, 1, sizeof(MAGIC), out);
+  poslist_t* head = poslist_new(); // scratch buffer for the varints in front of each record
+  while(ok && n > 0){
+    // the runs with the smallest word come off the heap in run order
+    int m = 0;
+    same[m++] = heap[0];
+    heap[0] = heap[--n];
+    posrun_down(runs, heap, n, 0);
+    while(n > 0 && strcmp(runs[heap[0]].word, runs[same[0]].word) == 0){
+      same[m++] = heap[0];
+      heap[0] = heap[--n];
+      posrun_down(runs, heap, n, 0);
+    }
+    unsigned int numDocs = 0;
+    size_t len = 0;
+    for(int i = 0; i < m; i++){
+      posrun_t* r = &runs[same[i]];
+      unsigned int gap = r->firstDoc - (i == 0 ? 0 : runs[same[i - 1]].lastDoc);
+      numDocs += r->numDocs;
+      len += varint_size(gap) + r->left;
+    }
+    head->len = 0;
+    poslist_put(head, varint_size(numDocs) + len);
+    poslist_put(head, numDocs);
+    fwrite(runs[same[0]].word, 1, strlen(runs[same[0]].word) + 1, out);
+    fwrite(head->buf, 1, head->len, out);
+    for(int i = 0; ok && i < m; i++){
+      posrun_t* r = &runs[same[i]];
+      head->len = 0;
+      poslist_put(head, r->firstDoc - (i == 0 ? 0 : runs[same[i - 1]].lastDoc));
+      fwrite(head->buf, 1, head->len, out);
+      while(ok && r->left > 0){
+        size_t chunk = r->left < COPY_CHUNK ? r->left : COPY_CHUNK;
+        ok = fread(copy, 1, chunk, r->fp) == chunk && fwrite(copy, 1, chunk, out) == chunk;
+        r->left -= chunk;
+      }
+    }
+    for(int i = 0; i < m; i++){ // on to the next record of each run
+      if(posrun_advance(&runs[same[i]])){
+        heap[n++] = same[i];
+        posrun_up(runs, heap, n - 1);
+      }
+    }
+  }
+  poslist_delete(head);
+  for(int r = 0; r < k; r++){
+    if(runs[r].fp != NULL){
+      fclose(runs[r].fp);
+    }
+    free(runs[r].word); // allocated by realloc
+  }
+  mem_free(runs);
+  mem_free(heap);
+  mem_free(same);
+  mem_free(copy);
+  ok = ok && !ferror(out);
+  ok = (fclose(out) == 0) && ok;
+  return ok;
+}
+
+
+/**************** posrun_advance ****************/
+/* read the head of the next record of a run, up to and including the first docID gap;
+ * returns false at the end of the run (word is then NULL), or if the record is cut short
+ */
+
+static bool
+posrun_advance(posrun_t* r){
+  size_t len = 0;
+  int c;
+  while((c = getc(r->fp)) != EOF && c != '\0'){
+    if(len + 2 > r->wordCap){
+      r->wordCap = r->wordCap == 0 ? 64 : 2 * r->wordCap;
+      r->word = mem_assert(realloc(r->word, r->wordCap), "Error allocating memory");
+    }
+    r->word[len++] = c;
+  }
+  unsigned int bodyLen;
+  int bytes;
+  if(c == EOF || len == 0 || !varint_read(r->fp, &r->numDocs, NULL) || !varint_read(r->fp, &r->lastDoc, NULL)
+     || !varint_read(r->fp, &bodyLen, NULL) || !varint_read(r->fp, &r->firstDoc, &bytes) || (unsigned int)bytes > bodyLen){
+    free(r->word);
+    r->word = NULL;
+    r->wordCap = 0;
+    return false;
+  }
+  r->word[len] = '\0';
+  r->left = bodyLen - bytes;
+  return true;
+}
+
+
+/**************** posrun_less ****************/
+/* heap order: by word, then by run number */
+
+static bool
+posrun_less(posrun_t* runs, const int a, const int b){
+  int cmp = strcmp(runs[a].word, runs[b].word);
+  return cmp < 0 || (cmp == 0 && a < b);
+}
+
+
+/**************** posrun_down ****************/
+/* restore the heap below position i */
+
+static void
+posrun_down(posrun_t* runs, int* heap, const int n, int i){
+  while(true){
+    int min = i;
+    int left = 2 * i + 1;
+    int right = left + 1;
+    if(left < n && posrun_less(runs, heap[left], heap[min])){
+      min = left;
+    }
+    if(right < n && posrun_less(runs, heap[right], heap[min])){
+      min = right;
+    }
+    if(min == i){
+      return;
+    }
+    int tmp = heap[i];
+    heap[i] = heap[min];
+    heap[min] = tmp;
+    i = min;
+  }
+}
+
+
+/**************** posrun_up ****************/
+/* restore the heap above position i */
+
+static void
+posrun_up(posrun_t* runs, int* heap, int i){
+  while(i > 0 && posrun_less(runs, heap[i], heap[(i - 1) / 2])){
+    int tmp = heap[i];
+    heap[i] = heap[(i - 1) / 2];
+    heap[(i - 1) / 2] = tmp;
+    i = (i - 1) / 2;
+  }
+}
+
+
+/**************** varint_read ****************/
+/* Read a varint from fp into value, and its number of bytes into *bytes (if not NULL);
+ * return false if there is no complete varint there
+ */
+
+static bool
+varint_read(FILE* fp, unsigned int* value, int* bytes){
+  unsigned int v = 0;
+  int shift = 0;
+  int c;
+  while(shift < 35 && (c = getc(fp)) != EOF){
+    v |= (unsigned int)(c & 0x7f) << shift;
+    shift += 7;
+    if((c & 0x80) == 0){
+      *value = v;
+      if(bytes != NULL){
+        *bytes = shift / 7;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+
+/**************** positions_load ****************/
+/* see positions.h for description */
+
+posindex_t*
+positions_load(const char* file, const int slots){
+  int fd = file == NULL ? -1 : open(file, O_RDONLY);
+  if(fd < 0){
+    return NULL;
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(MAGIC)){
+    close(fd);
+    return NULL;
+  }
+  size_t size = st.st_size;
+  unsigned char* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED){
+    return NULL;
+  }
+  if(memcmp(map, MAGIC, sizeof(MAGIC)) != 0){
+    munmap(map, size);
+    return NULL;
+  }
+  posindex_t* pi = mem_malloc_assert(sizeof(posindex_t), "Error allocating memory");
+  pi->map = map;
+  pi->size = size;
+  pi->ht = mem_assert(hashtable_new(slots > 0 ? slots : 1), "Error allocating memory");
+  const unsigned char* p = map + sizeof(MAGIC);
+  const unsigned char* end = map + size;
+  while(p < end){ // step from record to record, reading only the word and the record length
+    const unsigned char* word = p;
+    const unsigned char* nul = memchr(p, '\0', end - p);
+    unsigned int len = 0;
+    unsigned int numDocs = 0;
+    bool ok = nul != NULL;
+    if(ok){
+      p = nul + 1;
+      ok = varint_get(&p, end, &len) && len <= end - p;
+    }
+    const unsigned char* rec = p;
+    if(!ok || !varint_get(&rec, p + len, &numDocs)){
+      positions_unload(pi);   // malformed file
+      return NULL;
+    }
+    posrec_t* pr = mem_malloc_assert(sizeof(posrec_t), "Error allocating memory");
+    pr->p = rec;
+    pr->end = p + len;
+    pr->numDocs = numDocs;
+    if(!hashtable_insert(pi->ht, (const char*)word, pr)){
+      mem_free(pr);
+    }
+    p += len;
+  }
+  return pi;
+}
+
+
+/**************** positions_phrase ****************/
+/* see positions.h for description */
+
+counters_t*
+positions_phrase(posindex_t* pi, const char** words, const int* offsets, const int n){
+  if(pi == NULL || words == NULL || offsets == NULL || n <= 0){
+    return NULL;
+  }
+  poscursor_t* curs = mem_malloc_assert(n * sizeof(poscursor_t), "Error allocating memory");
+  bool any = true;
+  for(int i = 0; i < n; i++){
+    posrec_t* pr = hashtable_find(pi->ht, words[i]);
+    curs[i].decoded = NULL;
+    curs[i].cap = 0;
+    curs[i].offset = offsets[i];
+    if(pr == NULL){
+      any = false;
+      curs[i].left = 0;
+      curs[i].docID = INT_MAX;
+      continue;
+    }
+    curs[i].p = pr->p;
+    curs[i].end = pr->end;
+    curs[i].left = pr->numDocs;
+    curs[i].docID = 0;
+    poscursor_advance(&curs[i]);
+  }
+  counters_t* found = NULL;
+  while(any){
+    // intersect: move every cursor up to the largest current docID
+    int target = 0;
+    for(int i = 0; i < n; i++){
+      if(curs[i].docID > target){
+        target = curs[i].docID;
+      }
+    }
+    if(target == INT_MAX){
+      break;
+    }
+    bool all = true;
+    for(int i = 0; i < n; i++){
+      while(curs[i].docID < target){
+        poscursor_advance(&curs[i]);
+      }
+      if(curs[i].docID != target){
+        all = false;
+      }
+    }
+    if(!all){
+      continue;
+    }
+    // every word is in target: now look at the positions
+    int count = phrase_count(curs, n);
+    if(count > 0){
+      if(found == NULL){
+        found = mem_assert(counters_new(), "Error allocating memory");
+      }
+      counters_set(found, target, count);
+    }
+    for(int i = 0; i < n; i++){
+      poscursor_advance(&curs[i]);
+    }
+  }
+  for(int i = 0; i < n; i++){
+    if(curs[i].decoded != NULL){
+      mem_free(curs[i].decoded);
+    }
+  }
+  mem_free(curs);
+  return found;
+}
+
+
+/**************** positions_unload ****************/
+/* see positions.h for description */
+
+void
+positions_unload(posindex_t* pi){
+  if(pi != NULL){
+    hashtable_delete(pi->ht, mem_free);
+    munmap(pi->map, pi->size);
+    mem_free(pi);
+  }
+}
+
+
+/**************** poslist_new ****************/
+/* Allocate an empty poslist */
+
+static poslist_t*
+poslist_new(void){
+  poslist_t* pl = memtag_malloc(MEMTAG_POSTINGS, sizeof(poslist_t), "Error allocating memory");
+  pl->cap = 16;
+  pl->len = 0;
+  pl->buf = memtag_malloc(MEMTAG_POSTINGS, pl->cap, "Error allocating memory");
+  pl->numDocs = 0;
+  pl->prevDoc = 0;
+  pl->curDoc = 0;
+  pl->curcap = 4;
+  pl->ncur = 0;
+  pl->cur = memtag_malloc(MEMTAG_POSTINGS, pl->curcap * sizeof(int), "Error allocating memory");
+  return pl;
+}
+
+
+/**************** poslist_flush ****************/
+/* Encode the positions of the current document onto the end of buf */
+
+static void
+poslist_flush(poslist_t* pl){
+  if(pl->ncur == 0){
+    return;
+  }
+  int bytes = 0;
+  int prev = 0;
+  for(int i = 0; i < pl->ncur; i++){
+    bytes += varint_size(pl->cur[i] - prev);
+    prev = pl->cur[i];
+  }
+  poslist_put(pl, pl->curDoc - pl->prevDoc);
+  poslist_put(pl, pl->ncur);
+  poslist_put(pl, bytes);
+  prev = 0;
+  for(int i = 0; i < pl->ncur; i++){
+    poslist_put(pl, pl->cur[i] - prev);
+    prev = pl->cur[i];
+  }
+  pl->numDocs++;
+  pl->prevDoc = pl->curDoc;
+  pl->curDoc = 0;
+  pl->ncur = 0;
+}
+
+
+/**************** poslist_delete ****************/
+/* Free a poslist; also the itemdelete of the hashtable */
+
+static void
+poslist_delete(void* item){
+  poslist_t* pl = item;
+  if(pl != NULL){
+    memtag_free(pl->buf);
+    memtag_free(pl->cur);
+    memtag_free(pl);
+  }
+}
+
+
+/**************** poslist_put ****************/
+/* Append value to buf as a varint */
+
+static void
+poslist_put(poslist_t* pl, unsigned int value){
+  if(pl->len + 5 > pl->cap){
+    pl->cap *= 2;
+    pl->buf = memtag_realloc(MEMTAG_POSTINGS, pl->buf, pl->cap, "Error allocating memory");
+  }
+  while(value >= 0x80){
+    pl->buf[pl->len++] = (value & 0x7f) | 0x80;
+    value >>= 7;
+  }
+  pl->buf[pl->len++] = value;
+}
+
+
+/**************** varint_size ****************/
+/* Return the number of bytes of value as a varint */
+
+static int
+varint_size(unsigned int value){
+  int bytes = 1;
+  while(value >= 0x80){
+    value >>= 7;
+    bytes++;
+  }
+  return bytes;
+}
+
+
+/**************** varint_get ****************/
+/* Read a varint at *pp (not past end) into value and step over it;
+ * return false if there is no complete varint there
+ */
+
+static inline bool
+varint_get(const unsigned char** pp, const unsigned char* end, unsigned int* value){
+  const unsigned char* p = *pp;
+  unsigned int v = 0;
+  int shift = 0;
+  while(p < end && shift < 35){
+    unsigned char byte = *p++;
+    v |= (unsigned int)(byte & 0x7f) << shift;
+    if((byte & 0x80) == 0){
+      *value = v;
+      *pp = p;
+      return true;
+    }
+    shift += 7;
+  }
+  return false;
+}
+
+
+/**************** wordarray_helper ****************/
+/* Helper function for hashtable_iterate to gather the words */
+
+static void
+wordarray_helper(void* arg, const char* key, void* item){
+  wordarray_t* words = arg;
+  words->words[words->n++] = key;
+}
+
+
+/**************** word_cmp ****************/
+/* qsort comparison of words */
+
+static int
+word_cmp(const void* a, const void* b){
+  return strcmp(*(const char**)a, *(const char**)b);
+}
+
+
+/**************** poscursor_advance ****************/
+/* Move the cursor to its next document, stepping over the positions of the
+ * current one without decoding them; docID becomes INT_MAX at the end
+ * (or on a malformed record)
+ */
+
+static void
+poscursor_advance(poscursor_t* c){
+  unsigned int gap, npos, bytes;
+  if(c->left == 0 || !varint_get(&c->p, c->end, &gap) || !varint_get(&c->p, c->end, &npos)
+     || !varint_get(&c->p, c->end, &bytes) || bytes > c->end - c->p){
+    c->left = 0;
+    c->docID = INT_MAX;
+    return;
+  }
+  c->left--;
+  c->docID += gap;
+  c->npos = npos;
+  c->pos = c->p;
+  c->p += bytes;
+}
+
+
+/**************** poscursor_decode ****************/
+/* Decode the positions of the current document into decoded */
+
+static bool
+poscursor_decode(poscursor_t* c){
+  if(c->npos > c->cap){
+    c->cap = c->npos;
+    c->decoded = mem_assert(realloc(c->decoded, c->cap * sizeof(int)), "Error allocating memory");
+  }
+  const unsigned char* p = c->pos;
+  int prev = 0;
+  for(int i = 0; i < c->npos; i++){
+    unsigned int gap;
+    if(!varint_get(&p, c->p, &gap)){
+      return false;
+    }
+    prev += gap;
+    c->decoded[i] = prev;
+  }
+  return true;
+}
+
+
+/**************** phrase_count ****************/
+/* Count the places in the current document (the same for every cursor) where
+ * each word is at its offset from the first; the positions of every word are
+ * walked once, in step, since the targets only increase
+ */
+
+static int
+phrase_count(poscursor_t* curs, const int n){
+  for(int i = 0; i < n; i++){
+    if(!poscursor_decode(&curs[i])){
+      return 0;
+    }
+  }
+  int* next = mem_malloc_assert(n * sizeof(int), "Error allocating memory");
+  for(int i = 0; i < n; i++){
+    next[i] = 0;
+  }
+  int count = 0;
+  for(int j = 0; j < curs[0].npos; j++){
+    int start = curs[0].decoded[j] - curs[0].offset;
+    bool match = true;
+    for(int i = 1; i < n && match; i++){
+      int want = start + curs[i].offset;
+      while(next[i] < curs[i].npos && curs[i].decoded[next[i]] < want){
+        next[i]++;
+      }
+      match = next[i] < curs[i].npos && curs[i].decoded[next[i]] == want;
+    }
+    if(match){
+      count++;
+    }
+  }
+  mem_free(next);
+  return count;
+}
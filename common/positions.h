@@ -0,0 +1,120 @@
+/*
+ * positions.h - header file for the positions (positional index) module
+ *
+ * keeps where in each document each word occurs, so phrases can be found.
+ * The position of a word is its place among all the words of the page
+ * (counting the short words that are not indexed, so a phrase with a short
+ * word in it keeps its gaps).  The indexer builds the positions with
+ * positions_new/positions_add and writes them beside the index with
+ * positions_save; the querier maps the file with positions_load and finds
+ * phrases with positions_phrase.
+ *
+ * Like the spimi index, the positions being built can be given a memory
+ * budget: once it is reached, the positions so far are written, sorted by
+ * word, to a run beside the file (file.run0, file.run1, ...), and
+ * positions_save merges the runs into the file.
+ *
+ * The file is binary and compressed: after an 8-byte header, one record per
+ * word, in word order:
+ *
+ *   word '\0' recordLength numDocs
+ *   then per document: docIDgap numPositions positionsLength positionGaps...
+ *
+ * where every number is a varint (7 bits per byte, low bits first, high bit
+ * set on all but the last byte) and docIDs and positions are stored as gaps
+ * from the previous one.  positionsLength (in bytes) lets a reader step over
+ * the positions of a document without decoding them.
+ *
+ * Cooper LaPorte March 2023
+ */
+
+#ifndef __POSITIONS_H
+#define __POSITIONS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "counters.h"
+
+/**************** global types ****************/
+typedef struct positions positions_t;  // positions being built, opaque
+typedef struct posindex posindex_t;    // positions loaded from a file, opaque
+
+/**************** positions_filename ****************/
+/* Return the pathname of the positions file that goes with an index file,
+ * indexFilename.pos; caller must free the pathname.
+ */
+char* positions_filename(const char* indexFilename);
+
+/**************** positions_new ****************/
+/* Create a new (empty) set of positions.
+ *
+ * Caller provides:
+ *   pathname of the positions file to write (see positions_filename), and a
+ *   memory budget in bytes for the positions in memory (0 means no budget)
+ * We return:
+ *   pointer to the new positions, or NULL if file is NULL; caller must later
+ *   call positions_delete
+ */
+positions_t* positions_new(const char* file, const size_t budget);
+
+/**************** positions_add ****************/
+/* Record that word occurs in docID at position.
+ *
+ * Caller provides:
+ *   docIDs in increasing order, and for each word and docID, positions in
+ *   increasing order
+ * We return:
+ *   true if the position was recorded, false if bad parameters or a run
+ *   could not be written
+ * Notes:
+ *   may write a run, between documents, once the memory budget is reached
+ */
+bool positions_add(positions_t* pos, const char* word, const int docID, const int position);
+
+/**************** positions_save ****************/
+/* Write the positions to their file, merging the runs written so far into it.
+ *
+ * We return:
+ *   true if the file was written, false otherwise
+ */
+bool positions_save(positions_t* pos);
+
+/**************** positions_delete ****************/
+/* Delete the positions being built, and any runs of them */
+void positions_delete(positions_t* pos);
+
+/**************** positions_load ****************/
+/* Map a positions file written by positions_save into memory.
+ *
+ * Caller provides:
+ *   pathname of the file, and the number of hashtable slots to use (as for the index)
+ * We return:
+ *   pointer to the loaded positions, or NULL if the file cannot be read or is
+ *   not a positions file; caller must later call positions_unload
+ * Notes:
+ *   only the words are read; the positions of a word are decoded when a
+ *   phrase needs them
+ */
+posindex_t* positions_load(const char* file, const int slots);
+
+/**************** positions_phrase ****************/
+/* Find the documents where the words occur at the given offsets from each other.
+ *
+ * Caller provides:
+ *   loaded positions, n > 0 words, and for each word its offset (in words)
+ *   from the first word of the phrase
+ * We return:
+ *   a new counters of docID -> number of times the phrase occurs in docID,
+ *   or NULL if no document has the phrase; caller must delete the counters
+ * Notes:
+ *   the docIDs of the words are intersected first; positions are only decoded
+ *   for the documents that have every word
+ */
+counters_t* positions_phrase(posindex_t* pi, const char** words, const int* offsets, const int n);
+
+/**************** positions_unload ****************/
+/* Unmap the positions file and free the loaded positions */
+void positions_unload(posindex_t* pi);
+
+#endif // __POSITIONS_H
@@ -0,0 +1,1078 @@
+/*
+ * postings.c - CS50 'postings' module
+ *
+ * see postings.h for more information.
+ *
+ * Cooper LaPorte, March 2023
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include "mem.h"
+#include "memtag.h"
+#include "counters.h"
+#include "postings.h"
+
+
+/**************** file-local constants ****************/
+static const char MAGIC[8] = "TSEBLKS1";   // header of a block metadata file
+static const int POSTINGS_BLOCK = 64;      // postings per block
+static const int POSTINGS_DENSE = 16;      // a bitmap when its docIDs span at most this many per posting
+
+
+/**************** local types ****************/
+struct postings {
+  int n;
+  int* docs;          // docIDs, in increasing order; NULL for a bitmap
+  int* counts;        // counts[i], the count of posting i (the ith docID of the bitmap)
+  uint64_t* bits;     // for dense postings, bit d % 64 of bits[d / 64 - base] is set for each docID d; else NULL
+  int* ranks;         // ranks[w], the number of postings before bits[w] (numWords + 1 of them)
+  int base;
+  int numWords;
+  int numBlocks;
+  int* blockLast;     // blockLast[b], the last docID of block b
+  int* blockMax;      // blockMax[b], the largest count in block b
+};
+
+struct blockmeta {
+  unsigned char* data;   // the file, after the header
+  size_t len;
+  uint64_t* words;       // words[ordinal], offset in data of the blocks of the word
+  int numWords;
+};
+
+/* postmerge: a walk through the docIDs of postings, either kind, for postings_merge */
+typedef struct postmerge {
+  postings_t* p;
+  int i;              // index of the current posting
+  int w;              // for a bitmap, the word of the current posting
+  uint64_t x;         // for a bitmap, the bits of word w from the current posting on
+  int doc;            // docID of the current posting, INT_MAX past the last
+} postmerge_t;
+
+/* the state of postings_new while it copies a counters */
+typedef struct postfill {
+  postings_t* p;
+  bool sorted;
+} postfill_t;
+
+
+static void postings_size_helper(void* arg, const int key, const int count);
+static void postings_fill_helper(void* arg, const int key, const int count);
+static int posting_cmp(const void* a, const void* b);
+static bool postings_metaBlocks(postings_t* p, blockmeta_t* meta, const int ordinal);
+static void postings_computeBlocks(postings_t* p);
+static postings_t* postings_alloc(const int cap);
+static void postings_build(postings_t* p, const bool sorted, blockmeta_t* meta, const int ordinal);
+static void postings_finish(postings_t* p);
+static int postings_gallop(postings_t* p, const int from, const int docID);
+static void postings_pack(postings_t* p);
+static int postings_rank(postings_t* p, const int docID);
+static bool postings_has(postings_t* p, const int docID);
+static postings_t* postings_andBits(postings_t* a, postings_t* b);
+static postings_t* postings_andProbe(postings_t* a, postings_t* b);
+static postings_t* postings_orBits(postings_t* a, postings_t* b);
+static postings_t* postings_allocBits(const int base, const int numWords, const int cap);
+static void postings_putBits(postings_t* p, const int w, const uint64_t x, const int* counts);
+static void postings_finishBits(postings_t* p);
+static void postings_unpack(postings_t* p);
+static void postings_span(postings_t* p, int* first, int* end);
+static uint64_t postings_word(postings_t* p, const int word, int* next, const int** counts);
+static void postmerge_next(postmerge_t* m);
+static void postmerge_down(postmerge_t* heap, const int n, int i);
+static void postings_put(FILE* fp, unsigned int value);
+static bool postings_get(const unsigned char** pp, const unsigned char* end, unsigned int* value);
+
+
+/**************** postings_blocksFilename ****************/
+/* see postings.h for description */
+
+char*
+postings_blocksFilename(const char* indexFilename){
+  if(indexFilename == NULL){
+    return NULL;
+  }
+  char* file = mem_malloc_assert(strlen(indexFilename) + 8, "Error allocating memory");
+  sprintf(file, "%s.blocks", indexFilename);
+  return file;
+}
+
+
+/**************** postings_saveBlocks ****************/
+/* see postings.h for description */
+
+bool
+postings_saveBlocks(const char* indexFilename, const char* blocksFile){
+  if(indexFilename == NULL || blocksFile == NULL){
+    return false;
+  }
+  FILE* in = fopen(indexFilename, "r");
+  if(in == NULL){
+    return false;
+  }
+  FILE* out = fopen(blocksFile, "w");
+  if(out == NULL){
+    fclose(in);
+    return false;
+  }
+  // the number of words goes in the header, so leave room and fill it in at the end
+  uint32_t head[2] = { 0, POSTINGS_BLOCK };
+  fwrite(MAGIC, 1, sizeof(MAGIC), out);
+  fwrite(head, sizeof(head), 1, out);
+
+  int cap = POSTINGS_BLOCK;
+  int* lasts = mem_malloc_assert(cap * sizeof(int), "Error allocating memory");
+  int* maxes = mem_malloc_assert(cap * sizeof(int), "Error allocating memory");
+  char* line = NULL;
+  size_t lineCap = 0;
+  bool ok = true;
+  while(ok && getline(&line, &lineCap, in) > 0){
+    char* p = line + strcspn(line, " \n");   // past the word
+    int numBlocks = 0;
+    int n = 0;
+    int prev = 0;
+    while(true){
+      char* end;
+      long docID = strtol(p, &end, 10);
+      if(end == p){
+        break;
+      }
+      p = end;
+      long count = strtol(p, &end, 10);
+      if(end == p || docID <= prev || count <= 0){ // not an index line, or not in order
+        ok = false;
+        break;
+      }
+      p = end;
+      if(n % POSTINGS_BLOCK == 0){
+        if(numBlocks == cap){
+          cap *= 2;
+          lasts = mem_assert(realloc(lasts, cap * sizeof(int)), "Error allocating memory");
+          maxes = mem_assert(realloc(maxes, cap * sizeof(int)), "Error allocating memory");
+        }
+        maxes[numBlocks++] = 0;
+      }
+      lasts[numBlocks - 1] = docID;
+      if(count > maxes[numBlocks - 1]){
+        maxes[numBlocks - 1] = count;
+      }
+      prev = docID;
+      n++;
+    }
+    if(ok){
+      postings_put(out, numBlocks);
+      for(int b = 0; b < numBlocks; b++){
+        postings_put(out, lasts[b] - (b == 0 ? 0 : lasts[b - 1]));
+        postings_put(out, maxes[b]);
+      }
+      head[0]++;
+    }
+  }
+  mem_free(lasts);
+  mem_free(maxes);
+  free(line);
+  fclose(in);
+  if(ok){
+    ok = fseek(out, sizeof(MAGIC), SEEK_SET) == 0 && fwrite(head, sizeof(head), 1, out) == 1;
+  }
+  ok = !ferror(out) && ok;
+  ok = (fclose(out) == 0) && ok;
+  if(!ok){
+    remove(blocksFile);
+  }
+  return ok;
+}
+
+
+/**************** postings_loadBlocks ****************/
+/* see postings.h for description */
+
+blockmeta_t*
+postings_loadBlocks(const char* file, const int numWords){
+  FILE* fp = file == NULL ? NULL : fopen(file, "r");
+  if(fp == NULL){
+    return NULL;
+  }
+  char magic[sizeof(MAGIC)];
+  uint32_t head[2];
+  long len = -1;
+  if(fread(magic, 1, sizeof(magic), fp) == sizeof(magic) && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0
+     && fread(head, sizeof(head), 1, fp) == 1 && head[0] == numWords && head[1] == POSTINGS_BLOCK
+     && fseek(fp, 0, SEEK_END) == 0){
+    len = ftell(fp) - (long)(sizeof(MAGIC) + sizeof(head));
+  }
+  if(len < 0 || fseek(fp, sizeof(MAGIC) + sizeof(head), SEEK_SET) != 0){
+    fclose(fp);
+    return NULL;
+  }
+  blockmeta_t* meta = memtag_malloc(MEMTAG_POSTINGS, sizeof(blockmeta_t), "Error allocating memory");
+  meta->len = len;
+  meta->numWords = numWords;
+  meta->data = memtag_malloc(MEMTAG_POSTINGS, len + 1, "Error allocating memory");
+  meta->words = memtag_malloc(MEMTAG_POSTINGS, (numWords + 1) * sizeof(uint64_t), "Error allocating memory");
+  bool ok = fread(meta->data, 1, len, fp) == len;
+  fclose(fp);
+
+  // find where the blocks of each word start, checking that they are all there
+  const unsigned char* p = meta->data;
+  const unsigned char* end = meta->data + len;
+  for(int w = 0; ok && w < numWords; w++){
+    meta->words[w] = p - meta->data;
+    unsigned int numBlocks;
+    unsigned int value;
+    ok = postings_get(&p, end, &numBlocks);
+    for(unsigned int b = 0; ok && b < 2 * numBlocks; b++){
+      ok = postings_get(&p, end, &value);
+    }
+  }
+  if(!ok || p != end){
+    postings_unloadBlocks(meta);
+    return NULL;
+  }
+  return meta;
+}
+
+
+/**************** postings_unloadBlocks ****************/
+/* see postings.h for description */
+
+void
+postings_unloadBlocks(blockmeta_t* meta){
+  if(meta != NULL){
+    memtag_free(meta->data);
+    memtag_free(meta->words);
+    memtag_free(meta);
+  }
+}
+
+
+/**************** postings_new ****************/
+/* see postings.h for description */
+
+postings_t*
+postings_new(counters_t* ctrs, blockmeta_t* meta, const int ordinal){
+  int cap = 0;
+  counters_iterate(ctrs, &cap, postings_size_helper);
+  postings_t* p = postings_alloc(cap);
+  postfill_t fill = { p, true };
+  counters_iterate(ctrs, &fill, postings_fill_helper);
+  postings_build(p, fill.sorted, meta, ordinal);
+  return p;
+}
+
+
+/**************** postings_fromArrays ****************/
+/* see postings.h for description */
+
+postings_t*
+postings_fromArrays(const int* docIDs, const int* counts, const int n,
+                    blockmeta_t* meta, const int ordinal){
+  postings_t* p = postings_alloc(n);
+  bool sorted = true;
+  for(int i = 0; i < n; i++){
+    if(i > 0 && docIDs[i] <= docIDs[i - 1]){
+      sorted = false;
+    }
+    p->docs[i] = docIDs[i];
+    p->counts[i] = counts[i];
+  }
+  p->n = n;
+  postings_build(p, sorted, meta, ordinal);
+  return p;
+}
+
+
+/**************** getters ****************/
+/* see postings.h for description */
+
+int
+postings_size(postings_t* p){
+  return p == NULL ? 0 : p->n;
+}
+
+int
+postings_doc(postings_t* p, const int i){
+  if(p->docs != NULL){
+    return p->docs[i];
+  }
+  // the word of posting i: from the word after the last docID of the block before, on
+  int b = i / POSTINGS_BLOCK;
+  int w = b == 0 ? 0 : (p->blockLast[b - 1] + 1) / 64 - p->base;
+  while(p->ranks[w + 1] <= i){
+    w++;
+  }
+  uint64_t x = p->bits[w];
+  int bit = 0;
+  int k = i - p->ranks[w];  // postings of the word before posting i
+  for(int c = __builtin_popcountll(x & 0xff); k >= c; c = __builtin_popcountll(x & 0xff)){
+    k -= c;     // not in this byte
+    x >>= 8;
+    bit += 8;
+  }
+  for(; k > 0; k--){
+    x &= x - 1;
+  }
+  return 64 * (p->base + w) + bit + __builtin_ctzll(x);
+}
+
+int
+postings_count(postings_t* p, const int i){
+  return p->counts[i];
+}
+
+
+/**************** postings_iterate ****************/
+/* see postings.h for description */
+
+void
+postings_iterate(postings_t* p, void* arg,
+                 void (*itemfunc)(void* arg, const int docID, const int count)){
+  if(p == NULL || itemfunc == NULL){
+    return;
+  }
+  if(p->docs != NULL){
+    for(int i = 0; i < p->n; i++){
+      (*itemfunc)(arg, p->docs[i], p->counts[i]);
+    }
+    return;
+  }
+  int i = 0;
+  for(int w = 0; w < p->numWords; w++){
+    for(uint64_t x = p->bits[w]; x != 0; x &= x - 1){
+      (*itemfunc)(arg, 64 * (p->base + w) + __builtin_ctzll(x), p->counts[i++]);
+    }
+  }
+}
+
+int
+postings_blockLast(postings_t* p, const int i){
+  return p->blockLast[i / POSTINGS_BLOCK];
+}
+
+int
+postings_blockMax(postings_t* p, const int i){
+  return p->blockMax[i / POSTINGS_BLOCK];
+}
+
+int
+postings_maxCount(postings_t* p){
+  int max = 0;
+  for(int b = 0; p != NULL && b < p->numBlocks; b++){
+    if(p->blockMax[b] > max){
+      max = p->blockMax[b];
+    }
+  }
+  return max;
+}
+
+
+/**************** postings_seek ****************/
+/* see postings.h for description */
+
+int
+postings_seek(postings_t* p, const int from, const int docID){
+  if(p == NULL || from >= p->n){
+    return p == NULL ? 0 : p->n;
+  }
+  if(p->bits != NULL){ // the postings before docID are its rank
+    int r = postings_rank(p, docID);
+    return r > from ? r : from;
+  }
+  int i = from;
+  int b = i / POSTINGS_BLOCK;
+  if(p->blockLast[b] < docID){ // not in this block: step over blocks by their last docID
+    do{
+      b++;
+    } while(b < p->numBlocks && p->blockLast[b] < docID);
+    if(b == p->numBlocks){
+      return p->n;
+    }
+    i = b * POSTINGS_BLOCK;
+  }
+  // the block holds a docID >= docID, and so ends the scan
+  while(p->docs[i] < docID){
+    i++;
+  }
+  return i;
+}
+
+
+/**************** postings_and ****************/
+/* see postings.h for description */
+
+postings_t*
+postings_and(postings_t* a, postings_t* b){
+  if(postings_size(a) > 0 && postings_size(b) > 0 && a->bits != NULL && b->bits != NULL){
+    return postings_andBits(a, b);
+  }
+  if(postings_size(a) > 0 && postings_size(b) > 0 && (a->bits != NULL || b->bits != NULL)){
+    return a->bits != NULL ? postings_andProbe(b, a) : postings_andProbe(a, b);
+  }
+  if(postings_size(a) > postings_size(b)){ // walk the shorter, gallop through the longer
+    postings_t* t = a;
+    a = b;
+    b = t;
+  }
+  postings_t* p = postings_alloc(postings_size(a));
+  int j = 0;
+  for(int i = 0; i < postings_size(a) && j < b->n; i++){
+    j = postings_gallop(b, j, a->docs[i]);
+    if(j < b->n && b->docs[j] == a->docs[i]){
+      p->docs[p->n] = a->docs[i];
+      p->counts[p->n] = a->counts[i] < b->counts[j] ? a->counts[i] : b->counts[j];
+      p->n++;
+    }
+  }
+  postings_finish(p);
+  return p;
+}
+
+
+/**************** postings_or ****************/
+/* see postings.h for description */
+
+postings_t*
+postings_or(postings_t* a, postings_t* b){
+  int na = postings_size(a);
+  int nb = postings_size(b);
+  if((na > 0 && a->bits != NULL) || (nb > 0 && b->bits != NULL)){
+    return postings_orBits(a, b);
+  }
+  postings_t* p = postings_alloc(na + nb);
+  int i = 0;
+  int j = 0;
+  while(i < na || j < nb){
+    if(j == nb || (i < na && a->docs[i] < b->docs[j])){
+      p->docs[p->n] = a->docs[i];
+      p->counts[p->n] = a->counts[i++];
+    } else if(i == na || b->docs[j] < a->docs[i]){
+      p->docs[p->n] = b->docs[j];
+      p->counts[p->n] = b->counts[j++];
+    } else{ // in both
+      p->docs[p->n] = a->docs[i];
+      p->counts[p->n] = a->counts[i++] + b->counts[j++];
+    }
+    p->n++;
+  }
+  postings_finish(p);
+  return p;
+}
+
+
+/**************** postings_merge ****************/
+/* see postings.h for description */
+
+postings_t*
+postings_merge(postings_t** lists, const int k){
+  postmerge_t* heap = memtag_malloc(MEMTAG_POSTINGS, (k + 1) * sizeof(postmerge_t), "Error allocating memory");
+  int n = 0;
+  int cap = 0;
+  for(int l = 0; l < k; l++){
+    if(postings_size(lists[l]) > 0){
+      postmerge_t* m = &heap[n++];
+      m->p = lists[l];
+      m->i = -1;
+      m->w = 0;
+      m->x = m->p->bits != NULL ? m->p->bits[0] : 0;
+      postmerge_next(m);
+      cap += m->p->n;
+    }
+  }
+  for(int i = n / 2 - 1; i >= 0; i--){
+    postmerge_down(heap, n, i);
+  }
+  postings_t* p = postings_alloc(cap);
+  while(n > 0){
+    int docID = heap[0].doc;
+    int count = 0;
+    while(n > 0 && heap[0].doc == docID){ // take it from every list that has it
+      count += heap[0].p->counts[heap[0].i];
+      postmerge_next(&heap[0]);
+      if(heap[0].doc == INT_MAX){
+        heap[0] = heap[--n];
+      }
+      postmerge_down(heap, n, 0);
+    }
+    p->docs[p->n] = docID;
+    p->counts[p->n] = count;
+    p->n++;
+  }
+  memtag_free(heap);
+  postings_finish(p);
+  return p;
+}
+
+
+/**************** postings_delete ****************/
+/* see postings.h for description */
+
+void
+postings_delete(postings_t* p){
+  if(p != NULL){
+    memtag_free(p->docs);
+    memtag_free(p->counts);
+    memtag_free(p->bits);
+    memtag_free(p->ranks);
+    memtag_free(p->blockLast);
+    memtag_free(p->blockMax);
+    memtag_free(p);
+  }
+}
+
+
+/**************** postings_size_helper ****************/
+/* Helper function for counters_iterate to count the postings */
+
+static void
+postings_size_helper(void* arg, const int key, const int count){
+  int* n = arg;
+  if(count > 0){
+    (*n)++;
+  }
+}
+
+
+/**************** postings_fill_helper ****************/
+/* Helper function for counters_iterate to copy each posting into the arrays */
+
+static void
+postings_fill_helper(void* arg, const int key, const int count){
+  if(count <= 0){
+    return;
+  }
+  postfill_t* fill = arg;
+  postings_t* p = fill->p;
+  if(p->n > 0 && key <= p->docs[p->n - 1]){
+    fill->sorted = false;
+  }
+  p->docs[p->n] = key;
+  p->counts[p->n] = count;
+  p->n++;
+}
+
+
+/**************** posting_cmp ****************/
+/* qsort comparison of (docID, count, place) triples by docID, then by place */
+
+static int
+posting_cmp(const void* a, const void* b){
+  const int* x = a;
+  const int* y = b;
+  return x[0] != y[0] ? (x[0] < y[0] ? -1 : 1) : x[2] - y[2];
+}
+
+
+/**************** postings_metaBlocks ****************/
+/* Take the blocks of a word from the metadata, if they match its postings */
+
+static bool
+postings_metaBlocks(postings_t* p, blockmeta_t* meta, const int ordinal){
+  if(meta == NULL || ordinal < 0 || ordinal >= meta->numWords){
+    return false;
+  }
+  const unsigned char* q = meta->data + meta->words[ordinal];
+  const unsigned char* end = meta->data + meta->len;
+  unsigned int numBlocks;
+  if(!postings_get(&q, end, &numBlocks) || numBlocks != p->numBlocks){
+    return false;
+  }
+  int last = 0;
+  for(int b = 0; b < p->numBlocks; b++){
+    unsigned int gap;
+    unsigned int max;
+    if(!postings_get(&q, end, &gap) || !postings_get(&q, end, &max)){
+      return false;
+    }
+    last += gap;
+    int lastIndex = (b + 1) * POSTINGS_BLOCK < p->n ? (b + 1) * POSTINGS_BLOCK - 1 : p->n - 1;
+    if(last != p->docs[lastIndex] || max == 0){
+      return false;
+    }
+    p->blockLast[b] = last;
+    p->blockMax[b] = max;
+  }
+  return true;
+}
+
+
+/**************** postings_computeBlocks ****************/
+/* Work out the last docID and the largest count of each block */
+
+static void
+postings_computeBlocks(postings_t* p){
+  for(int b = 0; b < p->numBlocks; b++){
+    int max = 0;
+    int i;
+    for(i = b * POSTINGS_BLOCK; i < p->n && i < (b + 1) * POSTINGS_BLOCK; i++){
+      if(p->counts[i] > max){
+        max = p->counts[i];
+      }
+    }
+    p->blockLast[b] = postings_doc(p, i - 1);  // in order: a bitmap finds it from the block before
+    p->blockMax[b] = max;
+  }
+}
+
+
+/**************** postings_alloc ****************/
+/* Make empty postings with room for cap postings, for postings_finish to complete */
+
+static postings_t*
+postings_alloc(const int cap){
+  postings_t* p = memtag_malloc(MEMTAG_POSTINGS, sizeof(postings_t), "Error allocating memory");
+  p->n = 0;
+  p->docs = memtag_malloc(MEMTAG_POSTINGS, (cap + 1) * sizeof(int), "Error allocating memory");
+  p->counts = memtag_malloc(MEMTAG_POSTINGS, (cap + 1) * sizeof(int), "Error allocating memory");
+  p->bits = NULL;
+  p->ranks = NULL;
+  return p;
+}
+
+
+/**************** postings_finish ****************/
+/* Work out the blocks of postings filled in after postings_alloc, and make them a bitmap if dense */
+
+static void
+postings_finish(postings_t* p){
+  p->numBlocks = (p->n + POSTINGS_BLOCK - 1) / POSTINGS_BLOCK;
+  p->blockLast = memtag_malloc(MEMTAG_POSTINGS, (p->numBlocks + 1) * sizeof(int), "Error allocating memory");
+  p->blockMax = memtag_malloc(MEMTAG_POSTINGS, (p->numBlocks + 1) * sizeof(int), "Error allocating memory");
+  postings_computeBlocks(p);
+  postings_pack(p);
+}
+
+
+/**************** postings_build ****************/
+/* Complete the postings copied in after postings_alloc: sort them by docID unless sorted,
+ * keeping the last count of a docID given twice, drop the postings with no count, take the
+ * blocks from the metadata (or work them out), and make them a bitmap if dense
+ */
+
+static void
+postings_build(postings_t* p, const bool sorted, blockmeta_t* meta, const int ordinal){
+  if(!sorted){ // sort (docID, count, place) triples, so the last of a repeated docID is known
+    int* triples = mem_malloc_assert(3 * (p->n + 1) * sizeof(int), "Error allocating memory");
+    for(int i = 0; i < p->n; i++){
+      triples[3 * i] = p->docs[i];
+      triples[3 * i + 1] = p->counts[i];
+      triples[3 * i + 2] = i;
+    }
+    qsort(triples, p->n, 3 * sizeof(int), posting_cmp);
+    int n = 0;
+    for(int i = 0; i < p->n; i++){
+      if(n > 0 && p->docs[n - 1] == triples[3 * i]){
+        n--;  // the same docID again: this count replaces the one before
+      }
+      p->docs[n] = triples[3 * i];
+      p->counts[n] = triples[3 * i + 1];
+      n++;
+    }
+    p->n = n;
+    mem_free(triples);
+  }
+  int n = 0;
+  for(int i = 0; i < p->n; i++){
+    if(p->counts[i] > 0){
+      p->docs[n] = p->docs[i];
+      p->counts[n] = p->counts[i];
+      n++;
+    }
+  }
+  p->n = n;
+  p->numBlocks = (p->n + POSTINGS_BLOCK - 1) / POSTINGS_BLOCK;
+  p->blockLast = memtag_malloc(MEMTAG_POSTINGS, (p->numBlocks + 1) * sizeof(int), "Error allocating memory");
+  p->blockMax = memtag_malloc(MEMTAG_POSTINGS, (p->numBlocks + 1) * sizeof(int), "Error allocating memory");
+  if(!postings_metaBlocks(p, meta, ordinal)){
+    postings_computeBlocks(p);
+  }
+  postings_pack(p);
+}
+
+
+/**************** postings_pack ****************/
+/* Replace the docIDs of postings with a bitmap of them if they are dense: at least a block
+ * of postings whose docIDs span no more than POSTINGS_DENSE per posting, so the bitmap and
+ * its ranks (3 bytes per 16 docIDs spanned) take less room than the docIDs (4 bytes each)
+ */
+
+static void
+postings_pack(postings_t* p){
+  if(p->n < POSTINGS_BLOCK){
+    return;
+  }
+  int base = p->docs[0] / 64;
+  int numWords = p->docs[p->n - 1] / 64 - base + 1;
+  if((long)numWords * 64 > (long)POSTINGS_DENSE * p->n){
+    return;
+  }
+  p->bits = memtag_calloc(MEMTAG_POSTINGS, numWords, sizeof(uint64_t), "Error allocating memory");
+  p->ranks = memtag_malloc(MEMTAG_POSTINGS, (numWords + 1) * sizeof(int), "Error allocating memory");
+  p->base = base;
+  p->numWords = numWords;
+  for(int i = 0; i < p->n; i++){
+    p->bits[p->docs[i] / 64 - base] |= (uint64_t)1 << (p->docs[i] % 64);
+  }
+  p->ranks[0] = 0;
+  for(int w = 0; w < numWords; w++){
+    p->ranks[w + 1] = p->ranks[w] + __builtin_popcountll(p->bits[w]);
+  }
+  memtag_free(p->docs);
+  p->docs = NULL;
+}
+
+
+/**************** postings_rank ****************/
+/* Return the number of postings of a bitmap whose docIDs are less than docID */
+
+static int
+postings_rank(postings_t* p, const int docID){
+  int w = docID / 64 - p->base;
+  if(docID < 0 || w < 0){
+    return 0;
+  }
+  if(w >= p->numWords){
+    return p->n;
+  }
+  return p->ranks[w] + __builtin_popcountll(p->bits[w] & (((uint64_t)1 << (docID % 64)) - 1));
+}
+
+
+/**************** postings_has ****************/
+/* Return true if a bitmap has docID */
+
+static bool
+postings_has(postings_t* p, const int docID){
+  int w = docID / 64 - p->base;
+  return docID >= 0 && w >= 0 && w < p->numWords && (p->bits[w] >> (docID % 64) & 1);
+}
+
+
+/**************** postings_andBits ****************/
+/* postings_and of two bitmaps: the words of the two are anded into the bitmap of the result,
+ * and the count of each docID left is found in each by its rank
+ */
+
+static postings_t*
+postings_andBits(postings_t* a, postings_t* b){
+  int first = a->base > b->base ? a->base : b->base;
+  int endA = a->base + a->numWords;
+  int endB = b->base + b->numWords;
+  int end = endA < endB ? endA : endB;
+  postings_t* p = postings_allocBits(first, end > first ? end - first : 0, a->n < b->n ? a->n : b->n);
+  int counts[64];
+  for(int word = first; word < end; word++){
+    uint64_t xa = a->bits[word - a->base];
+    uint64_t xb = b->bits[word - b->base];
+    const int* ca = a->counts + a->ranks[word - a->base];
+    const int* cb = b->counts + b->ranks[word - b->base];
+    uint64_t x = xa & xb;
+    int k = 0;
+    for(uint64_t y = x; y != 0; y &= y - 1){
+      uint64_t below = (y & -y) - 1;
+      int countA = ca[__builtin_popcountll(xa & below)];
+      int countB = cb[__builtin_popcountll(xb & below)];
+      counts[k++] = countA < countB ? countA : countB;
+    }
+    postings_putBits(p, word - first, x, counts);
+  }
+  postings_finishBits(p);
+  return p;
+}
+
+
+/**************** postings_orBits ****************/
+/* postings_or of a bitmap and postings of either kind (maybe none): the words of the two are ored
+ * into the bitmap of the result, and the counts of each word are summed in one pass
+ * over its docIDs
+ */
+
+static postings_t*
+postings_orBits(postings_t* a, postings_t* b){
+  int na = postings_size(a);
+  int nb = postings_size(b);
+  int firstA, endA, firstB, endB;
+  postings_span(na > 0 ? a : b, &firstA, &endA);
+  postings_span(nb > 0 ? b : a, &firstB, &endB);
+  int first = firstA < firstB ? firstA : firstB;
+  int end = endA > endB ? endA : endB;
+  postings_t* p = postings_allocBits(first, end - first, na + nb);
+  int nextA = 0;
+  int nextB = 0;
+  int counts[64];
+  for(int word = first; word < end; word++){
+    const int* ca = NULL;
+    const int* cb = NULL;
+    uint64_t xa = na > 0 ? postings_word(a, word, &nextA, &ca) : 0;
+    uint64_t xb = nb > 0 ? postings_word(b, word, &nextB, &cb) : 0;
+    if(xb == 0 || xa == 0){ // in one only: its counts as they are
+      postings_putBits(p, word - first, xa | xb, xb == 0 ? ca : cb);
+      continue;
+    }
+    uint64_t x = xa | xb;
+    int k = 0;
+    for(uint64_t y = x; y != 0; y &= y - 1){
+      uint64_t bit = y & -y;
+      counts[k] = 0;
+      if(xa & bit){
+        counts[k] += *ca++;
+      }
+      if(xb & bit){
+        counts[k] += *cb++;
+      }
+      k++;
+    }
+    postings_putBits(p, word - first, x, counts);
+  }
+  postings_finishBits(p);
+  return p;
+}
+
+
+/**************** postings_allocBits ****************/
+/* Make an empty bitmap of numWords words from word base, with room for cap postings, for
+ * postings_putBits to fill in in order and postings_finishBits to complete
+ */
+
+static postings_t*
+postings_allocBits(const int base, const int numWords, const int cap){
+  postings_t* p = memtag_malloc(MEMTAG_POSTINGS, sizeof(postings_t), "Error allocating memory");
+  p->n = 0;
+  p->docs = NULL;
+  p->counts = memtag_malloc(MEMTAG_POSTINGS, (cap + 1) * sizeof(int), "Error allocating memory");
+  p->bits = memtag_malloc(MEMTAG_POSTINGS, (numWords + 1) * sizeof(uint64_t), "Error allocating memory");
+  p->ranks = memtag_malloc(MEMTAG_POSTINGS, (numWords + 1) * sizeof(int), "Error allocating memory");
+  p->base = base;
+  p->numWords = numWords;
+  p->ranks[0] = 0;
+  return p;
+}
+
+
+/**************** postings_putBits ****************/
+/* Put word w of a bitmap made by postings_allocBits, with the counts of its docIDs in order */
+
+static void
+postings_putBits(postings_t* p, const int w, const uint64_t x, const int* counts){
+  int k = __builtin_popcountll(x);
+  p->bits[w] = x;
+  if(k > 0){
+    memcpy(p->counts + p->n, counts, k * sizeof(int));
+  }
+  p->n += k;
+  p->ranks[w + 1] = p->n;
+}
+
+
+/**************** postings_finishBits ****************/
+/* Complete a bitmap filled in by postings_putBits, as postings_finish completes an array:
+ * it stays a bitmap if it is dense (as postings_pack would make it), and is made an array
+ * of docIDs otherwise
+ */
+
+static void
+postings_finishBits(postings_t* p){
+  if(p->n < POSTINGS_BLOCK || (long)p->numWords * 64 > (long)POSTINGS_DENSE * p->n){
+    postings_unpack(p);
+    postings_finish(p);
+    return;
+  }
+  p->numBlocks = (p->n + POSTINGS_BLOCK - 1) / POSTINGS_BLOCK;
+  p->blockLast = memtag_malloc(MEMTAG_POSTINGS, (p->numBlocks + 1) * sizeof(int), "Error allocating memory");
+  p->blockMax = memtag_malloc(MEMTAG_POSTINGS, (p->numBlocks + 1) * sizeof(int), "Error allocating memory");
+  postings_computeBlocks(p);
+}
+
+
+/**************** postings_unpack ****************/
+/* Replace the bitmap of postings with an array of its docIDs */
+
+static void
+postings_unpack(postings_t* p){
+  p->docs = memtag_malloc(MEMTAG_POSTINGS, (p->n + 1) * sizeof(int), "Error allocating memory");
+  int i = 0;
+  for(int w = 0; w < p->numWords; w++){
+    for(uint64_t y = p->bits[w]; y != 0; y &= y - 1){
+      p->docs[i++] = 64 * (p->base + w) + __builtin_ctzll(y);
+    }
+  }
+  memtag_free(p->bits);
+  memtag_free(p->ranks);
+  p->bits = NULL;
+  p->ranks = NULL;
+}
+
+
+/**************** postings_andProbe ****************/
+/* postings_and of sorted arrays a and a bitmap b: each docID of a is looked up in the bitmap */
+
+static postings_t*
+postings_andProbe(postings_t* a, postings_t* b){
+  postings_t* p = postings_alloc(a->n < b->n ? a->n : b->n);
+  for(int i = 0; i < a->n; i++){
+    if(postings_has(b, a->docs[i])){
+      int cb = b->counts[postings_rank(b, a->docs[i])];
+      p->docs[p->n] = a->docs[i];
+      p->counts[p->n] = a->counts[i] < cb ? a->counts[i] : cb;
+      p->n++;
+    }
+  }
+  postings_finish(p);
+  return p;
+}
+
+
+/**************** postings_span ****************/
+/* Set [*first, *end) to the words of docIDs (d / 64) that the postings p (not empty) span */
+
+static void
+postings_span(postings_t* p, int* first, int* end){
+  if(p->bits != NULL){
+    *first = p->base;
+    *end = p->base + p->numWords;
+  } else{
+    *first = p->docs[0] / 64;
+    *end = p->docs[p->n - 1] / 64 + 1;
+  }
+}
+
+
+/**************** postings_word ****************/
+/* Return the docIDs of p in word (d / 64), as bits, and set *counts to their counts,
+ * which are in order in p->counts for either kind; for an array, *next is the first posting
+ * not yet taken, which must be in word or after it, and is moved past the word
+ */
+
+static uint64_t
+postings_word(postings_t* p, const int word, int* next, const int** counts){
+  uint64_t x = 0;
+  if(p->bits != NULL){
+    int w = word - p->base;
+    if(w >= 0 && w < p->numWords){
+      x = p->bits[w];
+      *counts = p->counts + p->ranks[w];
+    }
+    return x;
+  }
+  *counts = p->counts + *next;
+  int end = 64 * (word + 1);
+  for(; *next < p->n && p->docs[*next] < end; (*next)++){
+    x |= (uint64_t)1 << (p->docs[*next] % 64);
+  }
+  return x;
+}
+
+
+/**************** postmerge_next ****************/
+/* Move a walk of postings_merge to its next posting, setting m->doc to its docID,
+ * or to INT_MAX past the last
+ */
+
+static void
+postmerge_next(postmerge_t* m){
+  postings_t* p = m->p;
+  if(++m->i >= p->n){
+    m->doc = INT_MAX;
+  } else if(p->docs != NULL){
+    m->doc = p->docs[m->i];
+  } else{
+    if(m->i > 0){
+      m->x &= m->x - 1; // drop the posting before
+    }
+    while(m->x == 0){
+      m->x = p->bits[++m->w];
+    }
+    m->doc = 64 * (p->base + m->w) + __builtin_ctzll(m->x);
+  }
+}
+
+
+/**************** postmerge_down ****************/
+/* Sift heap[i] down the heap of n walks, ordered by smallest docID */
+
+static void
+postmerge_down(postmerge_t* heap, const int n, int i){
+  postmerge_t m = heap[i];
+  while(2 * i + 1 < n){
+    int child = 2 * i + 1;
+    if(child + 1 < n && heap[child + 1].doc < heap[child].doc){
+      child++;
+    }
+    if(heap[child].doc >= m.doc){
+      break;
+    }
+    heap[i] = heap[child];
+    i = child;
+  }
+  heap[i] = m;
+}
+
+
+/**************** postings_gallop ****************/
+/* Return the first posting at or after from whose docID is >= docID, or p->n if
+ * there is none: steps of 1, 2, 4, ... from `from` until one reaches docID, then
+ * a binary search of the last step
+ */
+
+static int
+postings_gallop(postings_t* p, const int from, const int docID){
+  if(from >= p->n || p->docs[from] >= docID){
+    return from;
+  }
+  int lo = from;      // docs[lo] < docID
+  int step = 1;
+  while(lo + step < p->n && p->docs[lo + step] < docID){
+    lo += step;
+    step *= 2;
+  }
+  int hi = lo + step < p->n ? lo + step : p->n; // docs[hi] >= docID, or hi is the end
+  while(hi - lo > 1){
+    int mid = lo + (hi - lo) / 2;
+    if(p->docs[mid] < docID){
+      lo = mid;
+    } else{
+      hi = mid;
+    }
+  }
+  return hi;
+}
+
+
+/**************** postings_put ****************/
+/* Write value to fp as a varint */
+
+static void
+postings_put(FILE* fp, unsigned int value){
+  while(value >= 0x80){
+    fputc((value & 0x7f) | 0x80, fp);
+    value >>= 7;
+  }
+  fputc(value, fp);
+}
+
+
+/**************** postings_get ****************/
+/* Read a varint at *pp, not reading at or past end, and step over it */
+
+static bool
+postings_get(const unsigned char** pp, const unsigned char* end, unsigned int* value){
+  const unsigned char* p = *pp;
+  unsigned int v = 0;
+  int shift = 0;
+  while(p < end && (*p & 0x80) && shift < 28){
+    v |= (unsigned int)(*p++ & 0x7f) << shift;
+    shift += 7;
+  }
+  if(p == end || (*p & 0x80)){
+    return false;
+  }
+  v |= (unsigned int)(*p++) << shift;
+  *pp = p;
+  *value = v;
+  return true;
+}
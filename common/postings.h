@@ -0,0 +1,188 @@
+/*
+ * postings.h - header file for the postings (block postings) module
+ *
+ * the postings of one word as arrays of docIDs (in increasing order) and
+ * counts, cut into blocks of POSTINGS_BLOCK postings.  For each block we keep
+ * its last docID and its largest count, so a walk through the postings can
+ * step over a whole block when looking for a docID past its end, and a ranker
+ * can bound the score of every document in a block without reading it.
+ *
+ * Postings are kept in whichever form is smaller: the docIDs of a sparse word
+ * as an array, and those of a dense word (at least a block of postings, whose
+ * docIDs span no more than 16 per posting, e.g. "the") as a bitmap, one bit
+ * per docID in the span, with the number of postings before each 64-bit word
+ * of it, so posting i, or the rank of a docID, is found in a word or two.
+ * The counts are an array either way.  postings_and and postings_or take
+ * either form, and give their result in the smaller one.
+ *
+ * The indexer records the block metadata of every word of an index in a file
+ * beside it (indexFilename.blocks), in the order of the words (the order of
+ * the lines of the index file):
+ *
+ *   "TSEBLKS1" numWords blockSize
+ *   then per word: numBlocks, then per block: lastDocGap maxCount
+ *
+ * where the numbers after the header are varints and lastDocGap is the gap
+ * from the last docID of the block before.
+ *
+ * Cooper LaPorte March 2023
+ */
+
+#ifndef __POSTINGS_H
+#define __POSTINGS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "counters.h"
+
+/**************** global types ****************/
+typedef struct postings postings_t;    // opaque to users of the module
+typedef struct blockmeta blockmeta_t;  // block metadata loaded from a file, opaque
+
+/**************** postings_blocksFilename ****************/
+/* Return the pathname of the block metadata that goes with an index file,
+ * indexFilename.blocks; caller must free the pathname.
+ */
+char* postings_blocksFilename(const char* indexFilename);
+
+/**************** postings_saveBlocks ****************/
+/* Write the block metadata of every line of a sorted index file.
+ *
+ * Caller provides:
+ *   pathname of an index file whose lines have their docIDs in increasing
+ *   order (as the indexer writes them), and the pathname to write
+ * We return:
+ *   true if the file was written, false if the index could not be read
+ *   (or is not in order) or the file could not be written
+ * Notes:
+ *   reads the index one line at a time
+ */
+bool postings_saveBlocks(const char* indexFilename, const char* blocksFile);
+
+/**************** postings_loadBlocks ****************/
+/* Read the block metadata written by postings_saveBlocks.
+ *
+ * We return:
+ *   the metadata, or NULL if the file cannot be read, is malformed, or is not
+ *   for numWords words; caller must later call postings_unloadBlocks
+ */
+blockmeta_t* postings_loadBlocks(const char* file, const int numWords);
+
+/**************** postings_unloadBlocks ****************/
+/* Free the block metadata */
+void postings_unloadBlocks(blockmeta_t* meta);
+
+/**************** postings_new ****************/
+/* Make the block postings of a word from its counters.
+ *
+ * Caller provides:
+ *   counters of docID -> count, and the block metadata of the index with the
+ *   ordinal of the word, or NULL (and any ordinal) to work out the blocks here
+ * We return:
+ *   the new postings; caller must later call postings_delete
+ * Notes:
+ *   metadata that does not match the postings is ignored
+ */
+postings_t* postings_new(counters_t* ctrs, blockmeta_t* meta, const int ordinal);
+
+/**************** postings_fromArrays ****************/
+/* Make the block postings of a word from arrays of its docIDs and counts.
+ *
+ * Caller provides:
+ *   n docIDs and their counts (e.g. a line of an index, see index_scan), and the
+ *   block metadata of the index with the ordinal of the word, or NULL (and any ordinal)
+ * We return:
+ *   the new postings; caller must later call postings_delete
+ * Notes:
+ *   docIDs out of order are sorted (the last count of a docID given twice is kept),
+ *   and postings with no count are dropped; metadata that does not match is ignored
+ */
+postings_t* postings_fromArrays(const int* docIDs, const int* counts, const int n,
+                                blockmeta_t* meta, const int ordinal);
+
+/**************** postings_size ****************/
+/* Return the number of postings */
+int postings_size(postings_t* p);
+
+/**************** postings_doc, postings_count ****************/
+/* Return the docID, or the count, of posting i (0 <= i < postings_size) */
+int postings_doc(postings_t* p, const int i);
+int postings_count(postings_t* p, const int i);
+
+/**************** postings_iterate ****************/
+/* Call itemfunc(arg, docID, count) on each posting, in order of docID;
+ * quicker than postings_doc for each i when the postings are a bitmap.
+ */
+void postings_iterate(postings_t* p, void* arg,
+                      void (*itemfunc)(void* arg, const int docID, const int count));
+
+/**************** postings_seek ****************/
+/* Return the first posting at or after i whose docID is >= docID, or
+ * postings_size if there is none; whole blocks that end before docID are
+ * stepped over by their last docID.
+ */
+int postings_seek(postings_t* p, const int i, const int docID);
+
+/**************** postings_blockLast ****************/
+/* Return the last docID of the block that posting i is in */
+int postings_blockLast(postings_t* p, const int i);
+
+/**************** postings_blockMax ****************/
+/* Return the largest count in the block that posting i is in */
+int postings_blockMax(postings_t* p, const int i);
+
+/**************** postings_maxCount ****************/
+/* Return the largest count of any posting (0 for none), from the largest of each block */
+int postings_maxCount(postings_t* p);
+
+/**************** postings_and ****************/
+/* Return the documents in both a and b, with the smaller of their two counts.
+ *
+ * Caller provides:
+ *   two postings, either of which may be NULL (no documents)
+ * We return:
+ *   new postings (empty if no document is in both); caller must later call
+ *   postings_delete
+ * Notes:
+ *   two bitmaps are anded a word (64 docIDs) at a time; the postings of an
+ *   array are looked for in a bitmap by their bits; and between two arrays,
+ *   each posting of the shorter is looked for in the longer by galloping: the
+ *   step from the last match doubles until it passes the docID, then a binary
+ *   search in the last step, so the time grows with the shorter times the log
+ *   of the gaps in the longer, rather than with their sum
+ */
+postings_t* postings_and(postings_t* a, postings_t* b);
+
+/**************** postings_or ****************/
+/* Return the documents in a or b, with the sum of their counts.
+ *
+ * Caller provides:
+ *   two postings, either of which may be NULL (no documents)
+ * We return:
+ *   new postings; caller must later call postings_delete
+ * Notes:
+ *   two arrays are merged in one pass, as in a merge sort; with a bitmap, the
+ *   two are ored a word (64 docIDs) at a time
+ */
+postings_t* postings_or(postings_t* a, postings_t* b);
+
+/**************** postings_merge ****************/
+/* Return the documents in any of k postings, with the sum of their counts.
+ *
+ * Caller provides:
+ *   an array of k postings, any of which may be NULL (no documents)
+ * We return:
+ *   new postings; caller must later call postings_delete
+ * Notes:
+ *   the k are merged in one pass, with a heap of the next docID of each, so
+ *   the time grows with their postings times log k (postings_or of each in
+ *   turn would copy the postings so far k times)
+ */
+postings_t* postings_merge(postings_t** lists, const int k);
+
+/**************** postings_delete ****************/
+/* Delete the postings */
+void postings_delete(postings_t* p);
+
+#endif // __POSTINGS_H
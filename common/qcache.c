@@ -0,0 +1,279 @@
+/*
+ * qcache.c - CS50 'qcache' module
+ *
+ * see qcache.h for more information.
+ *
+ * Cooper LaPorte, March 2023
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "mem.h"
+#include "hash.h"
+#include "memtag.h"
+#include "qcache.h"
+
+
+/**************** file-local constants ****************/
+static const int QCACHE_SLOTS = 256;   // hash slots to start with; doubled as results are added
+
+
+/**************** local types ****************/
+/* qentry: a key and its result, in a chain of its hash slot and in the list by last use */
+typedef struct qentry {
+  char* key;
+  char* result;
+  size_t bytes;             // what the entry costs against the budget
+  struct qentry* chain;     // next entry in the same hash slot
+  struct qentry* newer;     // the entry used next after this one, NULL for the newest
+  struct qentry* older;     // the entry used last before this one, NULL for the oldest
+} qentry_t;
+
+struct qcache {
+  qentry_t** slots;
+  int numSlots;
+  qentry_t* newest;         // the entry used most recently
+  qentry_t* oldest;         // the entry used least recently, the next to drop
+  size_t budget;
+  qcache_stats_t stats;
+  pthread_mutex_t lock;
+};
+
+
+static qentry_t** qcache_find(qcache_t* qc, const char* key);
+static void qcache_unlink(qcache_t* qc, qentry_t* e);
+static void qcache_link(qcache_t* qc, qentry_t* e);
+static void qcache_drop(qcache_t* qc, qentry_t* e);
+static void qcache_grow(qcache_t* qc);
+static char* qcache_copy(const char* s);
+
+
+/**************** qcache_new ****************/
+/* see qcache.h for description */
+
+qcache_t*
+qcache_new(const size_t budget){
+  if(budget == 0){
+    return NULL;
+  }
+  qcache_t* qc = memtag_malloc(MEMTAG_QUERY, sizeof(qcache_t), "Error allocating memory");
+  qc->numSlots = QCACHE_SLOTS;
+  qc->slots = memtag_calloc(MEMTAG_QUERY, qc->numSlots, sizeof(qentry_t*), "Error allocating memory");
+  qc->newest = NULL;
+  qc->oldest = NULL;
+  qc->budget = budget;
+  qc->stats = (qcache_stats_t){ 0, 0, 0, 0 };
+  pthread_mutex_init(&qc->lock, NULL);
+  return qc;
+}
+
+
+/**************** qcache_get ****************/
+/* see qcache.h for description */
+
+char*
+qcache_get(qcache_t* qc, const char* key){
+  if(qc == NULL || key == NULL){
+    return NULL;
+  }
+  pthread_mutex_lock(&qc->lock);
+  qentry_t* e = *qcache_find(qc, key);
+  char* result = NULL;
+  if(e != NULL){
+    qc->stats.hits++;
+    qcache_unlink(qc, e); // now the one used most recently
+    qcache_link(qc, e);
+    result = qcache_copy(e->result);
+  } else{
+    qc->stats.misses++;
+  }
+  pthread_mutex_unlock(&qc->lock);
+  return result;
+}
+
+
+/**************** qcache_put ****************/
+/* see qcache.h for description */
+
+bool
+qcache_put(qcache_t* qc, const char* key, const char* result){
+  if(qc == NULL || key == NULL || result == NULL){
+    return false;
+  }
+  size_t bytes = sizeof(qentry_t) + strlen(key) + 1 + strlen(result) + 1;
+  if(bytes > qc->budget){
+    return false;
+  }
+  pthread_mutex_lock(&qc->lock);
+  qentry_t* old = *qcache_find(qc, key);
+  if(old != NULL){ // asked by two threads at once, or changed: keep the new one
+    qcache_drop(qc, old);
+  }
+  while(qc->stats.bytes + bytes > qc->budget){
+    qcache_drop(qc, qc->oldest);
+  }
+  qentry_t* e = memtag_malloc(MEMTAG_QUERY, sizeof(qentry_t), "Error allocating memory");
+  e->key = memtag_malloc(MEMTAG_QUERY, strlen(key) + 1, "Error allocating memory");
+  strcpy(e->key, key);
+  e->result = memtag_malloc(MEMTAG_QUERY, strlen(result) + 1, "Error allocating memory");
+  strcpy(e->result, result);
+  e->bytes = bytes;
+  qentry_t** slot = &qc->slots[hash_jenkins(key, qc->numSlots)];
+  e->chain = *slot;
+  *slot = e;
+  qcache_link(qc, e);
+  qc->stats.entries++;
+  qc->stats.bytes += bytes;
+  if(qc->stats.entries > 2 * qc->numSlots){
+    qcache_grow(qc);
+  }
+  pthread_mutex_unlock(&qc->lock);
+  return true;
+}
+
+
+/**************** qcache_stats ****************/
+/* see qcache.h for description */
+
+qcache_stats_t
+qcache_stats(qcache_t* qc){
+  qcache_stats_t stats = { 0, 0, 0, 0 };
+  if(qc != NULL){
+    pthread_mutex_lock(&qc->lock);
+    stats = qc->stats;
+    pthread_mutex_unlock(&qc->lock);
+  }
+  return stats;
+}
+
+
+/**************** qcache_report ****************/
+/* see qcache.h for description */
+
+void
+qcache_report(qcache_t* qc, FILE* fp, const char* message){
+  if(fp == NULL){
+    return;
+  }
+  qcache_stats_t stats = qcache_stats(qc);
+  long long lookups = stats.hits + stats.misses;
+  fprintf(fp, "%s: %lld hits, %lld misses (%.1f%% hits), %d results in %zu bytes\n",
+          message == NULL ? "query cache" : message, stats.hits, stats.misses,
+          lookups > 0 ? 100.0 * stats.hits / lookups : 0.0, stats.entries, stats.bytes);
+}
+
+
+/**************** qcache_delete ****************/
+/* see qcache.h for description */
+
+void
+qcache_delete(qcache_t* qc){
+  if(qc != NULL){
+    while(qc->oldest != NULL){
+      qcache_drop(qc, qc->oldest);
+    }
+    memtag_free(qc->slots);
+    pthread_mutex_destroy(&qc->lock);
+    memtag_free(qc);
+  }
+}
+
+
+/**************** qcache_find ****************/
+/* Return where the entry for key is linked from in its hash slot (pointing to NULL if there is none) */
+
+static qentry_t**
+qcache_find(qcache_t* qc, const char* key){
+  qentry_t** at = &qc->slots[hash_jenkins(key, qc->numSlots)];
+  while(*at != NULL && strcmp((*at)->key, key) != 0){
+    at = &(*at)->chain;
+  }
+  return at;
+}
+
+
+/**************** qcache_unlink ****************/
+/* Take an entry out of the list by last use */
+
+static void
+qcache_unlink(qcache_t* qc, qentry_t* e){
+  if(e->newer != NULL){
+    e->newer->older = e->older;
+  } else{
+    qc->newest = e->older;
+  }
+  if(e->older != NULL){
+    e->older->newer = e->newer;
+  } else{
+    qc->oldest = e->newer;
+  }
+}
+
+
+/**************** qcache_link ****************/
+/* Put an entry at the front of the list by last use, as the newest */
+
+static void
+qcache_link(qcache_t* qc, qentry_t* e){
+  e->newer = NULL;
+  e->older = qc->newest;
+  if(qc->newest != NULL){
+    qc->newest->newer = e;
+  } else{
+    qc->oldest = e;
+  }
+  qc->newest = e;
+}
+
+
+/**************** qcache_drop ****************/
+/* Take an entry out of its hash slot and the list by last use, and free it */
+
+static void
+qcache_drop(qcache_t* qc, qentry_t* e){
+  qentry_t** at = qcache_find(qc, e->key);
+  *at = e->chain;
+  qcache_unlink(qc, e);
+  qc->stats.entries--;
+  qc->stats.bytes -= e->bytes;
+  memtag_free(e->key);
+  memtag_free(e->result);
+  memtag_free(e);
+}
+
+
+/**************** qcache_grow ****************/
+/* Double the hash slots, moving every entry to its new slot, so the chains stay short */
+
+static void
+qcache_grow(qcache_t* qc){
+  int numSlots = 2 * qc->numSlots;
+  qentry_t** slots = memtag_calloc(MEMTAG_QUERY, numSlots, sizeof(qentry_t*), "Error allocating memory");
+  for(int s = 0; s < qc->numSlots; s++){
+    qentry_t* e = qc->slots[s];
+    while(e != NULL){
+      qentry_t* next = e->chain;
+      qentry_t** slot = &slots[hash_jenkins(e->key, numSlots)];
+      e->chain = *slot;
+      *slot = e;
+      e = next;
+    }
+  }
+  memtag_free(qc->slots);
+  qc->slots = slots;
+  qc->numSlots = numSlots;
+}
+
+
+/**************** qcache_copy ****************/
+/* Return a copy of s, for the caller to free */
+
+static char*
+qcache_copy(const char* s){
+  char* copy = mem_malloc_assert(strlen(s) + 1, "Error allocating memory");
+  strcpy(copy, s);
+  return copy;
+}
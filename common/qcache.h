@@ -0,0 +1,77 @@
+/*
+ * qcache.h - header file for the qcache (query result cache) module
+ *
+ * a bounded cache of the results of queries, so a query asked again is answered
+ * without being evaluated again.  A result is kept as the text printed for it,
+ * under a key given by the caller (a canonical form of the query, so the same
+ * query written two ways is found either way).  The keys and results held are
+ * kept within a budget of bytes; when a new result does not fit, the results
+ * used least recently are dropped until it does.  The hits and misses are
+ * counted, so a report can show how many queries the cache answered.
+ *
+ * The cache has a lock, so several threads may use one cache at once.
+ *
+ * Cooper LaPorte March 2023
+ */
+
+#ifndef __QCACHE_H
+#define __QCACHE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/**************** global types ****************/
+typedef struct qcache qcache_t;  // opaque to users of the module
+
+/* a snapshot of the counters of a cache */
+typedef struct qcache_stats {
+  long long hits;      // lookups that found a result
+  long long misses;    // lookups that did not
+  int entries;         // results held now
+  size_t bytes;        // bytes held now, within the budget
+} qcache_stats_t;
+
+/**************** qcache_new ****************/
+/* Create a new, empty cache holding at most budget bytes of keys and results.
+ *
+ * We return:
+ *   pointer to the new cache, or NULL if budget is 0; caller must later call qcache_delete
+ */
+qcache_t* qcache_new(const size_t budget);
+
+/**************** qcache_get ****************/
+/* Look up the result kept under key, and count the lookup as a hit or a miss.
+ *
+ * We return:
+ *   a copy of the result, or NULL if there is none (or qc is NULL);
+ *   caller must free the copy
+ * Notes:
+ *   a result found becomes the one used most recently
+ */
+char* qcache_get(qcache_t* qc, const char* key);
+
+/**************** qcache_put ****************/
+/* Keep a copy of result under key, replacing any result kept under it.
+ *
+ * We return:
+ *   true if the result is kept; false if it is larger than the whole budget
+ *   (or any argument is NULL)
+ * Notes:
+ *   the results used least recently are dropped until the new one fits
+ */
+bool qcache_put(qcache_t* qc, const char* key, const char* result);
+
+/**************** qcache_stats ****************/
+/* Return a snapshot of the counters of the cache (all zero for NULL) */
+qcache_stats_t qcache_stats(qcache_t* qc);
+
+/**************** qcache_report ****************/
+/* Print the counters of the cache to fp, on one line after message */
+void qcache_report(qcache_t* qc, FILE* fp, const char* message);
+
+/**************** qcache_delete ****************/
+/* Delete the cache and every result in it */
+void qcache_delete(qcache_t* qc);
+
+#endif // __QCACHE_H
@@ -0,0 +1,473 @@
+/*
+ * segment.c - CS50 'segment' module
+ *
+ * see segment.h for more information.
+ *
+ * Cooper LaPorte, March 2023
+ */
+
+#define _POSIX_C_SOURCE 200809L   // fcntl locks, getpid
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "mem.h"
+#include "index.h"
+#include "segment.h"
+#include "crc.h"
+
+
+/**************** file-local constants ****************/
+static const int MERGE_FACTOR = 4;            // merge this many neighbouring segments of a tier
+static const long TIER_BASE = 64 * 1024;      // segments smaller than this are all in tier 0
+static const char* MANIFEST = "segments";
+static const char* MANIFEST_TMP = "segments.tmp";
+static const char* LOCKFILE = "lock";
+static const char* MERGE_LOCKFILE = "merge.lock";
+
+
+/**************** local types ****************/
+/* seginfo: one line of the manifest */
+typedef struct seginfo {
+  int firstDoc;
+  int lastDoc;
+  long bytes;
+  char name[64];
+} seginfo_t;
+
+
+static char* segment_path(const char* indexDir, const char* name);
+static int segment_lock(const char* indexDir, const char* lockName, const bool exclusive, const bool wait);
+static int manifest_read(const char* indexDir, seginfo_t** segs);
+static bool manifest_write(const char* indexDir, seginfo_t* segs, const int n);
+static long file_bytes(const char* path);
+static int segment_tier(const long bytes);
+static int segment_findMerge(seginfo_t* segs, const int n);
+static int segment_mergeOnce(const char* indexDir);
+static bool segment_checksum(const char* path);
+static bool segment_rename(const char* path, const char* segPath);
+static void segment_remove(const char* path);
+
+
+/**************** segment_init ****************/
+/* see segment.h for description */
+
+bool
+segment_init(const char* indexDir){
+  if(indexDir == NULL){
+    return false;
+  }
+  if(segment_isIndexDir(indexDir)){
+    return true;
+  }
+  int lock = segment_lock(indexDir, LOCKFILE, true, true);
+  if(lock < 0){
+    return false;
+  }
+  bool ok = segment_isIndexDir(indexDir) || manifest_write(indexDir, NULL, 0);
+  close(lock);
+  return ok;
+}
+
+
+/**************** segment_isIndexDir ****************/
+/* see segment.h for description */
+
+bool
+segment_isIndexDir(const char* path){
+  if(path == NULL){
+    return false;
+  }
+  char* manifest = segment_path(path, MANIFEST);
+  FILE* fp = fopen(manifest, "r");
+  mem_free(manifest);
+  if(fp == NULL){
+    return false;
+  }
+  fclose(fp);
+  return true;
+}
+
+
+/**************** segment_lastDoc ****************/
+/* see segment.h for description */
+
+int
+segment_lastDoc(const char* indexDir){
+  int lock = segment_lock(indexDir, LOCKFILE, false, true);
+  seginfo_t* segs = NULL;
+  int n = manifest_read(indexDir, &segs);
+  if(lock >= 0){
+    close(lock);
+  }
+  int lastDoc = n > 0 ? segs[n - 1].lastDoc : 0;
+  if(segs != NULL){
+    mem_free(segs);
+  }
+  return lastDoc;
+}
+
+
+/**************** segment_newPath ****************/
+/* see segment.h for description */
+
+char*
+segment_newPath(const char* indexDir){
+  char name[64];
+  sprintf(name, "new-%ld", (long)getpid()); // unique among processes writing segments
+  return segment_path(indexDir, name);
+}
+
+
+/**************** segment_publish ****************/
+/* see segment.h for description */
+
+bool
+segment_publish(const char* indexDir, const char* path, const int firstDoc, const int lastDoc){
+  if(indexDir == NULL || path == NULL || firstDoc <= 0 || lastDoc < firstDoc){
+    return false;
+  }
+  int lock = segment_checksum(path) ? segment_lock(indexDir, LOCKFILE, true, true) : -1;
+  if(lock < 0){
+    segment_remove(path);
+    return false;
+  }
+  seginfo_t* segs = NULL;
+  int n = manifest_read(indexDir, &segs);
+  bool ok = n >= 0 && (n == 0 || segs[n - 1].lastDoc < firstDoc);
+  if(ok){
+    segs = mem_assert(realloc(segs, (n + 1) * sizeof(seginfo_t)), "Error allocating memory");
+    seginfo_t* seg = &segs[n];
+    seg->firstDoc = firstDoc;
+    seg->lastDoc = lastDoc;
+    seg->bytes = file_bytes(path);
+    sprintf(seg->name, "seg-%d-%d", firstDoc, lastDoc);
+    char* segPath = segment_path(indexDir, seg->name);
+    ok = segment_rename(path, segPath) && manifest_write(indexDir, segs, n + 1);
+    if(!ok){
+      segment_remove(segPath);
+    }
+    mem_free(segPath);
+  }
+  if(!ok){
+    segment_remove(path);
+  }
+  if(segs != NULL){
+    mem_free(segs);
+  }
+  close(lock);
+  return ok;
+}
+
+
+/**************** segment_iterate ****************/
+/* see segment.h for description */
+
+int
+segment_iterate(const char* indexDir, void* arg,
+                void (*itemfunc)(void* arg, const char* segmentPath)){
+  if(indexDir == NULL){
+    return -1;
+  }
+  int lock = segment_lock(indexDir, LOCKFILE, false, true);
+  seginfo_t* segs = NULL;
+  int n = manifest_read(indexDir, &segs);
+  for(int s = 0; s < n && itemfunc != NULL; s++){
+    char* segPath = segment_path(indexDir, segs[s].name);
+    (*itemfunc)(arg, segPath);
+    mem_free(segPath);
+  }
+  if(segs != NULL){
+    mem_free(segs);
+  }
+  if(lock >= 0){
+    close(lock);
+  }
+  return n;
+}
+
+
+/**************** segment_compact ****************/
+/* see segment.h for description */
+
+int
+segment_compact(const char* indexDir){
+  if(indexDir == NULL){
+    return -1;
+  }
+  int mergeLock = segment_lock(indexDir, MERGE_LOCKFILE, true, false);
+  if(mergeLock < 0){
+    return 0; // someone else is compacting; they will see our segments too
+  }
+  int merges = 0;
+  int merged;
+  while((merged = segment_mergeOnce(indexDir)) > 0){
+    merges++;
+  }
+  close(mergeLock);
+  return merged < 0 ? -1 : merges;
+}
+
+
+/**************** segment_findMerge ****************/
+/* the merge policy: find the oldest MERGE_FACTOR neighbouring segments
+ * that are all in the same tier; returns the first of them, or -1 if none
+ */
+
+static int
+segment_findMerge(seginfo_t* segs, const int n){
+  int run = 0;
+  for(int s = 0; s < n; s++){
+    run = (s > 0 && segment_tier(segs[s].bytes) == segment_tier(segs[s - 1].bytes)) ? run + 1 : 1;
+    if(run == MERGE_FACTOR){
+      return s - MERGE_FACTOR + 1;
+    }
+  }
+  return -1;
+}
+
+
+/**************** segment_mergeOnce ****************/
+/* merge one group of segments chosen by segment_findMerge into a single segment;
+ * the merge itself runs without the manifest lock, so readers and new segments
+ * are not held up, and only the manifest swap takes the exclusive lock.
+ * Returns 1 if a merge was done, 0 if there was nothing to merge, -1 if it failed.
+ */
+
+static int
+segment_mergeOnce(const char* indexDir){
+  seginfo_t* segs = NULL;
+  int lock = segment_lock(indexDir, LOCKFILE, false, true);
+  int n = manifest_read(indexDir, &segs);
+  if(lock >= 0){
+    close(lock);
+  }
+  int start = segment_findMerge(segs, n);
+  if(start < 0){
+    if(segs != NULL){
+      mem_free(segs);
+    }
+    return 0;
+  }
+
+  // merge the segments, which are in docID order, into a new segment
+  seginfo_t* parts = mem_malloc_assert(MERGE_FACTOR * sizeof(seginfo_t), "Error allocating memory");
+  char** paths = mem_malloc_assert(MERGE_FACTOR * sizeof(char*), "Error allocating memory");
+  memcpy(parts, &segs[start], MERGE_FACTOR * sizeof(seginfo_t));
+  mem_free(segs);
+  for(int s = 0; s < MERGE_FACTOR; s++){
+    paths[s] = segment_path(indexDir, parts[s].name);
+  }
+  char* newPath = segment_newPath(indexDir);
+  bool ok = index_merge((const char**)paths, MERGE_FACTOR, newPath) && segment_checksum(newPath);
+
+  if(ok){
+    // swap the merged segment in for its parts; only this process merges, and
+    // new segments are only ever appended, so the parts are still in the manifest
+    lock = segment_lock(indexDir, LOCKFILE, true, true);
+    segs = NULL;
+    n = manifest_read(indexDir, &segs);
+    int at = -1;
+    for(int s = 0; s < n; s++){
+      if(strcmp(segs[s].name, parts[0].name) == 0){
+        at = s;
+      }
+    }
+    ok = lock >= 0 && at >= 0 && at + MERGE_FACTOR <= n
+         && strcmp(segs[at + MERGE_FACTOR - 1].name, parts[MERGE_FACTOR - 1].name) == 0;
+    if(ok){
+      seginfo_t* seg = &segs[at];
+      seg->lastDoc = parts[MERGE_FACTOR - 1].lastDoc;
+      seg->bytes = file_bytes(newPath);
+      sprintf(seg->name, "seg-%d-%d", seg->firstDoc, seg->lastDoc);
+      memmove(&segs[at + 1], &segs[at + MERGE_FACTOR], (n - at - MERGE_FACTOR) * sizeof(seginfo_t));
+      char* segPath = segment_path(indexDir, seg->name);
+      ok = segment_rename(newPath, segPath) && manifest_write(indexDir, segs, n - MERGE_FACTOR + 1);
+      mem_free(segPath);
+    }
+    if(segs != NULL){
+      mem_free(segs);
+    }
+    if(lock >= 0){
+      close(lock);
+    }
+  }
+  if(ok){
+    for(int s = 0; s < MERGE_FACTOR; s++){ // no reader can start on the parts any more
+      segment_remove(paths[s]);
+    }
+  } else{
+    segment_remove(newPath);
+  }
+  for(int s = 0; s < MERGE_FACTOR; s++){
+    mem_free(paths[s]);
+  }
+  mem_free(paths);
+  mem_free(parts);
+  mem_free(newPath);
+  return ok ? 1 : -1;
+}
+
+
+/**************** segment_checksum ****************/
+/* write the checksums of the segment at path to path.crc, before it is published,
+ * so a reader can tell a segment cut short from a whole one; false if they cannot be written
+ */
+
+static bool
+segment_checksum(const char* path){
+  char* crcFile = crc_filename(path);
+  bool ok = crc_save(path, crcFile);
+  mem_free(crcFile);
+  return ok;
+}
+
+
+/**************** segment_rename ****************/
+/* rename the segment at path, and its checksums, to segPath; the checksums go first,
+ * so once the segment is in place they are too
+ */
+
+static bool
+segment_rename(const char* path, const char* segPath){
+  char* crcFile = crc_filename(path);
+  char* segCrcFile = crc_filename(segPath);
+  bool ok = rename(crcFile, segCrcFile) == 0 && rename(path, segPath) == 0;
+  mem_free(crcFile);
+  mem_free(segCrcFile);
+  return ok;
+}
+
+
+/**************** segment_remove ****************/
+/* remove the segment at path and its checksums */
+
+static void
+segment_remove(const char* path){
+  char* crcFile = crc_filename(path);
+  remove(crcFile);
+  remove(path);
+  mem_free(crcFile);
+}
+
+
+/**************** segment_tier ****************/
+/* the size tier of a segment: 0 below TIER_BASE bytes, then one more
+ * for every factor of MERGE_FACTOR in size
+ */
+
+static int
+segment_tier(const long bytes){
+  int tier = 0;
+  for(long size = TIER_BASE; bytes >= size; size *= MERGE_FACTOR){
+    tier++;
+  }
+  return tier;
+}
+
+
+/**************** segment_lock ****************/
+/* take a shared or exclusive lock on the named lock file of indexDir,
+ * waiting for it if wait is true; returns the descriptor holding the lock
+ * (close it to unlock), or -1 if the lock could not be taken
+ */
+
+static int
+segment_lock(const char* indexDir, const char* lockName, const bool exclusive, const bool wait){
+  char* path = segment_path(indexDir, lockName);
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  mem_free(path);
+  if(fd < 0){
+    return -1;
+  }
+  struct flock fl;
+  memset(&fl, 0, sizeof(fl));
+  fl.l_type = exclusive ? F_WRLCK : F_RDLCK;
+  fl.l_whence = SEEK_SET;
+  if(fcntl(fd, wait ? F_SETLKW : F_SETLK, &fl) < 0){
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+
+/**************** manifest_read ****************/
+/* read the manifest into a new array (caller frees it);
+ * returns the number of segments, or -1 if the manifest cannot be read
+ */
+
+static int
+manifest_read(const char* indexDir, seginfo_t** segs){
+  char* path = segment_path(indexDir, MANIFEST);
+  FILE* fp = fopen(path, "r");
+  mem_free(path);
+  *segs = NULL;
+  if(fp == NULL){
+    return -1;
+  }
+  int n = 0;
+  int cap = 8;
+  *segs = mem_malloc_assert(cap * sizeof(seginfo_t), "Error allocating memory");
+  seginfo_t seg;
+  while(fscanf(fp, "%d %d %ld %63s", &seg.firstDoc, &seg.lastDoc, &seg.bytes, seg.name) == 4){
+    if(n == cap){
+      cap *= 2;
+      *segs = mem_assert(realloc(*segs, cap * sizeof(seginfo_t)), "Error allocating memory");
+    }
+    (*segs)[n++] = seg;
+  }
+  fclose(fp);
+  return n;
+}
+
+
+/**************** manifest_write ****************/
+/* write a new manifest and rename it into place, so readers never see a partial one */
+
+static bool
+manifest_write(const char* indexDir, seginfo_t* segs, const int n){
+  char* tmp = segment_path(indexDir, MANIFEST_TMP);
+  char* path = segment_path(indexDir, MANIFEST);
+  FILE* fp = fopen(tmp, "w");
+  bool ok = fp != NULL;
+  if(ok){
+    for(int s = 0; s < n; s++){
+      fprintf(fp, "%d %d %ld %s\n", segs[s].firstDoc, segs[s].lastDoc, segs[s].bytes, segs[s].name);
+    }
+    ok = !ferror(fp);
+    ok = (fclose(fp) == 0) && ok;
+    ok = ok && rename(tmp, path) == 0;
+  }
+  mem_free(tmp);
+  mem_free(path);
+  return ok;
+}
+
+
+/**************** file_bytes ****************/
+/* size of the file at path, or 0 if it cannot be found */
+
+static long
+file_bytes(const char* path){
+  struct stat st;
+  if(stat(path, &st) != 0){
+    return 0;
+  }
+  return (long)st.st_size;
+}
+
+
+/**************** segment_path ****************/
+/* build the pathname indexDir/name; caller must free it */
+
+static char*
+segment_path(const char* indexDir, const char* name){
+  char* path = mem_malloc_assert(strlen(indexDir) + strlen(name) + 2, "Error allocating memory");
+  sprintf(path, "%s/%s", indexDir, name);
+  return path;
+}
@@ -0,0 +1,107 @@
+/*
+ * segment.h - header file for the segment module
+ *
+ * an index directory holds an index as a list of immutable segments, each an
+ * ordinary (sorted) index file covering a contiguous range of docIDs, plus a
+ * manifest file 'segments' listing the live segments in docID order:
+ *
+ *   firstDoc lastDoc bytes name
+ *
+ * New documents are indexed into a new small segment, so adding pages costs
+ * time in proportion to the new pages rather than to the whole corpus.
+ * A merge policy compacts runs of similar-sized neighbouring segments into
+ * bigger ones so the number of segments stays logarithmic in the corpus size.
+ *
+ * Each segment has its checksums beside it (name.crc, see crc.h), written
+ * before it is published, so a reader can check every live segment.
+ *
+ * Changes to the manifest are made under an exclusive lock on 'lock' in the
+ * index directory and by renaming a new manifest into place, so a reader that
+ * holds the shared lock always sees a complete set of live segments.
+ *
+ * Cooper LaPorte March 2023
+ */
+
+#ifndef __SEGMENT_H
+#define __SEGMENT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+
+/**************** segment_init ****************/
+/* Make the given directory an index directory, if it is not already one.
+ *
+ * Caller provides:
+ *   pathname of an existing, writable directory
+ * We return:
+ *   true if the directory has a manifest (possibly empty)
+ *   false if the manifest could not be created
+ */
+bool segment_init(const char* indexDir);
+
+/**************** segment_isIndexDir ****************/
+/* Return true if the given pathname is an index directory (has a manifest).
+ */
+bool segment_isIndexDir(const char* path);
+
+/**************** segment_lastDoc ****************/
+/* Return the largest docID covered by the live segments, or 0 if there are none.
+ *
+ * Caller provides:
+ *   valid index directory
+ */
+int segment_lastDoc(const char* indexDir);
+
+/**************** segment_newPath ****************/
+/* Return a pathname inside indexDir where a new segment can be written before
+ * it is published; caller must free the pathname.
+ */
+char* segment_newPath(const char* indexDir);
+
+/**************** segment_publish ****************/
+/* Make the index file at path a live segment covering docIDs firstDoc..lastDoc,
+ * with its checksums.
+ *
+ * Caller provides:
+ *   valid index directory, pathname of a sorted index file inside it (as from
+ *   segment_newPath), and the range of docIDs it covers, which must come after
+ *   every live segment
+ * We return:
+ *   true if its checksums were written, and it was renamed into place (with them)
+ *   and added to the manifest
+ *   false if not (the file is then removed)
+ */
+bool segment_publish(const char* indexDir, const char* path, const int firstDoc, const int lastDoc);
+
+/**************** segment_iterate ****************/
+/* Call itemfunc on the pathname of each live segment, in docID order.
+ *
+ * Caller provides:
+ *   valid index directory, arbitrary arg, and the function to call
+ * Notes:
+ *   holds the shared lock during the iteration, so no segment is merged
+ *   away (and removed) while itemfunc reads it
+ * We return:
+ *   number of live segments, or -1 if the manifest cannot be read
+ */
+int segment_iterate(const char* indexDir, void* arg,
+                    void (*itemfunc)(void* arg, const char* segmentPath));
+
+/**************** segment_compact ****************/
+/* Apply the merge policy: while there are MERGE_FACTOR neighbouring segments of
+ * the same size tier, merge them into one segment of the next tier.
+ *
+ * Caller provides:
+ *   valid index directory
+ * Notes:
+ *   meant to run in the background (in a child process) after a new segment
+ *   is published; only one compaction runs at a time, any other returns at once.
+ *   Readers keep using the old segments until the manifest is replaced.
+ * We return:
+ *   number of merges done, or -1 if a merge failed
+ */
+int segment_compact(const char* indexDir);
+
+#endif // __SEGMENT_H
@@ -0,0 +1,311 @@
+/*
+ * spimi.c - CS50 'spimi' module
+ *
+ * see spimi.h for more information.
+ *
+ * Cooper LaPorte, March 2023
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "mem.h"
+#include "memtag.h"
+#include "hashtable.h"
+#include "index.h"
+#include "spimi.h"
+
+
+/**************** file-local constants ****************/
+static const int SPIMI_SLOTS = 65536;     // hashtable slots for the in-memory index
+static const size_t TERM_OVERHEAD = 96;   // estimated bytes of hashtable/set node, key copy, and postlist per term
+static const int POSTLIST_MIN = 4;        // initial postings capacity of a new term
+
+
+/**************** local types ****************/
+/* postlist: the growable postings list of one term in the in-memory index;
+ * docIDs are in increasing order, counts[i] is the count for docs[i]
+ */
+typedef struct postlist {
+  int n;             // number of postings
+  int cap;           // capacity of the arrays
+  int* docs;
+  int* counts;
+} postlist_t;
+
+/* termpair: a word and its postings, used to sort the in-memory index */
+typedef struct termpair {
+  const char* word;
+  postlist_t* pl;
+} termpair_t;
+
+/* termarray: the array of termpairs being gathered from the hashtable */
+typedef struct termarray {
+  int n;
+  termpair_t* pairs;
+} termarray_t;
+
+struct spimi {
+  char* indexFilename;
+  size_t budget;     // 0 means unlimited
+  size_t used;       // estimated bytes used by the in-memory index
+  int numTerms;      // number of terms in the in-memory index
+  int numRuns;       // number of runs flushed so far
+  int lastDoc;       // docID of the most recent occurrence
+  hashtable_t* ht;   // word -> postlist_t
+};
+
+
+static postlist_t* postlist_new(void);
+static void postlist_delete(void* item);
+static size_t postlist_append(postlist_t* pl, const int docID);
+static void termarray_helper(void* arg, const char* key, void* item);
+static int termpair_cmp(const void* a, const void* b);
+static bool spimi_flush(spimi_t* spimi, const char* filename);
+static char* spimi_runName(spimi_t* spimi, const int run);
+static bool spimi_merge(spimi_t* spimi);
+
+
+/**************** spimi_new ****************/
+/* see spimi.h for description */
+
+spimi_t*
+spimi_new(const char* indexFilename, const size_t budget){
+  if(indexFilename == NULL){
+    return NULL;
+  }
+  spimi_t* spimi = mem_malloc_assert(sizeof(spimi_t), "Error allocating memory");
+  spimi->indexFilename = mem_malloc_assert(strlen(indexFilename) + 1, "Error allocating memory");
+  strcpy(spimi->indexFilename, indexFilename);
+  spimi->budget = budget;
+  spimi->used = 0;
+  spimi->numTerms = 0;
+  spimi->numRuns = 0;
+  spimi->lastDoc = 0;
+  spimi->ht = mem_assert(hashtable_new(SPIMI_SLOTS), "Error allocating memory");
+  return spimi;
+}
+
+
+/**************** spimi_add ****************/
+/* see spimi.h for description */
+
+bool
+spimi_add(spimi_t* spimi, const char* word, const int docID){
+  if(spimi == NULL || word == NULL || docID <= 0){
+    return false;
+  }
+  if(spimi->budget != 0 && spimi->used >= spimi->budget && docID != spimi->lastDoc){
+    // over budget: write what we have as a sorted run and start over;
+    // we only do so between documents, so no posting is split across runs
+    char* run = spimi_runName(spimi, spimi->numRuns);
+    bool ok = spimi_flush(spimi, run);
+    mem_free(run);
+    spimi->numRuns++;
+    if(!ok){
+      return false;
+    }
+  }
+  spimi->lastDoc = docID;
+
+  postlist_t* pl = hashtable_find(spimi->ht, word);
+  if(pl == NULL){ // first time we see this word in this run
+    pl = postlist_new();
+    if(!hashtable_insert(spimi->ht, word, pl)){
+      mem_assert(NULL, "Error allocating memory");
+    }
+    spimi->used += strlen(word) + 1 + TERM_OVERHEAD + 2 * POSTLIST_MIN * sizeof(int);
+    spimi->numTerms++;
+  }
+  spimi->used += postlist_append(pl, docID);
+  return true;
+}
+
+
+/**************** spimi_finish ****************/
+/* see spimi.h for description */
+
+bool
+spimi_finish(spimi_t* spimi){
+  if(spimi == NULL){
+    return false;
+  }
+  bool ok;
+  if(spimi->numRuns == 0){
+    // everything fit in memory: write the index file directly
+    ok = spimi_flush(spimi, spimi->indexFilename);
+  } else{
+    ok = true;
+    if(spimi->numTerms > 0){ // the last partial run
+      char* run = spimi_runName(spimi, spimi->numRuns);
+      ok = spimi_flush(spimi, run);
+      mem_free(run);
+      spimi->numRuns++;
+    }
+    ok = ok && spimi_merge(spimi);
+    for(int r = 0; r < spimi->numRuns; r++){ // runs are no longer needed
+      char* run = spimi_runName(spimi, r);
+      remove(run);
+      mem_free(run);
+    }
+  }
+  hashtable_delete(spimi->ht, postlist_delete);
+  mem_free(spimi->indexFilename);
+  mem_free(spimi);
+  return ok;
+}
+
+
+/**************** spimi_numRuns ****************/
+/* see spimi.h for description */
+
+int
+spimi_numRuns(spimi_t* spimi){
+  return spimi == NULL ? 0 : spimi->numRuns;
+}
+
+
+/**************** spimi_flush ****************/
+/* sort the in-memory index by word and write it to filename,
+ * then empty the in-memory index
+ */
+
+static bool
+spimi_flush(spimi_t* spimi, const char* filename){
+  FILE* fp = fopen(filename, "w");
+  if(fp == NULL){
+    return false;
+  }
+  termarray_t terms = { 0, NULL };
+  terms.pairs = mem_malloc_assert((spimi->numTerms + 1) * sizeof(termpair_t), "Error allocating memory");
+  hashtable_iterate(spimi->ht, &terms, termarray_helper);
+  qsort(terms.pairs, terms.n, sizeof(termpair_t), termpair_cmp);
+  for(int t = 0; t < terms.n; t++){
+    postlist_t* pl = terms.pairs[t].pl;
+    fprintf(fp, "%s ", terms.pairs[t].word);
+    for(int i = 0; i < pl->n; i++){
+      fprintf(fp, "%d %d ", pl->docs[i], pl->counts[i]);
+    }
+    fprintf(fp, "\n");
+  }
+  mem_free(terms.pairs);
+  bool ok = !ferror(fp);
+  if(fclose(fp) != 0){
+    ok = false;
+  }
+  hashtable_delete(spimi->ht, postlist_delete); // start a fresh in-memory index
+  spimi->ht = mem_assert(hashtable_new(SPIMI_SLOTS), "Error allocating memory");
+  spimi->used = 0;
+  spimi->numTerms = 0;
+  return ok;
+}
+
+
+/**************** spimi_merge ****************/
+/* merge all the runs into the index file; since runs were flushed in
+ * docID order, index_merge keeps each line in increasing docID order
+ */
+
+static bool
+spimi_merge(spimi_t* spimi){
+  char** runs = mem_malloc_assert(spimi->numRuns * sizeof(char*), "Error allocating memory");
+  for(int r = 0; r < spimi->numRuns; r++){
+    runs[r] = spimi_runName(spimi, r);
+  }
+  bool ok = index_merge((const char**)runs, spimi->numRuns, spimi->indexFilename);
+  for(int r = 0; r < spimi->numRuns; r++){
+    mem_free(runs[r]);
+  }
+  mem_free(runs);
+  return ok;
+}
+
+
+/**************** spimi_runName ****************/
+/* build the pathname of a run file; caller must free it */
+
+static char*
+spimi_runName(spimi_t* spimi, const int run){
+  char* name = mem_malloc_assert(strlen(spimi->indexFilename) + 20, "Error allocating memory");
+  sprintf(name, "%s.run%d", spimi->indexFilename, run);
+  return name;
+}
+
+
+/**************** postlist_new ****************/
+/* Allocate and initialize an empty postlist */
+
+static postlist_t*
+postlist_new(void){
+  postlist_t* pl = memtag_malloc(MEMTAG_POSTINGS, sizeof(postlist_t), "Error allocating memory");
+  pl->n = 0;
+  pl->cap = POSTLIST_MIN;
+  pl->docs = memtag_malloc(MEMTAG_POSTINGS, pl->cap * sizeof(int), "Error allocating memory");
+  pl->counts = memtag_malloc(MEMTAG_POSTINGS, pl->cap * sizeof(int), "Error allocating memory");
+  return pl;
+}
+
+
+/**************** postlist_append ****************/
+/* count one more occurrence of docID; since docIDs arrive in increasing
+ * order, docID is either the last posting or a new one at the end.
+ * Returns the number of bytes the postlist grew by.
+ */
+
+static size_t
+postlist_append(postlist_t* pl, const int docID){
+  if(pl->n > 0 && pl->docs[pl->n - 1] == docID){
+    pl->counts[pl->n - 1]++;
+    return 0;
+  }
+  size_t grown = 0;
+  if(pl->n == pl->cap){
+    int cap = pl->cap * 2;
+    pl->docs = memtag_realloc(MEMTAG_POSTINGS, pl->docs, cap * sizeof(int), "Error allocating memory");
+    pl->counts = memtag_realloc(MEMTAG_POSTINGS, pl->counts, cap * sizeof(int), "Error allocating memory");
+    grown = 2 * (cap - pl->cap) * sizeof(int);
+    pl->cap = cap;
+  }
+  pl->docs[pl->n] = docID;
+  pl->counts[pl->n] = 1;
+  pl->n++;
+  return grown;
+}
+
+
+/**************** postlist_delete ****************/
+/* hashtable itemdelete for postlists */
+
+static void
+postlist_delete(void* item){
+  postlist_t* pl = item;
+  if(pl != NULL){
+    memtag_free(pl->docs);
+    memtag_free(pl->counts);
+    memtag_free(pl);
+  }
+}
+
+
+/**************** termarray_helper ****************/
+/* Helper function for hashtable_iterate to gather the terms into an array */
+
+static void
+termarray_helper(void* arg, const char* key, void* item){
+  termarray_t* terms = arg;
+  terms->pairs[terms->n].word = key;
+  terms->pairs[terms->n].pl = item;
+  terms->n++;
+}
+
+
+/**************** termpair_cmp ****************/
+/* qsort comparison of termpairs by word */
+
+static int
+termpair_cmp(const void* a, const void* b){
+  const termpair_t* pa = a;
+  const termpair_t* pb = b;
+  return strcmp(pa->word, pb->word);
+}
@@ -0,0 +1,75 @@
+/*
+ * spimi.h - header file for the spimi (single-pass in-memory indexing) module
+ *
+ * builds an index one (word, docID) occurrence at a time, keeping the postings
+ * in memory until a memory budget is reached; at that point the in-memory index
+ * is sorted by word and flushed to disk as a partial index (a "run"), and a
+ * fresh in-memory index is started.  When indexing is finished the runs are
+ * merged (k-way, in word order) into the final index file, so the size of the
+ * corpus that can be indexed is bounded by disk rather than by memory.
+ *
+ * Runs and the final index file use the same format as index_fill, except that
+ * lines are sorted by word and the docIDs in each line are in increasing order.
+ * Docs must be added in increasing docID order.
+ *
+ * Cooper LaPorte March 2023
+ */
+
+#ifndef __SPIMI_H
+#define __SPIMI_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/**************** global types ****************/
+typedef struct spimi spimi_t;  // opaque to users of the module
+
+/**************** spimi_new ****************/
+/* Create a new (empty) spimi index that will be written to indexFilename.
+ *
+ * Caller provides:
+ *   valid pathname for the final index file,
+ *   memory budget in bytes for the in-memory index (0 means no budget)
+ * We return:
+ *   pointer to a new spimi index, or NULL if error
+ * Notes:
+ *   runs are written beside the index file, as indexFilename.run0, .run1, ...
+ *   caller is responsible for calling spimi_finish
+ */
+spimi_t* spimi_new(const char* indexFilename, const size_t budget);
+
+/**************** spimi_add ****************/
+/* Record one occurrence of word in the document docID.
+ *
+ * Caller provides:
+ *   valid spimi index, normalized word, and docID > 0
+ * We return:
+ *   true if the occurrence was recorded
+ *   false if bad parameters or a run could not be written to disk
+ * Notes:
+ *   docIDs must be given in increasing order (all words of one document,
+ *   then all words of the next document, ...)
+ *   may flush a run to disk, between documents, once the memory budget is reached
+ */
+bool spimi_add(spimi_t* spimi, const char* word, const int docID);
+
+/**************** spimi_finish ****************/
+/* Write the final index file, remove the runs, and free the spimi index.
+ *
+ * Caller provides:
+ *   valid spimi index
+ * We return:
+ *   true if the index file was written
+ *   false if any run or the index file could not be written or read back
+ * Notes:
+ *   the spimi index must not be used after this call
+ */
+bool spimi_finish(spimi_t* spimi);
+
+/**************** spimi_numRuns ****************/
+/* Return the number of runs flushed to disk so far.
+ */
+int spimi_numRuns(spimi_t* spimi);
+
+#endif // __SPIMI_H
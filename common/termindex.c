@@ -0,0 +1,323 @@
+/*
+ * termindex.c - CS50 'termindex' module
+ *
+ * see termindex.h for more information.
+ *
+ * Cooper LaPorte, March 2023
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "mem.h"
+#include "index.h"
+#include "segment.h"
+#include "dict.h"
+#include "postings.h"
+#include "termindex.h"
+
+
+/**************** local types ****************/
+struct termindex {
+  dict_t* dict;
+  postings_t** postings;   // postings[ordinal], made while loading and not changed after
+  int numTerms;
+};
+
+/* loadterm: a word and its postings while loading */
+typedef struct loadterm {
+  char* word;
+  postings_t* postings;
+  int order;               // place in the files, to keep duplicates in file order
+} loadterm_t;
+
+/* termlist: the words gathered while loading */
+typedef struct termlist {
+  int n;
+  int cap;
+  loadterm_t* terms;
+  bool sorted;             // every word so far came after the one before it
+  bool ok;
+  blockmeta_t* meta;       // block metadata from indexFilename.blocks, by line, or NULL
+} termlist_t;
+
+/* termiter: the state of termindex_iterate, passed through dict_iterate */
+typedef struct termiter {
+  termindex_t* ti;
+  void* arg;
+  void (*itemfunc)(void* arg, const int ordinal, const char* word, postings_t* postings);
+} termiter_t;
+
+/* dictcheck: the state of comparing a dictionary with the loaded words */
+typedef struct dictcheck {
+  termlist_t* list;
+  bool same;
+} dictcheck_t;
+
+
+static void termlist_helper(void* arg, const char* word, const int* docIDs, const int* counts, const int n);
+static void segment_scan_helper(void* arg, const char* segmentPath);
+static void dictcheck_helper(void* arg, const int ordinal, const char* word);
+static int loadterm_cmp(const void* a, const void* b);
+static void termindex_iterate_helper(void* arg, const int ordinal, const char* word);
+
+
+/**************** termindex_load ****************/
+/* see termindex.h for description */
+
+termindex_t*
+termindex_load(const char* indexFilename){
+  if(indexFilename == NULL){
+    return NULL;
+  }
+  termlist_t list = { 0, 0, NULL, true, true, NULL };
+  dict_t* dict = NULL;
+  if(segment_isIndexDir(indexFilename)){
+    // segments have words in common, so they are always sorted and merged below
+    list.ok = segment_iterate(indexFilename, &list, segment_scan_helper) >= 0 && list.ok;
+    list.sorted = false;
+  } else{
+    char* dictFile = dict_filename(indexFilename);
+    dict = dict_load(dictFile);
+    mem_free(dictFile);
+    if(dict != NULL){ // the block metadata goes by the lines of the file, as the dictionary does
+      char* blocksFile = postings_blocksFilename(indexFilename);
+      list.meta = postings_loadBlocks(blocksFile, dict_size(dict));
+      mem_free(blocksFile);
+    }
+    list.ok = index_scan(indexFilename, &list, termlist_helper);
+    postings_unloadBlocks(list.meta);
+    if(dict != NULL){ // use the saved dictionary only if it has exactly the words of the index
+      dictcheck_t check = { &list, list.ok && list.sorted && dict_size(dict) == list.n };
+      if(check.same){
+        dict_iterate(dict, &check, dictcheck_helper);
+      }
+      if(!check.same){
+        dict_delete(dict);
+        dict = NULL;
+      }
+    }
+  }
+  if(!list.ok){
+    for(int i = 0; i < list.n; i++){
+      mem_free(list.terms[i].word);
+      postings_delete(list.terms[i].postings);
+    }
+    if(list.terms != NULL){
+      mem_free(list.terms);
+    }
+    return NULL;
+  }
+
+  termindex_t* ti = mem_malloc_assert(sizeof(termindex_t), "Error allocating memory");
+  ti->postings = mem_malloc_assert((list.n + 1) * sizeof(postings_t*), "Error allocating memory");
+  ti->numTerms = 0;
+  if(dict != NULL){ // the words are in dictionary order already
+    for(int i = 0; i < list.n; i++){
+      ti->postings[ti->numTerms++] = list.terms[i].postings;
+      mem_free(list.terms[i].word);
+    }
+  } else{ // sort the words, merge the postings of repeated words, and build the dictionary
+    if(!list.sorted){
+      qsort(list.terms, list.n, sizeof(loadterm_t), loadterm_cmp);
+    }
+    dict = dict_new();
+    postings_t** repeats = mem_malloc_assert((list.n + 1) * sizeof(postings_t*), "Error allocating memory");
+    for(int i = 0; i < list.n; ){
+      int j = i + 1;
+      while(j < list.n && strcmp(list.terms[j].word, list.terms[i].word) == 0){
+        j++;
+      }
+      dict_add(dict, list.terms[i].word);
+      if(j - i == 1){
+        ti->postings[ti->numTerms++] = list.terms[i].postings;
+      } else{ // the same word in several segments (or lines): merged in one pass
+        for(int k = i; k < j; k++){
+          repeats[k - i] = list.terms[k].postings;
+        }
+        ti->postings[ti->numTerms++] = postings_merge(repeats, j - i);
+        for(int k = i; k < j; k++){
+          postings_delete(list.terms[k].postings);
+        }
+      }
+      for(int k = i; k < j; k++){
+        mem_free(list.terms[k].word);
+      }
+      i = j;
+    }
+    mem_free(repeats);
+  }
+  if(list.terms != NULL){
+    mem_free(list.terms);
+  }
+  ti->dict = dict;
+  return ti;
+}
+
+
+/**************** termindex_numTerms ****************/
+/* see termindex.h for description */
+
+int
+termindex_numTerms(termindex_t* ti){
+  return ti == NULL ? 0 : ti->numTerms;
+}
+
+
+/**************** termindex_ordinal ****************/
+/* see termindex.h for description */
+
+int
+termindex_ordinal(termindex_t* ti, const char* word){
+  return ti == NULL ? -1 : dict_find(ti->dict, word);
+}
+
+
+/**************** termindex_prefix ****************/
+/* see termindex.h for description */
+
+int
+termindex_prefix(termindex_t* ti, const char* prefix, int* end){
+  if(ti == NULL){
+    *end = 0;
+    return 0;
+  }
+  return dict_range(ti->dict, prefix, end);
+}
+
+
+/**************** termindex_fuzzy ****************/
+/* see termindex.h for description */
+
+void
+termindex_fuzzy(termindex_t* ti, const char* word, const int maxEdits, void* arg,
+                void (*itemfunc)(void* arg, const int ordinal, const char* word, const int edits)){
+  if(ti != NULL){
+    dict_fuzzy(ti->dict, word, maxEdits, arg, itemfunc);
+  }
+}
+
+
+/**************** termindex_postings ****************/
+/* see termindex.h for description */
+
+postings_t*
+termindex_postings(termindex_t* ti, const int ordinal){
+  if(ti == NULL || ordinal < 0 || ordinal >= ti->numTerms){
+    return NULL;
+  }
+  return ti->postings[ordinal];
+}
+
+
+/**************** termindex_find ****************/
+/* see termindex.h for description */
+
+postings_t*
+termindex_find(termindex_t* ti, const char* word){
+  return termindex_postings(ti, termindex_ordinal(ti, word));
+}
+
+
+/**************** termindex_iterate ****************/
+/* see termindex.h for description */
+
+void
+termindex_iterate(termindex_t* ti, void* arg,
+                  void (*itemfunc)(void* arg, const int ordinal,
+                                   const char* word, postings_t* postings)){
+  if(ti == NULL || itemfunc == NULL){
+    return;
+  }
+  termiter_t iter = { ti, arg, itemfunc };
+  dict_iterate(ti->dict, &iter, termindex_iterate_helper);
+}
+
+
+/**************** termindex_delete ****************/
+/* see termindex.h for description */
+
+void
+termindex_delete(termindex_t* ti){
+  if(ti != NULL){
+    for(int i = 0; i < ti->numTerms; i++){
+      postings_delete(ti->postings[i]);
+    }
+    mem_free(ti->postings);
+    dict_delete(ti->dict);
+    mem_free(ti);
+  }
+}
+
+
+/**************** termlist_helper ****************/
+/* Helper function for index_scan to gather each word and its postings, made from the
+ * arrays of its line with the block metadata of that line (lines are handed over in order)
+ */
+
+static void
+termlist_helper(void* arg, const char* word, const int* docIDs, const int* counts, const int n){
+  termlist_t* list = arg;
+  postings_t* postings = postings_fromArrays(docIDs, counts, n, list->meta, list->n);
+  if(list->n == list->cap){
+    list->cap = list->cap == 0 ? 1024 : list->cap * 2;
+    list->terms = mem_assert(realloc(list->terms, list->cap * sizeof(loadterm_t)), "Error allocating memory");
+  }
+  if(list->n > 0 && strcmp(list->terms[list->n - 1].word, word) >= 0){
+    list->sorted = false;
+  }
+  loadterm_t* term = &list->terms[list->n];
+  term->word = mem_malloc_assert(strlen(word) + 1, "Error allocating memory");
+  strcpy(term->word, word);
+  term->postings = postings;
+  term->order = list->n;
+  list->n++;
+}
+
+
+/**************** segment_scan_helper ****************/
+/* Helper function for segment_iterate to gather the words of each segment */
+
+static void
+segment_scan_helper(void* arg, const char* segmentPath){
+  termlist_t* list = arg;
+  if(!index_scan(segmentPath, list, termlist_helper)){
+    fprintf(stderr, "*** could not read segment %s\n", segmentPath);
+    list->ok = false;
+  }
+}
+
+
+/**************** dictcheck_helper ****************/
+/* Helper function for dict_iterate to compare each word of a dictionary with the loaded word */
+
+static void
+dictcheck_helper(void* arg, const int ordinal, const char* word){
+  dictcheck_t* check = arg;
+  if(check->same && strcmp(check->list->terms[ordinal].word, word) != 0){
+    check->same = false;
+  }
+}
+
+
+/**************** loadterm_cmp ****************/
+/* qsort comparison of loadterms by word, then by order in the files */
+
+static int
+loadterm_cmp(const void* a, const void* b){
+  const loadterm_t* termA = a;
+  const loadterm_t* termB = b;
+  int cmp = strcmp(termA->word, termB->word);
+  return cmp != 0 ? cmp : termA->order - termB->order;
+}
+
+
+/**************** termindex_iterate_helper ****************/
+/* Helper function for dict_iterate to call the itemfunc of termindex_iterate */
+
+static void
+termindex_iterate_helper(void* arg, const int ordinal, const char* word){
+  termiter_t* iter = arg;
+  (*iter->itemfunc)(iter->arg, ordinal, word, iter->ti->postings[ordinal]);
+}
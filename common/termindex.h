@@ -0,0 +1,85 @@
+/*
+ * termindex.h - header file for the termindex (query-time index) module
+ *
+ * the read-only index the querier answers queries from: a front-coded
+ * dictionary of the words (see dict.h) and, for each word, its block postings
+ * (sorted arrays of docIDs and counts, see postings.h), found by the ordinal
+ * of the word.
+ *
+ * The dictionary comes from indexFilename.dict when the indexer wrote one
+ * (and it matches the index); otherwise, e.g. for an index written by an
+ * older indexer or an index directory of segments, the words are sorted
+ * and the dictionary built while loading.
+ *
+ * The postings of each word are made while the index is loaded, straight from
+ * the arrays index_scan parses each line into, with the block metadata of
+ * indexFilename.blocks when the indexer wrote it.  Nothing changes after that,
+ * so any number of threads can look up postings at once without a lock.
+ *
+ * Cooper LaPorte March 2023
+ */
+
+#ifndef __TERMINDEX_H
+#define __TERMINDEX_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "postings.h"
+
+/**************** global types ****************/
+typedef struct termindex termindex_t;  // opaque to users of the module
+
+/**************** termindex_load ****************/
+/* Load an index file, or every live segment of an index directory.
+ *
+ * We return:
+ *   pointer to the new termindex, or NULL if the index cannot be read or is
+ *   malformed; caller must later call termindex_delete
+ */
+termindex_t* termindex_load(const char* indexFilename);
+
+/**************** termindex_numTerms ****************/
+/* Return the number of words in the index */
+int termindex_numTerms(termindex_t* ti);
+
+/**************** termindex_ordinal ****************/
+/* Return the ordinal of word (its place in sorted order), or -1 if it is not in the index */
+int termindex_ordinal(termindex_t* ti, const char* word);
+
+/**************** termindex_prefix ****************/
+/* Return the ordinal of the first word of the index that starts with prefix, and set
+ * *end to one past the ordinal of the last (see dict_range); none if the two are the same
+ */
+int termindex_prefix(termindex_t* ti, const char* prefix, int* end);
+
+/**************** termindex_fuzzy ****************/
+/* Call itemfunc on each word of the index within maxEdits edits of word, with its ordinal
+ * and its edits, in sorted order (see dict_fuzzy)
+ */
+void termindex_fuzzy(termindex_t* ti, const char* word, const int maxEdits, void* arg,
+                     void (*itemfunc)(void* arg, const int ordinal, const char* word, const int edits));
+
+/**************** termindex_postings ****************/
+/* Return the postings of the word with the given ordinal, or NULL if there is none;
+ * the postings belong to the termindex.
+ */
+postings_t* termindex_postings(termindex_t* ti, const int ordinal);
+
+/**************** termindex_find ****************/
+/* Return the postings of word, or NULL if it is not in the index;
+ * the postings belong to the termindex.
+ */
+postings_t* termindex_find(termindex_t* ti, const char* word);
+
+/**************** termindex_iterate ****************/
+/* Call itemfunc on each word of the index, in sorted order, with its ordinal and postings */
+void termindex_iterate(termindex_t* ti, void* arg,
+                       void (*itemfunc)(void* arg, const int ordinal,
+                                        const char* word, postings_t* postings));
+
+/**************** termindex_delete ****************/
+/* Delete the termindex and all its postings */
+void termindex_delete(termindex_t* ti);
+
+#endif // __TERMINDEX_H
@@ -0,0 +1,457 @@
+/*
+ * urls.c - CS50 'urls' module
+ *
+ * see urls.h for more information.
+ *
+ * Cooper LaPorte, March 2023
+ */
+
+#define _POSIX_C_SOURCE 200809L   // mmap
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mem.h"
+#include "segment.h"
+#include "urls.h"
+
+
+/**************** file-local constants ****************/
+static const char MAGIC[8] = "TSEURLS1";   // header of a URL table file
+static const int URLS_BLOCK = 16;          // docIDs per front-coded block
+
+
+/**************** local types ****************/
+struct urls {
+  char** urls;       // urls[docID], NULL if docID has no page
+  int* depths;
+  int* lengths;
+  int cap;           // size of the arrays
+  int maxDoc;        // largest docID in the table
+};
+
+struct urlmap {
+  unsigned char* map;      // the whole file
+  size_t size;
+  const uint64_t* blocks;  // offset in data of each block
+  const unsigned char* data;
+  int maxDoc;
+  int maxLen;              // length of the longest URL
+};
+
+/* URL table file header, after MAGIC */
+typedef struct urlshead {
+  uint32_t maxDoc;
+  uint32_t numBlocks;
+  uint32_t maxLen;
+  uint32_t pad;
+  uint64_t len;
+} urlshead_t;
+
+/* a growing buffer of encoded blocks */
+typedef struct urlsbuf {
+  unsigned char* data;
+  size_t len;
+  size_t cap;
+} urlsbuf_t;
+
+
+static void urls_grow(urls_t* urls, const int docID);
+static void urlsbuf_put(urlsbuf_t* buf, unsigned int value);
+static void urlsbuf_putBytes(urlsbuf_t* buf, const char* bytes, const int n);
+static bool urls_getChecked(const unsigned char** pp, const unsigned char* end, unsigned int* value);
+static inline unsigned int urls_getVarint(const unsigned char** pp);
+
+
+/**************** urls_filename ****************/
+/* see urls.h for description */
+
+char*
+urls_filename(const char* indexFilename){
+  if(indexFilename == NULL){
+    return NULL;
+  }
+  char* file = mem_malloc_assert(strlen(indexFilename) + 6, "Error allocating memory");
+  if(segment_isIndexDir(indexFilename)){
+    sprintf(file, "%s/urls", indexFilename);
+  } else{
+    sprintf(file, "%s.urls", indexFilename);
+  }
+  return file;
+}
+
+
+/**************** urls_new ****************/
+/* see urls.h for description */
+
+urls_t*
+urls_new(void){
+  urls_t* urls = mem_malloc_assert(sizeof(urls_t), "Error allocating memory");
+  urls->urls = NULL;
+  urls->depths = NULL;
+  urls->lengths = NULL;
+  urls->cap = 0;
+  urls->maxDoc = 0;
+  return urls;
+}
+
+
+/**************** urls_add ****************/
+/* see urls.h for description */
+
+void
+urls_add(urls_t* urls, const int docID, const char* url, const int depth, const int length){
+  if(urls == NULL || docID <= 0 || url == NULL || depth < 0 || length < 0){
+    return;
+  }
+  urls_grow(urls, docID);
+  if(urls->urls[docID] != NULL){
+    mem_free(urls->urls[docID]);
+  }
+  urls->urls[docID] = mem_malloc_assert(strlen(url) + 1, "Error allocating memory");
+  strcpy(urls->urls[docID], url);
+  urls->depths[docID] = depth;
+  urls->lengths[docID] = length;
+  if(docID > urls->maxDoc){
+    urls->maxDoc = docID;
+  }
+}
+
+
+/**************** urls_read ****************/
+/* see urls.h for description */
+
+urls_t*
+urls_read(const char* file){
+  urlmap_t* map = urls_load(file);
+  if(map == NULL){
+    return NULL;
+  }
+  urls_t* urls = urls_new();
+  for(int docID = 1; docID <= map->maxDoc; docID++){
+    int depth;
+    int length;
+    char* url = urls_get(map, docID, &depth, &length);
+    if(url != NULL){
+      urls_add(urls, docID, url, depth, length);
+      mem_free(url);
+    }
+  }
+  urls_unload(map);
+  return urls;
+}
+
+
+/**************** urls_save ****************/
+/* see urls.h for description */
+
+bool
+urls_save(urls_t* urls, const char* file){
+  if(urls == NULL || file == NULL){
+    return false;
+  }
+  // encode the blocks
+  int numBlocks = (urls->maxDoc + URLS_BLOCK - 1) / URLS_BLOCK;
+  uint64_t* blocks = mem_malloc_assert((numBlocks + 1) * sizeof(uint64_t), "Error allocating memory");
+  urlsbuf_t buf = { mem_malloc_assert(1024, "Error allocating memory"), 0, 1024 };
+  int maxLen = 0;
+  const char* last = NULL;   // the URL before, in the same block
+  for(int docID = 1; docID <= urls->maxDoc; docID++){
+    if((docID - 1) % URLS_BLOCK == 0){
+      blocks[(docID - 1) / URLS_BLOCK] = buf.len;
+      last = NULL;
+    }
+    const char* url = urls->urls[docID];
+    if(url == NULL){
+      urlsbuf_put(&buf, 0);
+      continue;
+    }
+    int len = strlen(url);
+    int prefix = 0;
+    while(last != NULL && last[prefix] != '\0' && last[prefix] == url[prefix]){
+      prefix++;
+    }
+    urlsbuf_put(&buf, urls->depths[docID] + 1);
+    urlsbuf_put(&buf, prefix);
+    urlsbuf_put(&buf, len - prefix);
+    urlsbuf_putBytes(&buf, url + prefix, len - prefix);
+    urlsbuf_put(&buf, urls->lengths[docID]);
+    if(len > maxLen){
+      maxLen = len;
+    }
+    last = url;
+  }
+
+  char* tmp = mem_malloc_assert(strlen(file) + 5, "Error allocating memory");
+  sprintf(tmp, "%s.tmp", file);
+  FILE* fp = fopen(tmp, "w");
+  bool ok = fp != NULL;
+  if(ok){
+    urlshead_t head = { urls->maxDoc, numBlocks, maxLen, 0, buf.len };
+    fwrite(MAGIC, 1, sizeof(MAGIC), fp);
+    fwrite(&head, sizeof(head), 1, fp);
+    fwrite(blocks, sizeof(uint64_t), numBlocks, fp);
+    fwrite(buf.data, 1, buf.len, fp);
+    ok = !ferror(fp);
+    ok = (fclose(fp) == 0) && ok;
+    ok = ok && rename(tmp, file) == 0;
+  }
+  mem_free(tmp);
+  mem_free(blocks);
+  mem_free(buf.data);
+  return ok;
+}
+
+
+/**************** urls_delete ****************/
+/* see urls.h for description */
+
+void
+urls_delete(urls_t* urls){
+  if(urls != NULL){
+    for(int docID = 0; docID < urls->cap; docID++){
+      if(urls->urls[docID] != NULL){
+        mem_free(urls->urls[docID]);
+      }
+    }
+    if(urls->urls != NULL){
+      mem_free(urls->urls);
+      mem_free(urls->depths);
+      mem_free(urls->lengths);
+    }
+    mem_free(urls);
+  }
+}
+
+
+/**************** urls_load ****************/
+/* see urls.h for description */
+
+urlmap_t*
+urls_load(const char* file){
+  int fd = file == NULL ? -1 : open(file, O_RDONLY);
+  if(fd < 0){
+    return NULL;
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0 || st.st_size < (off_t)(sizeof(MAGIC) + sizeof(urlshead_t))){
+    close(fd);
+    return NULL;
+  }
+  size_t size = st.st_size;
+  unsigned char* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED){
+    return NULL;
+  }
+  urlshead_t head;
+  memcpy(&head, map + sizeof(MAGIC), sizeof(head));
+  size_t offsets = sizeof(MAGIC) + sizeof(head);
+  bool ok = memcmp(map, MAGIC, sizeof(MAGIC)) == 0
+            && head.numBlocks == (head.maxDoc + URLS_BLOCK - 1) / URLS_BLOCK
+            && offsets + head.numBlocks * sizeof(uint64_t) + head.len == size;
+  urlmap_t* um = NULL;
+  if(ok){
+    um = mem_malloc_assert(sizeof(urlmap_t), "Error allocating memory");
+    um->map = map;
+    um->size = size;
+    um->blocks = (const uint64_t*)(map + offsets);
+    um->data = map + offsets + head.numBlocks * sizeof(uint64_t);
+    um->maxDoc = head.maxDoc;
+    um->maxLen = head.maxLen;
+  }
+  // check every block, so urls_get can decode without checking
+  const unsigned char* p = ok ? um->data : NULL;
+  const unsigned char* end = ok ? um->data + head.len : NULL;
+  unsigned int lastLen = 0;
+  for(int docID = 1; ok && docID <= head.maxDoc; docID++){
+    if((docID - 1) % URLS_BLOCK == 0){
+      ok = um->blocks[(docID - 1) / URLS_BLOCK] == p - um->data;
+      lastLen = 0;
+    }
+    unsigned int depth = 0;
+    unsigned int prefix;
+    unsigned int suffix;
+    unsigned int length;
+    ok = ok && urls_getChecked(&p, end, &depth);
+    if(ok && depth > 0){
+      ok = urls_getChecked(&p, end, &prefix) && prefix <= lastLen
+           && urls_getChecked(&p, end, &suffix) && suffix <= end - p
+           && prefix + suffix <= head.maxLen;
+      if(ok){
+        p += suffix;
+        lastLen = prefix + suffix;
+        ok = urls_getChecked(&p, end, &length);
+      }
+    }
+  }
+  if(!ok || p != end){
+    if(um != NULL){
+      mem_free(um);
+    }
+    munmap(map, size);
+    return NULL;
+  }
+  return um;
+}
+
+
+/**************** urls_maxDoc ****************/
+/* see urls.h for description */
+
+int
+urls_maxDoc(urlmap_t* map){
+  return map == NULL ? 0 : map->maxDoc;
+}
+
+
+/**************** urls_get ****************/
+/* see urls.h for description */
+
+char*
+urls_get(urlmap_t* map, const int docID, int* depth, int* length){
+  if(map == NULL || docID <= 0 || docID > map->maxDoc){
+    return NULL;
+  }
+  // decode the block up to docID, rebuilding each URL over the one before it
+  const unsigned char* p = map->data + map->blocks[(docID - 1) / URLS_BLOCK];
+  char* url = mem_malloc_assert(map->maxLen + 1, "Error allocating memory");
+  int len = 0;
+  for(int d = (docID - 1) / URLS_BLOCK * URLS_BLOCK + 1; ; d++){
+    unsigned int pageDepth = urls_getVarint(&p);
+    if(pageDepth == 0){
+      if(d == docID){
+        mem_free(url);
+        return NULL;
+      }
+      continue;
+    }
+    int prefix = urls_getVarint(&p);
+    int suffix = urls_getVarint(&p);
+    memcpy(url + prefix, p, suffix);
+    p += suffix;
+    len = prefix + suffix;
+    int pageLength = urls_getVarint(&p);
+    if(d == docID){
+      url[len] = '\0';
+      if(depth != NULL){
+        *depth = pageDepth - 1;
+      }
+      if(length != NULL){
+        *length = pageLength;
+      }
+      return url;
+    }
+  }
+}
+
+
+/**************** urls_unload ****************/
+/* see urls.h for description */
+
+void
+urls_unload(urlmap_t* map){
+  if(map != NULL){
+    munmap(map->map, map->size);
+    mem_free(map);
+  }
+}
+
+
+/**************** urls_grow ****************/
+/* make room in the table for docID */
+
+static void
+urls_grow(urls_t* urls, const int docID){
+  if(docID < urls->cap){
+    return;
+  }
+  int cap = urls->cap == 0 ? 1024 : urls->cap;
+  while(cap <= docID){
+    cap *= 2;
+  }
+  urls->urls = mem_assert(realloc(urls->urls, cap * sizeof(char*)), "Error allocating memory");
+  urls->depths = mem_assert(realloc(urls->depths, cap * sizeof(int)), "Error allocating memory");
+  urls->lengths = mem_assert(realloc(urls->lengths, cap * sizeof(int)), "Error allocating memory");
+  for(int d = urls->cap; d < cap; d++){
+    urls->urls[d] = NULL;
+  }
+  urls->cap = cap;
+}
+
+
+/**************** urlsbuf_put ****************/
+/* Append value to the buffer as a varint */
+
+static void
+urlsbuf_put(urlsbuf_t* buf, unsigned int value){
+  if(buf->len + 5 > buf->cap){
+    buf->cap *= 2;
+    buf->data = mem_assert(realloc(buf->data, buf->cap), "Error allocating memory");
+  }
+  while(value >= 0x80){
+    buf->data[buf->len++] = (value & 0x7f) | 0x80;
+    value >>= 7;
+  }
+  buf->data[buf->len++] = value;
+}
+
+
+/**************** urlsbuf_putBytes ****************/
+/* Append n bytes to the buffer */
+
+static void
+urlsbuf_putBytes(urlsbuf_t* buf, const char* bytes, const int n){
+  while(buf->len + n > buf->cap){
+    buf->cap *= 2;
+    buf->data = mem_assert(realloc(buf->data, buf->cap), "Error allocating memory");
+  }
+  memcpy(buf->data + buf->len, bytes, n);
+  buf->len += n;
+}
+
+
+/**************** urls_getChecked ****************/
+/* Read a varint at *pp, not reading at or past end, and step over it */
+
+static bool
+urls_getChecked(const unsigned char** pp, const unsigned char* end, unsigned int* value){
+  const unsigned char* p = *pp;
+  unsigned int v = 0;
+  int shift = 0;
+  while(p < end && (*p & 0x80) && shift < 28){
+    v |= (unsigned int)(*p++ & 0x7f) << shift;
+    shift += 7;
+  }
+  if(p == end || (*p & 0x80)){
+    return false;
+  }
+  v |= (unsigned int)(*p++) << shift;
+  *pp = p;
+  *value = v;
+  return true;
+}
+
+
+/**************** urls_getVarint ****************/
+/* Read a varint at *pp (already checked by urls_load) and step over it */
+
+static inline unsigned int
+urls_getVarint(const unsigned char** pp){
+  const unsigned char* p = *pp;
+  unsigned int value = 0;
+  int shift = 0;
+  while(*p & 0x80){
+    value |= (unsigned int)(*p++ & 0x7f) << shift;
+    shift += 7;
+  }
+  value |= (unsigned int)(*p++) << shift;
+  *pp = p;
+  return value;
+}
@@ -0,0 +1,105 @@
+/*
+ * urls.h - header file for the urls (URL table) module
+ *
+ * the URL, depth and length (number of words indexed) of every page of an
+ * index, by docID, so the querier can print its results without reading the
+ * page files.  The indexer builds the table with urls_new/urls_add and
+ * writes it beside the index (indexFilename.urls, or urls inside an index
+ * directory) with urls_save; the querier maps the file with urls_load.
+ *
+ * The file is binary: after an 8-byte header, the largest docID, the number
+ * of blocks, the length of the longest URL and the length of the data, then
+ * the offset of each block in the data, then the data.  The pages are kept in
+ * blocks of URLS_BLOCK docIDs, and each docID as
+ *
+ *   depth+1 (0 for a docID with no page), then, for a page:
+ *   prefixLength suffixLength suffix length
+ *
+ * where the numbers are varints and the URL is front coded: the length of the
+ * prefix it shares with the URL of the page before it in the block, and the
+ * rest of it.  URLs of neighbouring docIDs mostly share their site and path,
+ * so the table is a fraction of the size of the URLs, and finding one decodes
+ * at most one block.
+ *
+ * Cooper LaPorte March 2023
+ */
+
+#ifndef __URLS_H
+#define __URLS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/**************** global types ****************/
+typedef struct urls urls_t;        // a URL table being built, opaque
+typedef struct urlmap urlmap_t;    // a URL table loaded from a file, opaque
+
+/**************** urls_filename ****************/
+/* Return the pathname of the URL table that goes with an index: indexFilename.urls,
+ * or indexFilename/urls for an index directory; caller must free the pathname.
+ */
+char* urls_filename(const char* indexFilename);
+
+/**************** urls_new ****************/
+/* Create a new (empty) URL table; caller must later call urls_delete */
+urls_t* urls_new(void);
+
+/**************** urls_add ****************/
+/* Record the URL, depth and length of the page docID (replacing any page already recorded for it).
+ *
+ * Caller provides:
+ *   docID > 0, a URL (which we copy), depth >= 0 and length >= 0
+ */
+void urls_add(urls_t* urls, const int docID, const char* url, const int depth, const int length);
+
+/**************** urls_read ****************/
+/* Read a URL table written by urls_save back into a table that can be added to.
+ *
+ * We return:
+ *   the table, or NULL if the file cannot be read or is not a URL table;
+ *   caller must later call urls_delete
+ */
+urls_t* urls_read(const char* file);
+
+/**************** urls_save ****************/
+/* Write the table to file, under a temporary name that is then renamed into place.
+ *
+ * We return:
+ *   true if the file was written, false otherwise
+ */
+bool urls_save(urls_t* urls, const char* file);
+
+/**************** urls_delete ****************/
+/* Delete the table */
+void urls_delete(urls_t* urls);
+
+/**************** urls_load ****************/
+/* Map a URL table written by urls_save.
+ *
+ * We return:
+ *   the loaded table, or NULL if the file cannot be read or is malformed;
+ *   caller must later call urls_unload
+ * Notes:
+ *   the whole file is checked here, so looking up a page afterwards cannot fail
+ */
+urlmap_t* urls_load(const char* file);
+
+/**************** urls_maxDoc ****************/
+/* Return the largest docID in the table */
+int urls_maxDoc(urlmap_t* map);
+
+/**************** urls_get ****************/
+/* Find the page docID in the table.
+ *
+ * We return:
+ *   the URL of the page, which the caller must free, setting *depth and *length
+ *   (when they are not NULL); or NULL if the table has no page docID
+ */
+char* urls_get(urlmap_t* map, const int docID, int* depth, int* length);
+
+/**************** urls_unload ****************/
+/* Unmap the table */
+void urls_unload(urlmap_t* map);
+
+#endif // __URLS_H
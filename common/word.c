@@ -10,8 +10,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
-#include "mem.h"
+#include "memtag.h"
 
 
 
@@ -20,9 +19,10 @@
 
 char*
 word_normalize(char* word){
-   char* norm = mem_malloc((strlen(word)+1)*sizeof(char));
+   char* norm = memtag_malloc(MEMTAG_TOKENIZER, (strlen(word)+1)*sizeof(char), "Error allocating memory");
    for(int i = 0; word[i]; i++){
-    norm[i] = tolower(word[i]);
+    // only ASCII letters are folded: the bytes of a UTF-8 letter are kept as they are
+    norm[i] = (word[i] >= 'A' && word[i] <= 'Z') ? word[i] - 'A' + 'a' : word[i];
    }
    norm[strlen(word)]='\0';
    return norm;
@@ -1,7 +1,8 @@
 /* 
  * word.h - header file for word module
  *
- * takes a word and normalizes it by converting it to all lowercase 
+ * takes a word and normalizes it by converting it to all lowercase (ASCII letters only;
+ * the bytes of UTF-8 letters are kept as they are)
  *
  * Cooper LaPorte Febuary 2023
  */
@@ -21,6 +22,6 @@
  * Returns:
  *   lowercase version of the word
  * Note:
- *   caller is responsible for freeing the word
+ *   caller is responsible for freeing the word, with memtag_free (it is counted as tokenizer memory)
  */
 char* word_normalize(char* word);
\ No newline at end of file
@@ -21,6 +21,7 @@
 #include "set.h"
 #include "bag.h"
 #include "mem.h"
+#include "memtag.h"
 #include "file.h"
 #include "hash.h"
 #include "hashtable.h"
@@ -32,13 +33,14 @@
 static void parseArgs(const int argc, char* argv[],
                       char** seedURL, char** pageDirectory, int* maxDepth);
 static void crawl(char* seedURL, char* pageDirectory, const int maxDepth);
-static void pageScan(webpage_t* page, bag_t* pagesToCrawl, hashtable_t* pagesSeen);
+static void pageScan(webpage_t* page, bag_t* pagesToCrawl, hashtable_t* pagesSeen, size_t* seenBytes);
 
 /* ***************** main ********************** */
 
 int
 main(const int argc, char* argv[])
 {
+memtag_atexit(); // report memory by subsystem at exit when TSE_MEMSTATS is set
 if (argc == 4){
     // three arguments
     char* seedURL = NULL;
@@ -96,6 +98,8 @@ parseArgs(const int argc, char* argv[],
  * Scan a webpage at the given the url (assuming it is internal)
  * scan the pages and pages gotten from urls on that page until the given maxdepth
  * put each page in its own file in the pageDirectory given with the url, depth, and content
+ * the HTML of the page being scanned is counted as fetch memory, and the URLs in the bag
+ * and the hashtable as frontier memory
  * assumes inputs are valid since they had to get through parseArgs
  */
 
@@ -103,21 +107,29 @@ static void
 crawl(char* seedURL, char* pageDirectory, const int maxDepth){
   hashtable_t* ht = hashtable_new(200);
   hashtable_insert(ht, seedURL, "");
+  size_t seenBytes = strlen(seedURL) + 1;               // the URLs copied into the hashtable
+  memtag_charge(MEMTAG_FRONTIER, seenBytes);
   bag_t* pages = bag_new();
   webpage_t* toScan = webpage_new(seedURL, 0, NULL);
   bag_insert(pages, toScan);
+  memtag_charge(MEMTAG_FRONTIER, strlen(seedURL) + 1);
   int count = 1;
   while((toScan = bag_extract(pages)) != NULL){
+    memtag_release(MEMTAG_FRONTIER, strlen(webpage_getURL(toScan)) + 1);
     if(webpage_fetch(toScan)){                          // checks if the data/HTML can be found and finds it
+      size_t fetched = strlen(webpage_getHTML(toScan)) + 1;
+      memtag_charge(MEMTAG_FETCH, fetched);
       pagedir_save(toScan, pageDirectory, count);       // creates the page with its contents
       count++;                                          // increments count for the IDs
       if(webpage_getDepth(toScan) < maxDepth){
-        pageScan(toScan, pages, ht);                    // checks for more URLs if not already max depth
+        pageScan(toScan, pages, ht, &seenBytes);        // checks for more URLs if not already max depth
       }
+      memtag_release(MEMTAG_FETCH, fetched);
     }
     webpage_delete(toScan);
   }
 hashtable_delete(ht, NULL);                             // clean up since done with these
+memtag_release(MEMTAG_FRONTIER, seenBytes);
 bag_delete(pages, webpage_delete);
 }
 
@@ -126,10 +138,11 @@ bag_delete(pages, webpage_delete);
 /*
  * Scan all of the URLs on the page and add the internal ones to the hashtable of pagesSeen
  * if that URL/webpage was not in pagesSeen, adds it to the bag of pagesToCrawl
+ * and adds the bytes of the URLs put in pagesSeen to *seenBytes
  */
 
 static void
-pageScan(webpage_t* page, bag_t* pagesToCrawl, hashtable_t* pagesSeen){
+pageScan(webpage_t* page, bag_t* pagesToCrawl, hashtable_t* pagesSeen, size_t* seenBytes){
   int pos = 0;
   char* url;
   while ((url = webpage_getNextURL(page, &pos)) != NULL) {
@@ -137,6 +150,8 @@ pageScan(webpage_t* page, bag_t* pagesToCrawl, hashtable_t* pagesSeen){
     if(isInternalURL(url)){
       // make sure url is internal
       if(hashtable_insert(pagesSeen, url, "")){
+        *seenBytes += strlen(url) + 1;
+        memtag_charge(MEMTAG_FRONTIER, 2 * (strlen(url) + 1)); // the copy in pagesSeen, and the one in the bag
         bag_insert(pagesToCrawl, webpage_new(url, (webpage_getDepth(page)+1), NULL));
         // only free url if not inserted into hashtable, otherwise hashtable will free it
       } else{
@@ -3,48 +3,148 @@
  * it writes the found words to the given file with each file the word occured in and the amount of times it occured
  *
  *
- * Usage: ./indexer pageDirectory indexFilename
+ * Usage: ./indexer [-m megabytes] [-a | -p] [-r] pageDirectory indexFilename
  * where pageDirectory is the (existing) directory with a .crawler file in it which to read files/webpages
  * indexFilename is a file that can be existing or not to write the data about the words and files
+ * -m gives a memory budget for the in-memory index; when it is reached the words seen so far
+ * are flushed to a sorted partial index (run) beside indexFilename, and the runs are merged at the end
+ * -a appends instead: indexFilename is an (existing) index directory, and only the pages after
+ * the last docID already indexed there are indexed, into a new segment; afterwards the segments
+ * are compacted by a background process
+ * -p also writes a positional index (indexFilename.pos) with where each word occurs in each page,
+ * so the querier can answer phrase queries; with -m, the positions are written in runs
+ * (indexFilename.pos.run0, ...) as the postings are, and the two share the budget
+ * -r numbers the pages in the order of their URLs instead of the order they were crawled in
+ * (docID 1 is the page with the first URL), so similar pages get nearby docIDs; it cannot be
+ * combined with -a (an index directory numbers new pages after the ones it has)
+ * the sorted words of the index are also written front coded, as the dictionary indexFilename.dict,
+ * and the postings of each word are cut into blocks whose last docID and largest count are
+ * written to indexFilename.blocks, so the querier can skip and prune whole blocks
+ * the length of every page indexed is kept in a document table beside the index
+ * (indexFilename.docs, or docs inside an index directory) for the querier's BM25 ranking,
+ * and the URL and depth of every page in a URL table (indexFilename.urls, or urls inside an
+ * index directory), so the querier can print its results without reading the pages
+ * last, the CRC32C checksums of the index file and of each of these tables are written to
+ * indexFilename.crc, so the querier can refuse an index that was cut short or corrupted
  * 
  * Exit with 0 means succesful
  * Exit with 1 means wrong number of inputs
  * Exit with 2 means wrong type of inputs or inputs out of range
+ * Exit with 3 means the index (or one of its runs) could not be written
  *
  * Cooper LaPorte, January 2023
  */
 
+#define _POSIX_C_SOURCE 200809L   // fork
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
 #include "mem.h"
+#include "memtag.h"
 #include "file.h"
 #include "counters.h"
 #include "hashtable.h"
 #include "pagedir.h"
 #include "webpage.h"
 #include "index.h"
-#include "word.h"
+#include "lexer.h"
+#include "spimi.h"
+#include "segment.h"
+#include "docs.h"
+#include "positions.h"
+#include "dict.h"
+#include "bm25.h"
+#include "postings.h"
+#include "urls.h"
+#include "crc.h"
+
+
+
+/**************** local types ****************/
+/* indexopts: the options given before the arguments */
+typedef struct indexopts {
+  size_t budget;     // memory budget in bytes for the in-memory index, 0 for none (-m)
+  bool append;       // index new pages into a new segment of an index directory (-a)
+  bool positions;    // also write the positions of the words (-p)
+  bool reorder;      // number the pages in the order of their URLs (-r)
+} indexopts_t;
 
+/* pageurl: the URL of a page file, to sort the pages by for -r */
+typedef struct pageurl {
+  char* url;
+  int file;          // the number of the page file (its docID in crawl order)
+} pageurl_t;
 
 
-static void parseArgs(const int argc, char* argv[],
+static int parseOpts(const int argc, char* argv[], indexopts_t* opts);
+static void parseArgs(char* argv[], indexopts_t* opts,
                       char** pageDirectory, char** indexFilename);
-static void indexBuild(char* pageDirectory, char* indexFilename);
-static void indexPage(hashtable_t* index, webpage_t* page, int docID);
-static void counters_delete_helper(void* item);
+static int* indexOrder(char* pageDirectory, int* numPages);
+static int pageurl_cmp(const void* a, const void* b);
+static int indexBuild(char* pageDirectory, char* indexFilename, docs_t* docs, urls_t* urls,
+                      positions_t* positions, const int* order, const int numPages,
+                      const int firstDoc, size_t budget);
+static void indexAppend(char* pageDirectory, char* indexDir, size_t budget);
+static void indexDocs(docs_t* docs, urls_t* urls, char* indexFilename);
+static void indexDict(char* indexFilename);
+static void indexBlocks(char* indexFilename);
+static void indexCrc(char* indexFilename);
+static int indexPage(spimi_t* index, positions_t* positions, lexer_t* lexer, webpage_t* page, int docID);
 
 /* ***************** main ********************** */
 
 int
 main(const int argc, char* argv[])
 {
-if (argc == 3){
+memtag_atexit(); // report memory by subsystem at exit when TSE_MEMSTATS is set
+indexopts_t opts = { 0, false, false, false };
+int arg = parseOpts(argc, argv, &opts); // index of the first argument after the options
+if (argc - arg == 2){
     // two arguments
     char* indexFilename = NULL;
     char* pageDirectory = NULL;
-    parseArgs(argc, argv, &pageDirectory, &indexFilename);
-    indexBuild(pageDirectory, indexFilename);
+    parseArgs(&argv[arg], &opts, &pageDirectory, &indexFilename);
+    if(opts.append){
+      indexAppend(pageDirectory, indexFilename, opts.budget);
+    } else{
+      docs_t* docs = docs_new();
+      urls_t* urls = urls_new();
+      size_t budget = opts.budget;
+      char* posFile = positions_filename(indexFilename);
+      positions_t* positions = NULL;
+      if(opts.positions){ // the postings and the positions share the budget
+        budget = opts.budget / 2;
+        positions = positions_new(posFile, budget);
+      } else{
+        remove(posFile); // no positions: drop any left from an index written there before
+      }
+      int numPages = 0;
+      int* order = opts.reorder ? indexOrder(pageDirectory, &numPages) : NULL;
+      indexBuild(pageDirectory, indexFilename, docs, urls, positions, order, numPages, 1, budget);
+      if(order != NULL){
+        mem_free(order);
+      }
+      indexDocs(docs, urls, indexFilename);
+      indexDict(indexFilename);
+      indexBlocks(indexFilename);
+      char* dfFile = bm25_dfFilename(indexFilename);
+      remove(dfFile); // not pruned: drop any table left from a pruned index written there before
+      mem_free(dfFile);
+      docs_delete(docs);
+      urls_delete(urls);
+      if(positions != NULL){
+        if(!positions_save(positions)){
+          fprintf(stderr,"*** could not write the positions to %s\n", posFile);
+          exit(3);
+        }
+        positions_delete(positions);
+      }
+      mem_free(posFile);
+      indexCrc(indexFilename);
+    }
   } else{
     // too few or many arguments
     fprintf(stderr,"*** need to pass exactly two arguments\n");
@@ -55,100 +155,363 @@ exit(0);
 
 
 
+/* ****************** parseOpts ********************** */
+/*
+ * Takes the options at the front of the arguments given to indexer.c and checks them
+ * -m must be followed by a positive number of megabytes for the memory budget
+ * -a asks to append to an index directory
+ * -p asks for a positional index; it cannot be combined with -a
+ * -r asks for the pages to be numbered in the order of their URLs; it cannot be combined with -a
+ * returns the index in argv of the first argument that is not an option
+ */
+
+static int
+parseOpts(const int argc, char* argv[], indexopts_t* opts){
+  int arg = 1;
+  while(arg < argc && argv[arg][0] == '-'){
+    if(strcmp(argv[arg], "-m") == 0 && arg + 1 < argc){
+      int megabytes = atoi(argv[arg + 1]);
+      if(megabytes <= 0){
+        fprintf(stderr,"*** need to pass a positive integer number of megabytes for -m\n");
+        exit(2);
+      }
+      opts->budget = (size_t)megabytes * 1024 * 1024;
+      arg += 2;
+    } else if(strcmp(argv[arg], "-a") == 0){
+      opts->append = true;
+      arg++;
+    } else if(strcmp(argv[arg], "-p") == 0){
+      opts->positions = true;
+      arg++;
+    } else if(strcmp(argv[arg], "-r") == 0){
+      opts->reorder = true;
+      arg++;
+    } else{
+      fprintf(stderr,"*** unknown option %s\n", argv[arg]);
+      exit(2);
+    }
+  }
+  if(opts->append && opts->positions){
+    fprintf(stderr,"*** -p cannot be used with -a\n");
+    exit(2);
+  }
+  if(opts->append && opts->reorder){
+    fprintf(stderr,"*** -r cannot be used with -a\n");
+    exit(2);
+  }
+  return arg;
+}
+
+
 /* ****************** parseArgs ********************** */
 /*
- * Takes the arguments given to indexer.c and checks them
+ * Takes the two arguments given to indexer.c (after any options) and checks them
  * checks the pagedirectory and makes sure it is valid (has a .crawler file)
- * checks indexFilename and creates or truncates a file for it
+ * checks indexFilename and creates or truncates a file for it,
+ * or when appending, makes sure it is an index directory (setting one up if it is an empty directory)
  */
 
 static void
-parseArgs(const int argc, char* argv[],
+parseArgs(char* argv[], indexopts_t* opts,
                       char** pageDirectory, char** indexFilename){
-    *pageDirectory = mem_assert(argv[1], "*** need to pass a proper directory");
+    *pageDirectory = mem_assert(argv[0], "*** need to pass a proper directory");
     if(!pagedir_hasCrawler(*pageDirectory)){                // Ensures pageDirectory exists with the .crawler file
       fprintf(stderr,"*** page directory failed to initialize, pass valid directory\n");
       exit(2);
     }
-    *indexFilename = mem_assert(argv[2], "*** need to pass a proper file pathname");
+    *indexFilename = mem_assert(argv[1], "*** need to pass a proper file pathname");
+    if(opts->append){
+      if(!segment_init(*indexFilename)){                  // Ensures indexFilename is a writable directory with a manifest
+        fprintf(stderr,"*** need to pass a writable directory to append to\n");
+        exit(2);
+      }
+      return;
+    }
     FILE* fp = mem_assert(fopen(*indexFilename, "w"), "*** need to pass a proper file pathname (path exists, directory and file are not read only)");
     fclose(fp);      // creates file for indexFilename after ensuring it is a path, closes it since no writing now
 }
 
 
+/* ****************** indexOrder ********************** */
+/*
+ * Read the URL (the first line) of each file in the directory given from 1 until we run out,
+ * and return the numbers of the files sorted by URL, setting *numPages to how many there are;
+ * numbering the pages in this order puts pages of the same site and directory, which share
+ * many words, at nearby docIDs, so the gaps between the docIDs of a word are smaller
+ * (the block metadata and positions, stored as gaps, take less room) and postings that are
+ * intersected are closer together; caller must free the array
+ */
+
+static int*
+indexOrder(char* pageDirectory, int* numPages){
+  int cap = 1024;
+  int n = 0;
+  pageurl_t* pages = mem_malloc_assert(cap * sizeof(pageurl_t), "Error allocating memory");
+  char* path = mem_malloc_assert(strlen(pageDirectory) + 12, "Error allocating memory"); // room for '/', the digits, and '\0'
+  FILE* read;
+  sprintf(path, "%s/%d", pageDirectory, n + 1);
+  while((read = fopen(path, "r")) != NULL){
+    if(n == cap){
+      cap *= 2;
+      pages = mem_assert(realloc(pages, cap * sizeof(pageurl_t)), "Error allocating memory");
+    }
+    char* url = file_readLine(read);
+    fclose(read);
+    pages[n].url = url;
+    pages[n].file = n + 1;
+    n++;
+    sprintf(path, "%s/%d", pageDirectory, n + 1);
+  }
+  mem_free(path);
+  qsort(pages, n, sizeof(pageurl_t), pageurl_cmp);
+  int* order = mem_malloc_assert((n + 1) * sizeof(int), "Error allocating memory");
+  for(int i = 0; i < n; i++){
+    order[i] = pages[i].file;
+    if(pages[i].url != NULL){
+      mem_free(pages[i].url);
+    }
+  }
+  mem_free(pages);
+  *numPages = n;
+  return order;
+}
+
+
+/* ****************** pageurl_cmp ********************** */
+/*
+ * qsort order for indexOrder: by URL (a file without one first), then by file number
+ */
+
+static int
+pageurl_cmp(const void* a, const void* b){
+  const pageurl_t* x = a;
+  const pageurl_t* y = b;
+  if(x->url == NULL || y->url == NULL){
+    if(x->url != y->url){
+      return x->url == NULL ? -1 : 1;
+    }
+  } else{
+    int cmp = strcmp(x->url, y->url);
+    if(cmp != 0){
+      return cmp;
+    }
+  }
+  return x->file - y->file;
+}
+
+
 /* ****************** indexBuild ********************** */
 /*
- * Scan each file in the directory given from 1 incrementing by 1 until we run out
+ * Scan each file in the directory given from firstDoc incrementing by 1 until we run out
+ * (or, given an order, the numPages files it lists, as docIDs firstDoc, firstDoc + 1, ...)
  * scan the files/pages and create a webpage_t for each, sending it to indexPage
+ * the spimi index keeps at most budget bytes of postings in memory (0 for no limit), and the
+ * positions keep to the budget they were made with
+ * and the number of words indexed from each page is recorded in docs,
+ * and its URL, depth and number of words in urls
+ * and, unless positions is NULL, where each word occurs in the page in positions
+ * returns the last docID indexed (firstDoc - 1 if there were none)
  * assumes inputs are valid since they had to get through parseArgs
  */
 
-static void
-indexBuild(char* pageDirectory, char* indexFilename){
+static int
+indexBuild(char* pageDirectory, char* indexFilename, docs_t* docs, urls_t* urls,
+                      positions_t* positions, const int* order, const int numPages,
+                      const int firstDoc, size_t budget){
 
-  hashtable_t* index = hashtable_new(200); // 200 is arbitrary, hopefully large enough, but no specific reason
-  int docID = 1;
+  spimi_t* index = mem_assert(spimi_new(indexFilename, budget), "Error allocating memory");
+  lexer_t* lexer = lexer_new();
+  int docID = firstDoc;
   FILE* read = NULL;
-  char* path = mem_malloc(strlen(pageDirectory) + sizeof(docID) + 1);
-  sprintf(path, "%s/%d", pageDirectory, docID); // create the path for the first file
-  while((read = fopen(path, "r")) != NULL){ // while there is another file named one number higher than the last
-    mem_free(path);
+  char* path = mem_malloc(strlen(pageDirectory) + 12); // room for '/', the digits of docID, and '\0'
+  while(order == NULL || docID - firstDoc < numPages){
+    // the file for docID: the file named docID, or the next file in the order
+    sprintf(path, "%s/%d", pageDirectory, order == NULL ? docID : order[docID - firstDoc]);
+    if((read = fopen(path, "r")) == NULL){ // there is no file named one number higher than the last
+      break;
+    }
     char* URL = file_readLine(read);
     char* depStr = file_readLine(read);
     int depth = atoi(depStr);
     mem_free(depStr);
     char* HTML = file_readFile(read);
     fclose(read);
+    size_t fetched = HTML == NULL ? 0 : strlen(HTML) + 1;
+    memtag_charge(MEMTAG_FETCH, fetched); // the page is held until it has been indexed
     webpage_t* page = webpage_new(URL, depth, HTML);
     if (page != NULL){
-      indexPage(index, page, docID);
+      int length = indexPage(index, positions, lexer, page, docID);
+      docs_add(docs, docID, length);
+      urls_add(urls, docID, webpage_getURL(page), webpage_getDepth(page), length);
     }
     webpage_delete(page);
+    memtag_release(MEMTAG_FETCH, fetched);
     docID++;
-    path = mem_malloc(strlen(pageDirectory) + sizeof(docID) + 1);
-    sprintf(path, "%s/%d", pageDirectory, docID); // create the path for the first file
   }
   mem_free(path);
-  index_fill(index, indexFilename); // actually writting the information gathered to file
-  hashtable_delete(index, counters_delete_helper); // delete hashtable and counters inside
+  lexer_delete(lexer);
+  if(!spimi_finish(index)){ // actually writting the information gathered to file (merging any runs)
+    fprintf(stderr,"*** could not write the index to %s\n", indexFilename);
+    exit(3);
+  }
+  return docID - 1;
 }
 
 
-/* ****************** indexPage ********************** */
+/* ****************** indexAppend ********************** */
 /*
- * Scan all of the words on the page and add the longer than 2 letter ones to the hashtable
- * if a word hasn't been seen, add the word as the key and a counters, then add the docID to the counters
- * if seen, but the docID hasn't been added, add docID to counters
- * if the word and docID already exist in the hashtable, increment the counter
+ * Index the pages of pageDirectory that come after the last docID in the index directory
+ * into a new segment and publish it, so queriers see it right away
+ * then fork a background process to compact the segments with the merge policy
  */
 
 static void
-indexPage(hashtable_t* index, webpage_t* page, int docID){
-  int pos = 0;
-  char* word;
-  char* wordNorm;
-  while ((word = webpage_getNextWord(page, &pos)) != NULL) {
-    // as long as there is an unvisited word on the page
-    if(strlen(word) > 2){    // as long as the word is longer than 2 letters
-      wordNorm = word_normalize(word);      // normalizes the word
-      if(hashtable_find(index, wordNorm) == NULL){ // if the word is not in the hashtable
-        hashtable_insert(index, wordNorm, counters_new());           // insert the word
-      }
-        counters_add(hashtable_find(index, wordNorm), docID); // increment or add new node to counters
-        mem_free(wordNorm);
-    }
-    mem_free(word);
+indexAppend(char* pageDirectory, char* indexDir, size_t budget){
+  int firstDoc = segment_lastDoc(indexDir) + 1;
+  char* path = segment_newPath(indexDir);
+  char* docsFile = docs_filename(indexDir);
+  docs_t* docs = docs_load(docsFile);
+  if(docs == NULL){ // first segment (or an index directory made before document tables)
+    docs = docs_new();
+  }
+  mem_free(docsFile);
+  char* urlsFile = urls_filename(indexDir);
+  urls_t* urls = urls_read(urlsFile);
+  if(urls == NULL){ // first segment (or an index directory made before URL tables)
+    urls = urls_new();
+  }
+  mem_free(urlsFile);
+  int lastDoc = indexBuild(pageDirectory, path, docs, urls, NULL, NULL, 0, firstDoc, budget);
+  if(lastDoc < firstDoc){ // no new pages: nothing to add
+    docs_delete(docs);
+    urls_delete(urls);
+    remove(path);
+    mem_free(path);
+    return;
+  }
+  indexDocs(docs, urls, indexDir); // before publishing, so the segment never has docs missing from the tables
+  docs_delete(docs);
+  urls_delete(urls);
+  if(!segment_publish(indexDir, path, firstDoc, lastDoc)){
+    fprintf(stderr,"*** could not add the new segment to %s\n", indexDir);
+    exit(3);
+  }
+  mem_free(path);
+  fflush(stdout);
+  fflush(stderr);
+  pid_t pid = fork();
+  if(pid == 0){ // child: compact in the background, the new segment is already live
+    _exit(segment_compact(indexDir) < 0 ? 3 : 0);
+  } else if(pid < 0){ // could not fork: compact before we exit instead
+    segment_compact(indexDir);
+  }
+}
+
+
+/* ****************** indexDocs ********************** */
+/*
+ * Write the document table and the URL table for the index at indexFilename
+ */
+
+static void
+indexDocs(docs_t* docs, urls_t* urls, char* indexFilename){
+  char* docsFile = docs_filename(indexFilename);
+  if(!docs_save(docs, docsFile)){
+    fprintf(stderr,"*** could not write the document table to %s\n", docsFile);
+    exit(3);
+  }
+  mem_free(docsFile);
+  char* urlsFile = urls_filename(indexFilename);
+  if(!urls_save(urls, urlsFile)){
+    fprintf(stderr,"*** could not write the URL table to %s\n", urlsFile);
+    exit(3);
+  }
+  mem_free(urlsFile);
+}
+
+
+/* ****************** indexDict ********************** */
+/*
+ * Write the dictionary for the index file at indexFilename
+ */
+
+static void
+indexDict(char* indexFilename){
+  char* dictFile = dict_filename(indexFilename);
+  if(!dict_saveIndex(indexFilename, dictFile)){
+    fprintf(stderr,"*** could not write the dictionary to %s\n", dictFile);
+    exit(3);
   }
+  mem_free(dictFile);
 }
 
 
-/* ****************** counters_delete_helper ********************** */
+/* ****************** indexBlocks ********************** */
 /*
- * Helpper function so I can use counters_delete on the items in the hashtable by casting the void* to counters_t*
+ * Write the block metadata for the index file at indexFilename: the postings of each
+ * word cut into fixed-size blocks, with the last docID and largest count of each block
  */
 
 static void
-counters_delete_helper(void* item){
-  counters_t* ctrs = item;
-  counters_delete(ctrs);
-}
\ No newline at end of file
+indexBlocks(char* indexFilename){
+  char* blocksFile = postings_blocksFilename(indexFilename);
+  if(!postings_saveBlocks(indexFilename, blocksFile)){
+    fprintf(stderr,"*** could not write the block metadata to %s\n", blocksFile);
+    exit(3);
+  }
+  mem_free(blocksFile);
+}
+
+
+/* ****************** indexCrc ********************** */
+/*
+ * Write the checksums of the index file at indexFilename and of the tables beside it;
+ * called once they are all written
+ */
+
+static void
+indexCrc(char* indexFilename){
+  char* crcFile = crc_filename(indexFilename);
+  if(!crc_save(indexFilename, crcFile)){
+    fprintf(stderr,"*** could not write the checksums to %s\n", crcFile);
+    exit(3);
+  }
+  mem_free(crcFile);
+}
+
+
+/* ****************** indexPage ********************** */
+/*
+ * Scan all of the words on the page with the lexer and add the longer than 2 letter ones to the index
+ * if a word hasn't been seen, the index starts a postings list for it, then adds the docID
+ * if seen, but the docID hasn't been added, the docID is appended to its postings
+ * if the word and docID already exist in the index, the count is incremented
+ * and records the position of each word added (its place among all the words of the page)
+ * returns the number of words added (the length of the page)
+ */
+
+static int
+indexPage(spimi_t* index, positions_t* positions, lexer_t* lexer, webpage_t* page, int docID){
+  int pos = 0;
+  int length = 0;
+  int position = 0;
+  int letters;
+  char* word;
+  while ((word = lexer_next(lexer, webpage_getHTML(page), &pos, &letters)) != NULL) {
+    // as long as there is an unvisited word on the page (already folded to lowercase)
+    if(letters > 2){    // as long as the word is longer than 2 letters
+      if(!spimi_add(index, word, docID)){ // increment or add new posting for the word
+        fprintf(stderr,"*** could not write a run of the index to disk\n");
+        exit(3);
+      }
+      if(positions != NULL && !positions_add(positions, word, docID, position)){
+        fprintf(stderr,"*** could not write a run of the positions to disk\n");
+        exit(3);
+      }
+      length++;
+    }
+    position++;
+  }
+  return length;
+}
+
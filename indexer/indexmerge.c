@@ -0,0 +1,295 @@
+/*
+ * indexmerge.c - a C script to merge indexes written by the indexer (e.g. for separate crawls,
+ * or for parts of one page directory indexed on separate machines) into one index
+ * the indexes are read a line at a time, in word order, and their lines for each word are
+ * written as one line of the merged index, so memory does not grow with the size of the indexes;
+ * the docIDs of each index are shifted past the largest docID of the indexes before it,
+ * so they cannot collide (the pages of the second index come after those of the first, ...)
+ * the document and URL tables of the indexes are merged the same way, and the dictionary
+ * and block metadata are written for the merged index, as the indexer writes them, and then
+ * the checksums of all of them
+ *
+ *
+ * Usage: ./indexmerge indexFilename indexFilename [indexFilename ...] mergedFilename
+ * where each indexFilename is an index file written by the indexer (sorted by word), not pruned
+ * and mergedFilename is a file that can be existing or not to write the merged index to
+ *
+ * Exit with 0 means succesful
+ * Exit with 1 means wrong number of inputs
+ * Exit with 2 means wrong type of inputs or inputs out of range
+ * Exit with 3 means the indexes could not be merged (one is unreadable or not sorted by word)
+ * or the merged index (or one of its tables) could not be written
+ *
+ * Cooper LaPorte, March 2023
+ */
+
+#define _POSIX_C_SOURCE 200809L   // getline
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "mem.h"
+#include "memtag.h"
+#include "index.h"
+#include "segment.h"
+#include "docs.h"
+#include "urls.h"
+#include "dict.h"
+#include "bm25.h"
+#include "postings.h"
+#include "positions.h"
+#include "crc.h"
+
+
+
+static void parseArgs(const int argc, char* argv[]);
+static int* mergeShifts(char** files, const int k);
+static int indexMaxDoc(const char* indexFilename);
+static void mergeDocs(char** files, const int k, const int* shifts, const char* mergedFilename);
+static void mergeUrls(char** files, const int k, const int* shifts, const char* mergedFilename);
+static void mergeDict(const char* mergedFilename);
+static void mergeCrc(const char* mergedFilename);
+
+/* ***************** main ********************** */
+
+int
+main(const int argc, char* argv[])
+{
+memtag_atexit(); // report memory by subsystem at exit when TSE_MEMSTATS is set
+if (argc >= 4){
+    // two or more indexes, and the merged index
+    parseArgs(argc, argv);
+    char** files = &argv[1];
+    int k = argc - 2;
+    const char* mergedFilename = argv[argc - 1];
+    int* shifts = mergeShifts(files, k);
+    if(!index_mergeShift((const char**)files, k, shifts, mergedFilename)){
+      fprintf(stderr,"*** could not merge the indexes into %s (is each one an index sorted by word?)\n", mergedFilename);
+      exit(3);
+    }
+    mergeDocs(files, k, shifts, mergedFilename);
+    mergeUrls(files, k, shifts, mergedFilename);
+    mergeDict(mergedFilename);
+    char* posFile = positions_filename(mergedFilename);
+    remove(posFile); // the positions are not merged: drop any left from an index written there before
+    mem_free(posFile);
+    char* dfFile = bm25_dfFilename(mergedFilename);
+    remove(dfFile); // no index merged is pruned, so the postings give the document frequencies
+    mem_free(dfFile);
+    mergeCrc(mergedFilename);
+    mem_free(shifts);
+  } else{
+    // too few arguments
+    fprintf(stderr,"*** need to pass at least two indexes and the file to merge them into\n");
+    exit(1);
+  }
+exit(0);
+}
+
+
+
+/* ****************** parseArgs ********************** */
+/*
+ * Takes the arguments given to indexmerge.c and checks them
+ * makes sure each index is a readable file (index directories are not merged) and not pruned, and that
+ * the merged index is not one of them, and creates or truncates a file for the merged index
+ */
+
+static void
+parseArgs(const int argc, char* argv[]){
+  const char* mergedFilename = argv[argc - 1];
+  for(int arg = 1; arg < argc - 1; arg++){
+    FILE* fp = segment_isIndexDir(argv[arg]) ? NULL : fopen(argv[arg], "r");
+    if(fp == NULL){
+      fprintf(stderr,"*** need to pass readable index files to merge (not index directories): %s\n", argv[arg]);
+      exit(2);
+    }
+    fclose(fp);
+    char* dfFile = bm25_dfFilename(argv[arg]);
+    fp = fopen(dfFile, "r");
+    if(fp != NULL){
+      fprintf(stderr,"*** cannot merge a pruned index (it has %s); merge the indexes it came from, then prune\n", dfFile);
+      exit(2);
+    }
+    mem_free(dfFile);
+    if(strcmp(argv[arg], mergedFilename) == 0){
+      fprintf(stderr,"*** the merged index cannot be one of the indexes merged: %s\n", mergedFilename);
+      exit(2);
+    }
+  }
+  FILE* fp = mem_assert(fopen(mergedFilename, "w"), "*** need to pass a proper file pathname (path exists, directory and file are not read only)");
+  fclose(fp);      // creates file for mergedFilename after ensuring it is a path, closes it since no writing now
+}
+
+
+/* ****************** mergeShifts ********************** */
+/*
+ * Returns what to add to the docIDs of each of the k indexes: 0 for the first, and for each
+ * after it the shift of the one before plus its largest docID; caller must free the array
+ */
+
+static int*
+mergeShifts(char** files, const int k){
+  int* shifts = mem_malloc_assert(k * sizeof(int), "Error allocating memory");
+  shifts[0] = 0;
+  for(int f = 1; f < k; f++){
+    shifts[f] = shifts[f - 1] + indexMaxDoc(files[f - 1]);
+  }
+  return shifts;
+}
+
+
+/* ****************** indexMaxDoc ********************** */
+/*
+ * Returns the largest docID of an index: from its document table (which has every page
+ * indexed, even one with no words) or URL table, or else by reading the index a line at a time
+ */
+
+static int
+indexMaxDoc(const char* indexFilename){
+  char* docsFile = docs_filename(indexFilename);
+  docs_t* docs = docs_load(docsFile);
+  mem_free(docsFile);
+  int maxDoc = docs_maxDoc(docs);
+  docs_delete(docs);
+  char* urlsFile = urls_filename(indexFilename);
+  urlmap_t* urls = urls_load(urlsFile);
+  mem_free(urlsFile);
+  if(urls != NULL && urls_maxDoc(urls) > maxDoc){
+    maxDoc = urls_maxDoc(urls);
+  }
+  urls_unload(urls);
+  if(maxDoc == 0){ // an index from before document tables: read the docIDs of every line
+    FILE* fp = fopen(indexFilename, "r");
+    char* line = NULL;
+    size_t size = 0;
+    while(fp != NULL && getline(&line, &size, fp) > 0){
+      strtok(line, " \n"); // the word
+      char* docID;
+      while((docID = strtok(NULL, " \n")) != NULL && strtok(NULL, " \n") != NULL){
+        if(atoi(docID) > maxDoc){
+          maxDoc = atoi(docID);
+        }
+      }
+    }
+    if(fp != NULL){
+      fclose(fp);
+    }
+    free(line);   // allocated by getline
+  }
+  return maxDoc;
+}
+
+
+/* ****************** mergeDocs ********************** */
+/*
+ * Write the document table of the merged index, with the documents of each index at their
+ * shifted docIDs; if an index has no document table, the merged index gets none either
+ * (and the querier makes one from the index, as it does for such an index)
+ */
+
+static void
+mergeDocs(char** files, const int k, const int* shifts, const char* mergedFilename){
+  char* mergedFile = docs_filename(mergedFilename);
+  docs_t* merged = docs_new();
+  bool all = true;
+  for(int f = 0; f < k && all; f++){
+    char* docsFile = docs_filename(files[f]);
+    docs_t* docs = docs_load(docsFile);
+    mem_free(docsFile);
+    all = docs != NULL;
+    for(int docID = 1; docID <= docs_maxDoc(docs); docID++){
+      if(docs_has(docs, docID)){
+        docs_add(merged, docID + shifts[f], docs_length(docs, docID));
+      }
+    }
+    docs_delete(docs);
+  }
+  if(!all){
+    remove(mergedFile); // not a table for this index
+  } else if(!docs_save(merged, mergedFile)){
+    fprintf(stderr,"*** could not write the document table to %s\n", mergedFile);
+    exit(3);
+  }
+  docs_delete(merged);
+  mem_free(mergedFile);
+}
+
+
+/* ****************** mergeUrls ********************** */
+/*
+ * Write the URL table of the merged index, with the pages of each index at their shifted
+ * docIDs; if an index has no URL table, the merged index gets none either
+ */
+
+static void
+mergeUrls(char** files, const int k, const int* shifts, const char* mergedFilename){
+  char* mergedFile = urls_filename(mergedFilename);
+  urls_t* merged = urls_new();
+  bool all = true;
+  for(int f = 0; f < k && all; f++){
+    char* urlsFile = urls_filename(files[f]);
+    urlmap_t* urls = urls_load(urlsFile);
+    mem_free(urlsFile);
+    all = urls != NULL;
+    for(int docID = 1; docID <= urls_maxDoc(urls); docID++){
+      int depth;
+      int length;
+      char* url = urls_get(urls, docID, &depth, &length);
+      if(url != NULL){
+        urls_add(merged, docID + shifts[f], url, depth, length);
+        mem_free(url);
+      }
+    }
+    urls_unload(urls);
+  }
+  if(!all){
+    remove(mergedFile); // not a table for this index
+  } else if(!urls_save(merged, mergedFile)){
+    fprintf(stderr,"*** could not write the URL table to %s\n", mergedFile);
+    exit(3);
+  }
+  urls_delete(merged);
+  mem_free(mergedFile);
+}
+
+
+/* ****************** mergeDict ********************** */
+/*
+ * Write the dictionary and the block metadata of the merged index, reading it back
+ * a line at a time, as the indexer does for the index it writes
+ */
+
+static void
+mergeDict(const char* mergedFilename){
+  char* dictFile = dict_filename(mergedFilename);
+  if(!dict_saveIndex(mergedFilename, dictFile)){
+    fprintf(stderr,"*** could not write the dictionary to %s\n", dictFile);
+    exit(3);
+  }
+  mem_free(dictFile);
+  char* blocksFile = postings_blocksFilename(mergedFilename);
+  if(!postings_saveBlocks(mergedFilename, blocksFile)){
+    fprintf(stderr,"*** could not write the block metadata to %s\n", blocksFile);
+    exit(3);
+  }
+  mem_free(blocksFile);
+}
+
+
+/* ****************** mergeCrc ********************** */
+/*
+ * Write the checksums of the merged index and of the tables beside it, once they are all
+ * written, as the indexer does for the index it writes
+ */
+
+static void
+mergeCrc(const char* mergedFilename){
+  char* crcFile = crc_filename(mergedFilename);
+  if(!crc_save(mergedFilename, crcFile)){
+    fprintf(stderr,"*** could not write the checksums to %s\n", crcFile);
+    exit(3);
+  }
+  mem_free(crcFile);
+}
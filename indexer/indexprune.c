@@ -0,0 +1,318 @@
+/*
+ * indexprune.c - a C script to prune an index written by the indexer, so a larger crawl fits
+ * in the memory of the querier: for each word, the postings that score too low to matter are
+ * dropped, keeping at least the k best postings of the word (and any tied with the kth), so a
+ * query of one word gets the same k best documents, in the same order, from the pruned index
+ * the index is read a line at a time, so memory does not grow with the size of the index;
+ * the document and URL tables are copied (the pages and their lengths do not change), the
+ * dictionary and block metadata are written for the pruned index, as the indexer writes them,
+ * and so is a table of the number of documents each word was in before pruning
+ * (prunedFilename.df), from which querier -b takes the idf of the words, so its scores
+ * are the same as with the index; last, the checksums of them all are written, as the
+ * indexer writes them
+ *
+ *
+ * Usage: ./indexprune [-b] [-k k] [-f fraction] [-t threshold] indexFilename prunedFilename
+ * where indexFilename is an index file written by the indexer
+ * and prunedFilename is a file that can be existing or not to write the pruned index to
+ * -b scores postings with BM25 (needs the document table, indexFilename.docs), as querier -b
+ * ranks them; without it postings are scored by their count, as the querier ranks them
+ * -k gives how many of the best postings of each word are always kept (10 if not given)
+ * -f keeps, besides those, the postings scoring at least fraction (0 to 1) of the kth best
+ * score of the word (1 if not given, so just the k best and their ties)
+ * -t drops, of those, the postings scoring less than threshold (a global cut, 0 if not given),
+ * but never one of the k best
+ *
+ * Exit with 0 means succesful
+ * Exit with 1 means wrong number of inputs
+ * Exit with 2 means wrong type of inputs or inputs out of range
+ * Exit with 3 means the index could not be pruned (it is unreadable or malformed)
+ * or the pruned index (or one of its tables) could not be written
+ *
+ * Cooper LaPorte, March 2023
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "mem.h"
+#include "memtag.h"
+#include "index.h"
+#include "segment.h"
+#include "docs.h"
+#include "urls.h"
+#include "dict.h"
+#include "bm25.h"
+#include "postings.h"
+#include "positions.h"
+#include "crc.h"
+
+
+/**************** local types ****************/
+/* pruneopts: the options given before the arguments */
+typedef struct pruneopts {
+  bool bm25;         // score postings with BM25 instead of by count (-b)
+  int k;             // the best postings of each word always kept (-k)
+  double fraction;   // also keep postings scoring this fraction of the kth best (-f)
+  double threshold;  // drop postings scoring less than this, but for the k best (-t)
+} pruneopts_t;
+
+
+static int parseOpts(const int argc, char* argv[], pruneopts_t* opts);
+static void parseArgs(char* argv[], char** indexFilename, char** prunedFilename);
+static docs_t* pruneDocs(const pruneopts_t* opts, const char* indexFilename);
+static double pruneScore(void* arg, const int df, const int docID, const int count);
+static void pruneTables(const char* indexFilename, const char* prunedFilename);
+static void copyTable(const char* from, const char* to);
+static void pruneDict(const char* prunedFilename);
+static void pruneCrc(const char* prunedFilename);
+
+/* ***************** main ********************** */
+
+int
+main(const int argc, char* argv[])
+{
+memtag_atexit(); // report memory by subsystem at exit when TSE_MEMSTATS is set
+pruneopts_t opts = { false, 10, 1, 0 };
+int arg = parseOpts(argc, argv, &opts); // index of the first argument after the options
+if (argc - arg == 2){
+    // two arguments
+    char* indexFilename = NULL;
+    char* prunedFilename = NULL;
+    parseArgs(&argv[arg], &indexFilename, &prunedFilename);
+    docs_t* docs = pruneDocs(&opts, indexFilename);
+    char* dfFile = bm25_dfFilename(prunedFilename);
+    long kept = 0;
+    long total = 0;
+    if(!index_prune(indexFilename, prunedFilename, dfFile, opts.k, opts.fraction, opts.threshold,
+                    docs, docs == NULL ? NULL : pruneScore, &kept, &total)){
+      fprintf(stderr,"*** could not prune %s into %s (is it an index?)\n", indexFilename, prunedFilename);
+      exit(3);
+    }
+    mem_free(dfFile);
+    docs_delete(docs);
+    pruneTables(indexFilename, prunedFilename);
+    pruneDict(prunedFilename);
+    char* posFile = positions_filename(prunedFilename);
+    remove(posFile); // the positions are not pruned: drop any left from an index written there before
+    mem_free(posFile);
+    pruneCrc(prunedFilename);
+    printf("kept %ld of %ld postings (%.1f%%)\n", kept, total, total > 0 ? 100.0 * kept / total : 100.0);
+  } else{
+    // too few or many arguments
+    fprintf(stderr,"*** need to pass exactly two arguments\n");
+    exit(1);
+  }
+exit(0);
+}
+
+
+
+/* ****************** parseOpts ********************** */
+/*
+ * Takes the options at the front of the arguments given to indexprune.c and checks them
+ * -b asks for BM25 scores
+ * -k must be followed by a positive number of postings
+ * -f must be followed by a fraction from 0 to 1
+ * -t must be followed by a threshold of 0 or more
+ * returns the index in argv of the first argument that is not an option
+ */
+
+static int
+parseOpts(const int argc, char* argv[], pruneopts_t* opts){
+  int arg = 1;
+  while(arg < argc && argv[arg][0] == '-'){
+    char* end = NULL;
+    if(strcmp(argv[arg], "-b") == 0){
+      opts->bm25 = true;
+      arg++;
+    } else if(strcmp(argv[arg], "-k") == 0 && arg + 1 < argc){
+      opts->k = atoi(argv[arg + 1]);
+      if(opts->k <= 0){
+        fprintf(stderr,"*** need to pass a positive integer number of postings for -k\n");
+        exit(2);
+      }
+      arg += 2;
+    } else if(strcmp(argv[arg], "-f") == 0 && arg + 1 < argc){
+      opts->fraction = strtod(argv[arg + 1], &end);
+      if(end == argv[arg + 1] || *end != '\0' || !(opts->fraction >= 0 && opts->fraction <= 1)){
+        fprintf(stderr,"*** need to pass a fraction from 0 to 1 for -f\n");
+        exit(2);
+      }
+      arg += 2;
+    } else if(strcmp(argv[arg], "-t") == 0 && arg + 1 < argc){
+      opts->threshold = strtod(argv[arg + 1], &end);
+      if(end == argv[arg + 1] || *end != '\0' || !(opts->threshold >= 0)){
+        fprintf(stderr,"*** need to pass a threshold of 0 or more for -t\n");
+        exit(2);
+      }
+      arg += 2;
+    } else{
+      fprintf(stderr,"*** unknown option %s\n", argv[arg]);
+      exit(2);
+    }
+  }
+  return arg;
+}
+
+
+/* ****************** parseArgs ********************** */
+/*
+ * Takes the two arguments given to indexprune.c (after any options) and checks them
+ * makes sure the index is a readable file (index directories are not pruned) that was not
+ * pruned already (it has no document frequency table: its postings no longer give the number
+ * of documents of its words), and that the pruned index is not the same file,
+ * and creates or truncates a file for the pruned index
+ */
+
+static void
+parseArgs(char* argv[], char** indexFilename, char** prunedFilename){
+  *indexFilename = argv[0];
+  *prunedFilename = argv[1];
+  FILE* fp = segment_isIndexDir(*indexFilename) ? NULL : fopen(*indexFilename, "r");
+  if(fp == NULL){
+    fprintf(stderr,"*** need to pass a readable index file to prune (not an index directory): %s\n", *indexFilename);
+    exit(2);
+  }
+  fclose(fp);
+  char* dfFile = bm25_dfFilename(*indexFilename);
+  fp = fopen(dfFile, "r");
+  if(fp != NULL){
+    fprintf(stderr,"*** the index was pruned already (it has %s); prune the index it came from\n", dfFile);
+    exit(2);
+  }
+  mem_free(dfFile);
+  if(strcmp(*indexFilename, *prunedFilename) == 0){
+    fprintf(stderr,"*** the pruned index cannot be the index pruned: %s\n", *prunedFilename);
+    exit(2);
+  }
+  fp = mem_assert(fopen(*prunedFilename, "w"), "*** need to pass a proper file pathname (path exists, directory and file are not read only)");
+  fclose(fp);      // creates file for prunedFilename after ensuring it is a path, closes it since no writing now
+}
+
+
+/* ****************** pruneDocs ********************** */
+/*
+ * Returns the document table of the index to score postings with BM25 if -b was given,
+ * otherwise NULL (postings are scored by their count); exits if there is no table for -b
+ */
+
+static docs_t*
+pruneDocs(const pruneopts_t* opts, const char* indexFilename){
+  if(!opts->bm25){
+    return NULL;
+  }
+  char* docsFile = docs_filename(indexFilename);
+  docs_t* docs = docs_load(docsFile);
+  if(docs == NULL){
+    fprintf(stderr,"*** -b needs the document table of the index: %s\n", docsFile);
+    exit(2);
+  }
+  mem_free(docsFile);
+  return docs;
+}
+
+
+/* ****************** pruneScore ********************** */
+/*
+ * Helper function for index_prune to score a posting with BM25, as querier -b does
+ */
+
+static double
+pruneScore(void* arg, const int df, const int docID, const int count){
+  return bm25_docScore(arg, df, docID, count);
+}
+
+
+/* ****************** pruneTables ********************** */
+/*
+ * Copy the document and URL tables of the index for the pruned index: the pages, their
+ * lengths and their URLs are the same, and BM25 needs the lengths of the pages as they were
+ */
+
+static void
+pruneTables(const char* indexFilename, const char* prunedFilename){
+  char* from = docs_filename(indexFilename);
+  char* to = docs_filename(prunedFilename);
+  copyTable(from, to);
+  mem_free(from);
+  mem_free(to);
+  from = urls_filename(indexFilename);
+  to = urls_filename(prunedFilename);
+  copyTable(from, to);
+  mem_free(from);
+  mem_free(to);
+}
+
+
+/* ****************** copyTable ********************** */
+/*
+ * Copy the file from to the file to; if there is no file from, the index has no such table,
+ * so neither does the pruned index (any file to left from before is removed)
+ */
+
+static void
+copyTable(const char* from, const char* to){
+  FILE* in = fopen(from, "r");
+  if(in == NULL){
+    remove(to); // not a table for this index
+    return;
+  }
+  FILE* out = fopen(to, "w");
+  bool ok = out != NULL;
+  char buf[BUFSIZ];
+  size_t n;
+  while(ok && (n = fread(buf, 1, sizeof(buf), in)) > 0){
+    ok = fwrite(buf, 1, n, out) == n;
+  }
+  ok = ok && !ferror(in);
+  fclose(in);
+  if(out != NULL && fclose(out) != 0){
+    ok = false;
+  }
+  if(!ok){
+    fprintf(stderr,"*** could not copy %s to %s\n", from, to);
+    exit(3);
+  }
+}
+
+
+/* ****************** pruneDict ********************** */
+/*
+ * Write the dictionary and the block metadata of the pruned index, reading it back
+ * a line at a time, as the indexer does for the index it writes
+ */
+
+static void
+pruneDict(const char* prunedFilename){
+  char* dictFile = dict_filename(prunedFilename);
+  if(!dict_saveIndex(prunedFilename, dictFile)){
+    fprintf(stderr,"*** could not write the dictionary to %s\n", dictFile);
+    exit(3);
+  }
+  mem_free(dictFile);
+  char* blocksFile = postings_blocksFilename(prunedFilename);
+  if(!postings_saveBlocks(prunedFilename, blocksFile)){
+    fprintf(stderr,"*** could not write the block metadata to %s\n", blocksFile);
+    exit(3);
+  }
+  mem_free(blocksFile);
+}
+
+
+/* ****************** pruneCrc ********************** */
+/*
+ * Write the checksums of the pruned index and of the tables beside it, once they are all
+ * written, as the indexer does for the index it writes
+ */
+
+static void
+pruneCrc(const char* prunedFilename){
+  char* crcFile = crc_filename(prunedFilename);
+  if(!crc_save(prunedFilename, crcFile)){
+    fprintf(stderr,"*** could not write the checksums to %s\n", crcFile);
+    exit(3);
+  }
+  mem_free(crcFile);
+}
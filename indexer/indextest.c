@@ -35,22 +35,7 @@ main(const int argc, char* argv[])
 {
 if (argc == 3){
     // two arguments
-    hashtable_t* index = hashtable_new(200);
-    FILE* oldFile = fopen(argv[1], "r");
-    char* line = NULL;
-    while((line = file_readLine(oldFile)) != NULL){ // as long as there is another line in the file
-        char* word = strtok(line, " "); // take word from the line
-        char* docID = NULL;
-        char* count = NULL;
-        counters_t* ctrs = counters_new();
-        while((docID = strtok(NULL, " ")) != NULL){ // continue to take the docID and count pairs and add them to counters
-            count = strtok(NULL, " ");
-            counters_set(ctrs, atoi(docID), atoi(count));
-        }
-        hashtable_insert(index, word, ctrs); // add to the hashtable to recreate the one from indexer
-        mem_free(line);
-    }
-    fclose(oldFile);
+    hashtable_t* index = mem_assert(index_read(argv[1]), "*** need to pass a readable index file"); // recreate the one from indexer
     index_fill(index, argv[2]);
     hashtable_delete(index, counters_delete_helper); // delete hashtable and counters inside
   } else{
@@ -46,6 +46,24 @@ chmod -w ../data/file_reading
 ### Calling with two parameters and an invalid indexFile (file exists and is read only)
 ./indexer  ../data/has_crawler ../data/file_reading
 
+### Calling with a memory budget that is not a positive number
+./indexer -m zero ../data/has_crawler ../data/whoops
+
+### Calling with a memory budget but missing the indexFile
+./indexer -m 1 ../data/has_crawler
+
+### Calling with an unknown option
+./indexer -x ../data/has_crawler ../data/whoops
+
+### Calling to append to an index directory that does not exist
+./indexer -a ../data/has_crawler ../data/not_here
+
+### Calling for positions while appending (not supported)
+./indexer -a -p ../data/has_crawler ../data/whoops
+
+### Calling to number the pages by URL while appending (not supported)
+./indexer -a -r ../data/has_crawler ../data/whoops
+
 ### making crawler and populating some pageDirectories with it
 make -C ../crawler
 mkdir ../data/letters0
@@ -70,6 +88,36 @@ mkdir ../data/wikipedia1
 ./indexer  ../data/wikipedia1 ../data/wikipedia1index
 
 
+### Running indexer over wikipedia at depth 1 with a 1MB memory budget (flushes and merges runs)
+./indexer -m 1 ../data/wikipedia1 ../data/wikipedia1indexruns
+
+### Running indexer over toscrape at depth 1 with positions (writes toScrape1indexpos.pos beside the index)
+./indexer -p ../data/toScrape1 ../data/toScrape1indexpos
+ls -l ../data/toScrape1indexpos*
+
+### Indexing toscrape at depth 1 again there without positions (the .pos from before is removed)
+./indexer ../data/toScrape1 ../data/toScrape1indexpos
+ls ../data/toScrape1indexpos*
+
+### Running indexer over wikipedia at depth 1 with the pages numbered by URL, with positions
+### (the querier gives the same pages and scores as with the index numbered in crawl order)
+./indexer -r -p ../data/wikipedia1 ../data/wikipedia1indexsorted
+ls -l ../data/wikipedia1indexsorted*
+echo "computer science" | ../querier/querier ../data/wikipedia1 ../data/wikipedia1index | head -4
+echo "computer science" | ../querier/querier ../data/wikipedia1 ../data/wikipedia1indexsorted | head -4
+
+
+### Appending letters at depth 10 to an empty index directory (one new segment), then again (no new pages, no new segment)
+mkdir ../data/letter10segments
+./indexer -a ../data/letters10 ../data/letter10segments
+./indexer -a ../data/letters10 ../data/letter10segments
+cat ../data/letter10segments/segments
+
+### The document tables for letters at depth 10 (numDocs totalWords, then docID length); the two should be the same
+cat ../data/letter10index.docs
+cat ../data/letter10segments/docs
+
+
 ### Running indextest on letters at depth 0
 ./indextest  ../data/letter0index ../data/letter0indexcopy
 
@@ -95,6 +143,112 @@ mkdir ../data/wikipedia1
 ### Running indexcmp to compare the index from wikipedia at depth 1 and its copy from indextest
 ./indexcmp  ../data/wikipedia1index ../data/wikipedia1indexcopy
 
+### Running indexcmp to compare the index from letters at depth 10 and the segment appended for it
+./indexcmp  ../data/letter10index ../data/letter10segments/seg-1-*[0-9]
+
+### Running indexcmp to compare the index from wikipedia at depth 1 and the one built from merged runs
+./indexcmp  ../data/wikipedia1index ../data/wikipedia1indexruns
+
+
+
+# Test indexmerge with various invalid arguments
+### Calling indexmerge with one index and no merged index
+./indexmerge ../data/letter0index
+
+### Calling indexmerge with one index and a merged index
+./indexmerge ../data/letter0index ../data/whoops
+
+### Calling indexmerge with an index that does not exist
+./indexmerge ../data/letter0index ../data/not_here ../data/whoops
+
+### Calling indexmerge with an index directory
+./indexmerge ../data/letter0index ../data/letter10segments ../data/whoops
+
+### Calling indexmerge with the merged index also one of the indexes
+./indexmerge ../data/letter0index ../data/letter10index ../data/letter10index
+
+### Calling indexmerge with an index that is not sorted by word
+sort -r ../data/letter10index > ../data/letter10unsorted
+./indexmerge ../data/letter0index ../data/letter10unsorted ../data/whoops
+
+### Merging the index from letters at depth 10 with itself (the docIDs of the second copy come after the first)
+./indexmerge ../data/letter10index ../data/letter10index ../data/letter10twice
+head -5 ../data/letter10twice
+cat ../data/letter10twice.docs
+
+### Merging the indexes from toscrape at depth 1 and wikipedia at depth 1 (writes the tables, dictionary and blocks beside it)
+./indexmerge ../data/toScrape1index ../data/wikipedia1index ../data/mergedindex
+ls -l ../data/mergedindex*
+head -1 ../data/mergedindex.docs
+
+### Calling indexprune with a fraction out of range
+./indexprune -f 2 ../data/toScrape1index ../data/whoops
+
+### Calling indexprune with the pruned index the same as the index
+./indexprune ../data/toScrape1index ../data/toScrape1index
+
+### Pruning the index from wikipedia at depth 1 by count, keeping the 3 best postings of each word
+### (the querier gives the same 3 best pages for a word with both indexes)
+./indexprune -k 3 ../data/wikipedia1index ../data/wikipedia1pruned
+ls -l ../data/wikipedia1index ../data/wikipedia1pruned*
+echo "computer" | ../querier/querier ../data/wikipedia1 ../data/wikipedia1index | head -5
+echo "computer" | ../querier/querier ../data/wikipedia1 ../data/wikipedia1pruned | head -5
+
+### Pruning it by BM25, keeping the 3 best postings and those scoring half as much (the scores are the same too)
+./indexprune -b -k 3 -f 0.5 ../data/wikipedia1index ../data/wikipedia1prunedb
+echo "computer" | ../querier/querier -b -k 3 ../data/wikipedia1 ../data/wikipedia1index
+echo "computer" | ../querier/querier -b -k 3 ../data/wikipedia1 ../data/wikipedia1prunedb
+
+### Calling indexprune on an index that was pruned already
+./indexprune ../data/wikipedia1pruned ../data/whoops
+
+### Calling indexmerge with a pruned index (merge the indexes it came from, then prune)
+./indexmerge ../data/toScrape1index ../data/wikipedia1pruned ../data/whoops
+
+### Indexing a page with entities, UTF-8 letters, a comment, a script and a style
+### (expect café, naïve, crème, été and shown, with their accents; no amp, nbsp, copy, hidden or color)
+mkdir ../data/lexer
+touch ../data/lexer/.crawler
+printf 'http://cs50tse.cs.dartmouth.edu/tse/lexer.html\n0\n<html><head><style>p { color: red }</style><script>var hidden = "<b>";</script></head>\n<body><!-- hidden comment --><p>Caf&eacute; &amp; na\xc3\xafve&nbsp;cr&#xE8;me &#233;t&#233; \xe2\x80\x94 shown&copy;</p></body></html>\n' > ../data/lexer/1
+./indexer ../data/lexer ../data/lexerindex
+sort ../data/lexerindex
+
+### The checksums of the index from wikipedia at depth 1 and of the tables beside it (written last)
+cat ../data/wikipedia1index.crc
+
+### Truncating a copy of it and corrupting a byte of another (the querier should refuse both, naming the file)
+cp ../data/wikipedia1index ../data/wikipedia1short
+cp ../data/wikipedia1index.crc ../data/wikipedia1short.crc
+truncate -s -10 ../data/wikipedia1short
+echo "computer" | ../querier/querier ../data/wikipedia1 ../data/wikipedia1short
+echo "exit status $?"
+./indexer ../data/wikipedia1 ../data/wikipedia1flipped
+printf 'X' | dd of=../data/wikipedia1flipped.docs bs=1 seek=20 conv=notrunc 2>/dev/null
+echo "computer" | ../querier/querier ../data/wikipedia1 ../data/wikipedia1flipped
+echo "exit status $?"
+
+### Cutting the checksums short after their first line, leaving out the index, and leaving out a table
+### (the querier should refuse all three, naming index, index and docs: the first two leave out the index)
+./indexer ../data/wikipedia1 ../data/wikipedia1crc
+head -1 ../data/wikipedia1index.crc > ../data/wikipedia1crc.crc
+echo "computer" | ../querier/querier ../data/wikipedia1 ../data/wikipedia1crc
+echo "exit status $?"
+./indexer ../data/wikipedia1 ../data/wikipedia1crc
+grep -v '^index ' ../data/wikipedia1index.crc > ../data/wikipedia1crc.crc
+echo "computer" | ../querier/querier ../data/wikipedia1 ../data/wikipedia1crc
+echo "exit status $?"
+./indexer ../data/wikipedia1 ../data/wikipedia1crc
+grep -v '^docs ' ../data/wikipedia1crc.crc > ../data/wikipedia1crc.tmp && mv ../data/wikipedia1crc.tmp ../data/wikipedia1crc.crc
+echo "computer" | ../querier/querier ../data/wikipedia1 ../data/wikipedia1crc
+echo "exit status $?"
+
+### The checksums of the segment appended for letters at depth 10, then truncating a copy of the
+### index directory's segment (the querier should refuse it, naming index)
+ls ../data/letter10segments
+cp -r ../data/letter10segments ../data/letter10short
+truncate -s -10 ../data/letter10short/seg-1-*[0-9]
+echo "home" | ../querier/querier ../data/letters10 ../data/letter10short
+echo "exit status $?"
 
 # Run valgrind on both indexer and indextest for letters at depth 6
 mkdir ../data/valLetters6
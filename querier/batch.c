@@ -0,0 +1,159 @@
+/*
+ * batch.c - CS50 'batch' module
+ *
+ * see batch.h for more information.
+ *
+ * Cooper LaPorte, March 2023
+ */
+
+#define _POSIX_C_SOURCE 200809L   // open_memstream, sysconf
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "mem.h"
+#include "file.h"
+#include "batch.h"
+
+
+/**************** file-local constants ****************/
+static const int BATCH_WINDOW = 4096;       // queries of a batch answered but not yet printed, at most
+
+
+/**************** local types ****************/
+/* batch: the queries of a batch, shared by the threads answering them */
+typedef struct batch {
+  void* arg;
+  void (*queryfunc)(void* arg, char* line, FILE* fp);
+  FILE* in;                 // the queries, read by the threads one line at a time
+  char** results;           // results[i % BATCH_WINDOW], the answer of query i, NULL until answered
+  long read;                // queries read so far
+  long printed;             // queries printed so far
+  bool eof;                 // every query was read
+  pthread_mutex_t lock;     // guards all of the above but arg and queryfunc
+  pthread_cond_t answered;  // a result was put in results, or eof was set
+  pthread_cond_t room;      // a result was printed, so a query can be read
+} batch_t;
+
+
+static void* batch_work(void* arg);
+static char* batch_answer(batch_t* b, char* line);
+
+
+/**************** batch_run ****************/
+/* see batch.h for description
+ *
+ * the threads (batch_work) read the queries as they need them, and this thread
+ * prints the answers in order as they come in
+ */
+
+void
+batch_run(FILE* in, FILE* out, int threads, void* arg,
+          void (*queryfunc)(void* arg, char* line, FILE* fp)){
+  if(in == NULL || out == NULL || queryfunc == NULL){
+    return;
+  }
+  if(threads <= 0){
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 0 ? (int)cpus : 1;
+  }
+  batch_t b = { arg, queryfunc, in, NULL, 0, 0, false };
+  b.results = mem_calloc_assert(BATCH_WINDOW, sizeof(char*), "Error allocating memory");
+  pthread_mutex_init(&b.lock, NULL);
+  pthread_cond_init(&b.answered, NULL);
+  pthread_cond_init(&b.room, NULL);
+  pthread_t* workers = mem_malloc_assert(threads * sizeof(pthread_t), "Error allocating memory");
+  int started = 0;
+  for(int t = 0; t < threads; t++){
+    if(pthread_create(&workers[started], NULL, batch_work, &b) == 0){
+      started++;
+    }
+  }
+  if(started == 0){ // no threads to be had: answer the queries one at a time here
+    b.eof = true;
+    char* line;
+    while((line = file_readLine(in)) != NULL){
+      char* result = batch_answer(&b, line);
+      fputs(result, out);
+      free(result);   // allocated by open_memstream
+    }
+  }
+  // print the answers in order as they come in
+  pthread_mutex_lock(&b.lock);
+  while(true){
+    while(b.results[b.printed % BATCH_WINDOW] == NULL && !(b.eof && b.printed == b.read)){
+      pthread_cond_wait(&b.answered, &b.lock);
+    }
+    if(b.results[b.printed % BATCH_WINDOW] == NULL){ // every query is printed
+      break;
+    }
+    char* result = b.results[b.printed % BATCH_WINDOW];
+    b.results[b.printed % BATCH_WINDOW] = NULL;
+    b.printed++;
+    pthread_cond_broadcast(&b.room);
+    pthread_mutex_unlock(&b.lock);
+    fputs(result, out);
+    free(result);   // allocated by open_memstream
+    pthread_mutex_lock(&b.lock);
+  }
+  pthread_mutex_unlock(&b.lock);
+  for(int t = 0; t < started; t++){
+    pthread_join(workers[t], NULL);
+  }
+  mem_free(workers);
+  mem_free(b.results);
+  pthread_cond_destroy(&b.room);
+  pthread_cond_destroy(&b.answered);
+  pthread_mutex_destroy(&b.lock);
+}
+
+
+/**************** batch_work ****************/
+/* thread function: read the next query, answer it, and put the answer in its place in
+ * results, until there are no more queries; a thread waits to read while BATCH_WINDOW
+ * queries are waiting to be printed
+ */
+
+static void*
+batch_work(void* arg){
+  batch_t* b = arg;
+  pthread_mutex_lock(&b->lock);
+  while(true){
+    while(!b->eof && b->read - b->printed >= BATCH_WINDOW){
+      pthread_cond_wait(&b->room, &b->lock);
+    }
+    char* line = b->eof ? NULL : file_readLine(b->in);
+    if(line == NULL){
+      b->eof = true;
+      pthread_cond_broadcast(&b->answered);
+      pthread_cond_broadcast(&b->room);
+      break;
+    }
+    long i = b->read++;
+    pthread_mutex_unlock(&b->lock);
+    char* result = batch_answer(b, line);
+    pthread_mutex_lock(&b->lock);
+    b->results[i % BATCH_WINDOW] = result;
+    pthread_cond_broadcast(&b->answered);
+  }
+  pthread_mutex_unlock(&b->lock);
+  return NULL;
+}
+
+
+/**************** batch_answer ****************/
+/* Return what queryfunc writes for the query line, in memory; caller must free it
+ * with free() (queryfunc deletes the line)
+ */
+
+static char*
+batch_answer(batch_t* b, char* line){
+  char* result = NULL;
+  size_t size = 0;
+  FILE* fp = mem_assert(open_memstream(&result, &size), "Error allocating memory");
+  (*b->queryfunc)(b->arg, line, fp);
+  fclose(fp);
+  return result;
+}
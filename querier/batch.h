@@ -0,0 +1,37 @@
+/*
+ * batch.h - header file for the batch (query file) module
+ *
+ * answers the queries of a file, one per line, on a pool of threads that share
+ * whatever answers them (for the querier, the loaded index), and prints the
+ * answers in the order of the queries.  The threads read the queries as they
+ * need them, and an answer waits in memory until every query before it is
+ * printed; no more than BATCH_WINDOW (4096) queries are read ahead of the
+ * printing, so a file of millions of queries does not need memory for all of them.
+ *
+ * Cooper LaPorte March 2023
+ */
+
+#ifndef __BATCH_H
+#define __BATCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/**************** batch_run ****************/
+/* Answer the queries of a file on threads, and print the answers in order.
+ *
+ * Caller provides:
+ *   the file of queries and the file to print to, the number of threads (0 for one
+ *   per CPU), and queryfunc, which answers a query line (and deletes it), writing
+ *   the answer to fp, with its arg
+ * We do:
+ *   call queryfunc on each line of in, on the threads, and print what it wrote
+ *   for each line to out, in the order of the lines
+ * Notes:
+ *   queryfunc is called from several threads at once; if no thread can be
+ *   started, the queries are answered one at a time on the caller's thread
+ */
+void batch_run(FILE* in, FILE* out, int threads, void* arg,
+               void (*queryfunc)(void* arg, char* line, FILE* fp));
+
+#endif // __BATCH_H
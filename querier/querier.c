@@ -6,27 +6,63 @@
  * the score that document recived based on the given query
  *
  *
- * Usage: ./querier pageDirectory indexFilename
+ * Usage: ./querier [-b] [-k n] [-c megabytes] [-q queryFile | -s socketPath] [-t threads] pageDirectory indexFilename
  * where pageDirectory is an (existing) directory (prodcued by crawler) with a .crawler file in it
  * indexFilename is a readable file that should contain the index of produced by indexer on pageDirectory
+ * or an index directory of segments produced by indexer -a on pageDirectory
+ * -b ranks the documents with BM25 instead of by the counts of the words, using the
+ * document table the indexer writes beside the index (worked out from the index if there is none)
+ * -k n prints only the n best documents of each query, picked with a heap of n documents instead
+ * of sorting them all; with -b, a query is then scored a document at a time, skipping and
+ * pruning whole blocks of postings, or with 'or', the documents that cannot make the n best
+ * (see querytopk)
+ * -c megabytes keeps the results of the queries asked, up to that much memory, so a query asked
+ * again (with the words of each and sequence in any order) is printed without being evaluated;
+ * the least recently asked results are dropped to stay in the budget, and the hits and misses
+ * of the cache are printed to stderr at the end
+ * -q queryFile answers the queries of queryFile (- for standard input), one per line, on one thread
+ * per CPU (or -t threads), and prints the answers in the order of the queries, without prompts
+ * -s socketPath runs the querier as a server: the index is loaded once, and clients connecting
+ * to the Unix domain socket socketPath send queries a line at a time and get back each answer
+ * as its length in bytes on a line and then the answer (see server.h, and queryclient.c);
+ * the queries are answered on one thread per CPU (or -t threads) until SIGINT or SIGTERM
+ * if the indexer wrote a positional index (indexer -p) beside indexFilename, phrases can be queried
+ * the URLs of the results come from the URL table the indexer writes beside the index, so printing
+ * them reads no files (for an index without one, they are read from the pages in pageDirectory)
+ * if the indexer wrote checksums beside indexFilename (indexFilename.crc), the index and its tables
+ * are checked against them before they are loaded, and an index that was cut short or corrupted is refused
  * 
  * Query usage: word (operator) word (operator) word ...
  * where words are the words the user wants to appear in the printed documents
  * and operator can be either ['and', 'or', ' ']
+ * a word can also be a phrase in double quotes, "word word ...", matching documents with those words
+ * next to each other (words of 2 letters are not indexed, but still keep their place in the phrase)
+ * a word outside of a phrase can end in '*', word*, matching documents with any word that starts
+ * with word, as if those words were or'ed (and scored with -b as one term in all their documents),
+ * or in '~1' or '~2', word~1, matching documents with any word within 1 (or 2) edits of word the same way
  * using either of ['and', ' '] results in only documents where both words to the left and right appear
  * using 'or' results in documents where either of the left or right words appear
  * 
  * Exit with 0 means succesful
  * Exit with 1 means wrong number of inputs
  * Exit with 2 means wrong type of inputs or inputs out of range
+ * Exit with 3 means the index does not match its checksums
  *
  * Cooper LaPorte, Febuary 2023
  */
 
+#define _POSIX_C_SOURCE 200809L   // open_memstream, strtok_r
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include "mem.h"
+#include "memtag.h"
 #include "file.h"
 #include "counters.h"
 #include "hashtable.h"
@@ -34,61 +70,136 @@
 #include "webpage.h"
 #include "index.h"
 #include "word.h"
+#include "lexer.h"
 #include "set.h"
+#include "termindex.h"
+#include "docs.h"
+#include "bm25.h"
+#include "positions.h"
+#include "postings.h"
+#include "urls.h"
+#include "crc.h"
+#include "segment.h"
+#include "qcache.h"
+#include "batch.h"
+#include "server.h"
+
+
+
+/**************** file-local constants ****************/
+static const int EXPAND_TERMS = 10000;      // words a prefix (word*) or fuzzy term (word~1) expands to, at most
 
 
 
 /**************** local types ****************/
-typedef struct counterspair {
-    counters_t* ctrsA;
-    counters_t* orCtrs;
-} counterspair_t;
+/* queryopts: the options given before the arguments */
+typedef struct queryopts {
+    bool bm25;          // rank with BM25 (-b)
+    int topk;           // print only the best topk documents, 0 for all (-k)
+    size_t cache;       // bytes for the results of queries asked before, 0 for none (-c)
+    const char* batch;  // file of queries to answer on threads, "-" for stdin, or NULL (-q)
+    const char* socket; // Unix domain socket to answer queries on, or NULL (-s)
+    int threads;        // threads answering a batch or the server, 0 for one per CPU (-t)
+} queryopts_t;
 
-typedef struct intpair {
+/* queryindex: everything loaded to answer queries */
+typedef struct queryindex {
+    termindex_t* index;       // word -> postings of docID and count
+    bm25_t* bm;               // BM25 ranker (-b), or NULL
+    posindex_t* positions;    // positional index, or NULL if there is none
+    urlmap_t* urls;           // URL table, or NULL if there is none (URLs come from the page files)
+    int topk;                 // how many documents to print, 0 for all
+    qcache_t* cache;          // results of queries asked before (-c), or NULL
+} queryindex_t;
+
+/* queryjob: what the threads of a batch (-q) or the server (-s) answer queries from */
+typedef struct queryjob {
+    queryindex_t* qi;
+    const char* pageDirectory;
+} queryjob_t;
+
+/* docscore: a document and its BM25 score, for sorting the results */
+typedef struct docscore {
     int docID;
-    int score;
-} intpair_t;
+    double score;
+} docscore_t;
 
-/**************** counterspair_new ****************/
-/* Allocate and initialize a counterspair */
-static counterspair_t*
-counterspair_new(counters_t* ctrsA, counters_t* orCtrs)
-{
-  counterspair_t* pair = mem_malloc_assert(sizeof(counterspair_t), "Error allocating memory");
-  if (pair == NULL) {
-    return NULL;        // error allocating node
-  }
-  pair->ctrsA = ctrsA;
-  pair->orCtrs = orCtrs;
-  return pair;
-}
+/* andterm: a term of an and sequence and its postings, for pageplan */
+typedef struct andterm {
+    char* term;
+    postings_t* docs;         // its postings, NULL if no document has the term
+    bool owned;               // the postings were made for the query (a phrase)
+} andterm_t;
 
-/**************** intpair_new ****************/
-/* Allocate and initialize a intpair */
-static intpair_t*
-intpair_new(int docID, int score)
-{
-  intpair_t* pair = mem_malloc_assert(sizeof(intpair_t), "Error allocating memory");
-  if (pair == NULL) {
-    return NULL;        // error allocating node
-  }
-  pair->docID = docID;
-  pair->score = score;
-  return pair;
-}
+/* topterm: a term of an and sequence, for querytopk */
+typedef struct topterm {
+    postings_t* postings;     // its block postings
+    bool owned;               // the postings were made for the query (a phrase)
+    double idf;
+    int at;                   // the cursor: index of the current posting
+} topterm_t;
+
+/* topclause: an and sequence of a query with 'or', for topor */
+typedef struct topclause {
+    topterm_t* terms;         // its terms, in query order
+    int n;
+    int doc;                  // the docID its cursors are lined up on, INT_MAX past the last
+    double bound;             // the most a document can score from the sequence
+    double score;             // its score in the document being scored, 0 if it is not there
+} topclause_t;
 
+/* expandword: a word of the index that a prefix or fuzzy term expands to */
+typedef struct expandword {
+    int ordinal;
+    int edits;                // how far it is from the word of a fuzzy term (0 for a prefix term)
+} expandword_t;
 
+/* expansion: the words a prefix or fuzzy term expands to, for expandpostings */
+typedef struct expansion {
+    expandword_t* words;
+    int n;
+    int cap;
+} expansion_t;
 
-static void querier(const char* pageDirectory, hashtable_t* index);
-static counters_t* pageand(counters_t* ctrsA, counters_t* ctrsB, bool hasWord);
-static counters_t* pageor(counters_t* ctrsA, counters_t* ctrsB);
-static void pagerankprint(counters_t* ctrs, const char* pageDirectory);
-static void counters_and_helper(void* arg, const int key, int count);
-static void counters_or_helper(void* arg, const int key, int count);
-static void counters_maxscore_helper(void* arg, const int key, const int count);
-static char* normalize_line(char* line);
-static void counters_delete_helper(void* item);
-static void counters_copy_helper(void* arg, const int key, int count);
+static int parseOpts(const int argc, const char* argv[], queryopts_t* opts);
+static void indexVerify(const char* indexFilename);
+static void indexVerifyFile(void* arg, const char* indexFilename);
+static bm25_t* rankerLoad(termindex_t* index, const char* indexFilename);
+static void querier(const char* pageDirectory, queryindex_t* qi);
+static void queryline(char* line, queryindex_t* qi, const char* pageDirectory, FILE* fp);
+static void queryline_helper(void* arg, char* line, FILE* fp);
+static void batchline_helper(void* arg, char* line, FILE* fp);
+static void queryanswer(char* line, queryindex_t* qi, const char* pageDirectory, FILE* fp);
+static void queryrun(char* line, queryindex_t* qi, const char* pageDirectory, FILE* fp);
+static char* querykey(const char* line);
+static int term_cmp(const void* a, const void* b);
+static void querybm25(char* line, queryindex_t* qi, const char* pageDirectory, FILE* fp);
+static char* nextterm(char** rest);
+static postings_t* termpostings(queryindex_t* qi, char* term, bool* owned);
+static bool termexpands(const char* term);
+static postings_t* expandpostings(queryindex_t* qi, const char* term);
+static void expand_helper(void* arg, const int ordinal, const char* word, const int edits);
+static int expandword_cmp(const void* a, const void* b);
+static void querytopk(char* line, queryindex_t* qi, const char* pageDirectory, FILE* fp);
+static void topterms(char* line, queryindex_t* qi, topterm_t* terms, int* n, int* starts, int* m);
+static void topand(queryindex_t* qi, topterm_t* terms, const int n, docscore_t* heap, int* found, const int topk);
+static void topor(queryindex_t* qi, topterm_t* terms, const int* starts, const int m, docscore_t* heap, int* found, const int topk);
+static void topclause_seek(topclause_t* tc, int docID);
+static double topclause_score(queryindex_t* qi, topclause_t* tc);
+static int topclause_cmp(const void* a, const void* b);
+static void bm25rankprint(double* scores, const int maxDoc, const int topk, const char* pageDirectory, urlmap_t* urls, FILE* fp);
+static void docscoreprint(docscore_t* ranked, const int n, const int topk, const char* pageDirectory, urlmap_t* urls, FILE* fp);
+static int rankselect(docscore_t* ranked, const int n, const int topk);
+static void topk_push(docscore_t* heap, int* n, const int topk, docscore_t doc);
+static int docscore_cmp(const void* a, const void* b);
+static char* pageurl(const char* pageDirectory, urlmap_t* urls, const int docID);
+static postings_t* pageplan(queryindex_t* qi, andterm_t* terms, const int n, bool* owned);
+static int andterm_cmp(const void* a, const void* b);
+static postings_t* pageand(postings_t* docsA, const bool ownedA, postings_t* docsB, const bool ownedB);
+static postings_t* pageor(postings_t* total, postings_t* docsA, const bool ownedA);
+static void pagerankprint(postings_t* docs, const int topk, const char* pageDirectory, urlmap_t* urls, FILE* fp);
+static void pagerank_helper(void* arg, const int docID, const int count);
+static char* normalize_line(char* line, FILE* fp);
 
 
 /* ***************** main ********************** */
@@ -96,33 +207,51 @@ static void counters_copy_helper(void* arg, const int key, int count);
 int
 main(const int argc, const char* argv[])
 {
-if (argc == 3){
+memtag_atexit(); // report memory by subsystem at exit when TSE_MEMSTATS is set
+queryopts_t opts = { false, 0, 0, NULL, NULL, 0 };
+int arg = parseOpts(argc, argv, &opts); // index of the first argument after the options
+if (argc - arg == 2){
     // two arguments
-    if(pagedir_hasCrawler(argv[1])){
-      // since only indextest has the method to fill a hashtable from a file, we copy the base code for filling an index here
-      FILE* indexFilename = mem_assert(fopen(argv[2], "r"), "*** need to pass readable file for indexFilename");
-      hashtable_t* index = mem_assert(hashtable_new(file_numLines(indexFilename)), "Error allocating memory"); // size should be number of words/lines in index
-      char* line = NULL;
-      while((line = file_readLine(indexFilename)) != NULL){ // as long as there is another line in the file
-        char* word = strtok(line, " "); // take word from the line
-        char* docID = NULL;
-        char* count = NULL;
-        counters_t* ctrs = mem_assert(counters_new(), "Error allocating memory");
-        while((docID = strtok(NULL, " ")) != NULL){ // continue to take the docID and count pairs and add them to counters
-            count = strtok(NULL, " ");
-            if(!counters_set(ctrs, atoi(docID), atoi(count))){
-              mem_assert(NULL, "Error allocating memory");
-            }
-        }
-        if(!hashtable_insert(index, word, ctrs)){  // add to the hashtable to recreate the one from indexer
-          mem_assert(NULL, "Error allocating memory");
+    const char* pageDirectory = argv[arg];
+    const char* indexFilename = argv[arg + 1];
+    if(pagedir_hasCrawler(pageDirectory)){
+      // an index file, or an index directory (every live segment is loaded into the one index)
+      int listener = opts.socket == NULL ? -1 : server_listen(opts.socket); // clients wait while the index loads
+      indexVerify(indexFilename);
+      termindex_t* index = mem_assert(termindex_load(indexFilename), "*** need to pass readable file for indexFilename");
+      // Index has been created friom the indexFilename
+      queryindex_t qi = { index, NULL, NULL, NULL, opts.topk, qcache_new(opts.cache) };
+      if(opts.bm25){
+        qi.bm = rankerLoad(index, indexFilename);
+      }
+      char* posFile = positions_filename(indexFilename);
+      qi.positions = positions_load(posFile, termindex_numTerms(index) + 1); // NULL if there is no positional index
+      mem_free(posFile);
+      char* urlsFile = urls_filename(indexFilename);
+      qi.urls = urls_load(urlsFile); // NULL for an index from before URL tables
+      mem_free(urlsFile);
+      queryjob_t job = { &qi, pageDirectory };
+      if(opts.socket != NULL){
+        server_serve(listener, opts.threads, &job, queryline_helper);
+        close(listener);
+        unlink(opts.socket);
+      } else if(opts.batch == NULL){
+        querier(pageDirectory, &qi);
+      } else{
+        FILE* in = strcmp(opts.batch, "-") == 0 ? stdin : fopen(opts.batch, "r");
+        batch_run(in, stdout, opts.threads, &job, batchline_helper);
+        if(in != stdin){
+          fclose(in);
         }
-        mem_free(line);
       }
-      fclose(indexFilename);
-      // Index has been created friom the indexFilename
-      querier(argv[1], index);
-      hashtable_delete(index, counters_delete_helper);
+      if(qi.cache != NULL){
+        qcache_report(qi.cache, stderr, "query cache");
+        qcache_delete(qi.cache);
+      }
+      urls_unload(qi.urls);
+      bm25_delete(qi.bm);
+      positions_unload(qi.positions);
+      termindex_delete(index);
     } else{
       fprintf(stderr,"*** need to pass a valid path to a directory created by crawler\n");
       exit(2);
@@ -137,245 +266,1235 @@ exit(0);
 
 
 
+/* ****************** parseOpts ********************** */
+/*
+ * Takes the options at the front of the arguments given to querier.c and checks them
+ * -b asks for BM25 ranking
+ * -k n asks for only the best n documents of each query
+ * -c must be followed by a positive number of megabytes for the query cache
+ * -q must be followed by a readable file of queries (or - for standard input)
+ * -s must be followed by the pathname of a Unix domain socket, which cannot be an existing
+ * file other than a socket (a socket left from a server before is replaced)
+ * -t must be followed by a positive number of threads, and needs -q or -s
+ * returns the index in argv of the first argument that is not an option
+ */
+
+static int
+parseOpts(const int argc, const char* argv[], queryopts_t* opts){
+  int arg = 1;
+  while(arg < argc && argv[arg][0] == '-'){
+    if(strcmp(argv[arg], "-b") == 0){
+      opts->bm25 = true;
+      arg++;
+    } else if(strcmp(argv[arg], "-k") == 0){
+      char* end = NULL;
+      long topk = arg + 1 < argc ? strtol(argv[arg + 1], &end, 10) : 0;
+      if(end == NULL || end == argv[arg + 1] || *end != '\0' || topk <= 0 || topk > 1000000){
+        fprintf(stderr,"*** -k needs a number of documents from 1 to 1000000\n");
+        exit(2);
+      }
+      opts->topk = topk;
+      arg += 2;
+    } else if(strcmp(argv[arg], "-c") == 0 && arg + 1 < argc){
+      int megabytes = atoi(argv[arg + 1]);
+      if(megabytes <= 0){
+        fprintf(stderr,"*** need to pass a positive integer number of megabytes for -c\n");
+        exit(2);
+      }
+      opts->cache = (size_t)megabytes << 20;
+      arg += 2;
+    } else if(strcmp(argv[arg], "-q") == 0 && arg + 1 < argc){
+      FILE* fp = strcmp(argv[arg + 1], "-") == 0 ? stdin : fopen(argv[arg + 1], "r");
+      if(fp == NULL){
+        fprintf(stderr,"*** need to pass a readable file of queries for -q\n");
+        exit(2);
+      }
+      if(fp != stdin){
+        fclose(fp);
+      }
+      opts->batch = argv[arg + 1];
+      arg += 2;
+    } else if(strcmp(argv[arg], "-s") == 0 && arg + 1 < argc){
+      struct stat st;
+      if(strlen(argv[arg + 1]) >= sizeof(((struct sockaddr_un*)NULL)->sun_path)
+         || (stat(argv[arg + 1], &st) == 0 && !S_ISSOCK(st.st_mode))){
+        fprintf(stderr,"*** need to pass a pathname for the socket that is not an existing file for -s\n");
+        exit(2);
+      }
+      opts->socket = argv[arg + 1];
+      arg += 2;
+    } else if(strcmp(argv[arg], "-t") == 0 && arg + 1 < argc){
+      opts->threads = atoi(argv[arg + 1]);
+      if(opts->threads <= 0){
+        fprintf(stderr,"*** need to pass a positive integer number of threads for -t\n");
+        exit(2);
+      }
+      arg += 2;
+    } else{
+      fprintf(stderr,"*** unknown option %s\n", argv[arg]);
+      exit(2);
+    }
+  }
+  if(opts->batch != NULL && opts->socket != NULL){
+    fprintf(stderr,"*** -q and -s cannot be given together\n");
+    exit(2);
+  }
+  if(opts->threads > 0 && opts->batch == NULL && opts->socket == NULL){
+    fprintf(stderr,"*** -t needs a file of queries (-q) or a socket (-s)\n");
+    exit(2);
+  }
+  return arg;
+}
+
+
+
+/* ****************** indexVerify ********************** */
+/*
+ * Check the index file and the tables beside it against the checksums the indexer wrote,
+ * before any of them is loaded, or for an index directory, each of its live segments;
+ * exits if one does not match, or the checksums are malformed or leave out a table there is
+ */
+
+static void
+indexVerify(const char* indexFilename){
+  if(segment_isIndexDir(indexFilename)){
+    segment_iterate(indexFilename, NULL, indexVerifyFile);
+  } else{
+    indexVerifyFile(NULL, indexFilename);
+  }
+}
+
+
+/* ****************** indexVerifyFile ********************** */
+/*
+ * Check one index file (or segment) against its checksums and exit if it does not match;
+ * a missing file is left for the loading to report, and a file without checksums (from
+ * an older indexer) is loaded with a warning
+ */
+
+static void
+indexVerifyFile(void* arg, const char* indexFilename){
+  if(access(indexFilename, F_OK) != 0){
+    return;
+  }
+  char* crcFile = crc_filename(indexFilename);
+  const char* bad = NULL;
+  if(access(crcFile, F_OK) != 0){
+    fprintf(stderr,"*** index %s has no checksums (%s): loading it unchecked\n", indexFilename, crcFile);
+  } else if(!crc_verify(indexFilename, crcFile, &bad)){
+    fprintf(stderr,"*** index %s does not match its checksums (%s): cut short or corrupted\n", indexFilename, bad);
+    exit(3);
+  }
+  mem_free(crcFile);
+}
+
+
+/* ****************** rankerLoad ********************** */
+/*
+ * Make the BM25 ranker for the index, from the document table beside indexFilename
+ * or, for an index written before there were document tables, from the index itself;
+ * for a pruned index, the idf of each word comes from the document frequency table beside it
+ */
+
+static bm25_t*
+rankerLoad(termindex_t* index, const char* indexFilename){
+  char* docsFile = docs_filename(indexFilename);
+  docs_t* docs = docs_load(docsFile);
+  mem_free(docsFile);
+  if(docs == NULL){
+    docs = docs_fromIndex(index);
+  }
+  bm25_t* bm = mem_assert(bm25_new(index, docs), "Error allocating memory");
+  docs_delete(docs);
+  char* dfFile = bm25_dfFilename(indexFilename);
+  bm25_loadDf(bm, dfFile); // a pruned index: its words keep the idf they had before pruning
+  mem_free(dfFile);
+  return bm;
+}
+
+
+
 /* ****************** querier ********************** */
 /*
  * read form standard input queries from the user until the EOF
- * parse the queries and call pageand and pageor until the the whole query has been scanned
- * print out the information on the documents that resulted due to the query
- * 
+ * print out the information on the documents that resulted due to each query (queryanswer)
  */
 
 static void
-querier(const char* pageDirectory, hashtable_t* index){
+querier(const char* pageDirectory, queryindex_t* qi){
   while(!feof(stdin)){
-    char* line;
     printf("\nWhat is your query: ");
-    if((line = normalize_line(file_readLine(stdin))) != NULL){ // gets the line and checks if it isnt null
-      printf("Query: %s\n", line);    // print the cleaned up query
-      counters_t* total = mem_assert(counters_new(), "Error allocating memory"); // create a counters to keep track of all valid documents
-      char* word = strtok(line, " "); // take word from the line
-      counters_t* wordA = hashtable_find(index, word); // set wordA to the counters of the first word
-      bool hasWord = true; // way to keep track if wordA is a counters in the index or a diferent one for memory cleaning purposes
-      if(wordA == NULL){ // word is not in the index
-        hasWord = false;
-        wordA = mem_assert(counters_new(), "Error allocating memory");
+    queryline(file_readLine(stdin), qi, pageDirectory, stdout);
+  }
+}
+
+
+
+/* ****************** queryline ********************** */
+/*
+ * normalize the query line and print to fp the normalized query and its answer (queryanswer),
+ * or the message for a bad or empty query; nothing for a NULL line (the end of the queries)
+ * NOTE:
+ *      deletes the given string
+ */
+
+static void
+queryline(char* line, queryindex_t* qi, const char* pageDirectory, FILE* fp){
+  if((line = normalize_line(line, fp)) != NULL){ // gets the line and checks if it isnt null
+    fprintf(fp, "Query: %s\n", line);    // print the cleaned up query
+    queryanswer(line, qi, pageDirectory, fp);
+    mem_free(line);
+  }
+}
+
+
+
+/* ****************** queryline_helper ********************** */
+/*
+ * Helper function for the server (server_serve) to answer a query line of a client:
+ * what querier prints after its prompt (queryline), from the queryjob_t given as arg
+ * NOTE:
+ *      deletes the given string; called from several threads at once
+ */
+
+static void
+queryline_helper(void* arg, char* line, FILE* fp){
+  queryjob_t* job = arg;
+  queryline(line, job->qi, job->pageDirectory, fp);
+}
+
+
+
+/* ****************** batchline_helper ********************** */
+/*
+ * Helper function for a batch (batch_run) to answer a query line of the file: what
+ * querier prints for it without the prompt, a blank line and then queryline
+ * NOTE:
+ *      deletes the given string; called from several threads at once
+ */
+
+static void
+batchline_helper(void* arg, char* line, FILE* fp){
+  fprintf(fp, "\n");
+  queryline_helper(arg, line, fp);
+}
+
+
+
+/* ****************** queryanswer ********************** */
+/*
+ * print to fp the documents that result from the (normalized) query line
+ * with a cache, the result is looked up under the canonical form of the query (querykey)
+ * and printed from there if the query was asked before; otherwise the query is evaluated
+ * into memory (queryrun), printed, and kept in the cache
+ */
+
+static void
+queryanswer(char* line, queryindex_t* qi, const char* pageDirectory, FILE* fp){
+  if(qi->cache == NULL){
+    queryrun(line, qi, pageDirectory, fp);
+    return;
+  }
+  char* key = querykey(line);
+  char* cached = qcache_get(qi->cache, key);
+  if(cached != NULL){
+    fputs(cached, fp);
+    mem_free(cached);
+  } else{
+    char* result = NULL;
+    size_t size = 0;
+    FILE* mem = mem_assert(open_memstream(&result, &size), "Error allocating memory");
+    queryrun(line, qi, pageDirectory, mem);
+    fclose(mem);
+    qcache_put(qi->cache, key, result);
+    fputs(result, fp);
+    free(result);   // allocated by open_memstream
+  }
+  mem_free(key);
+}
+
+
+
+/* ****************** queryrun ********************** */
+/*
+ * evaluate the (normalized) query line and print the ranked documents to fp
+ * parse the query into and sequences, find the documents of each with pageplan, and put
+ * them together with pageor until the the whole query has been scanned
+ * the documents of each term are its block postings (sorted arrays of docID and count)
+ * when given a BM25 ranker the query is scored by querybm25 instead
+ * NOTE:
+ *      the terms of line are cut apart in place
+ */
+
+static void
+queryrun(char* line, queryindex_t* qi, const char* pageDirectory, FILE* fp){
+  if(qi->bm != NULL){
+    querybm25(line, qi, pageDirectory, fp);
+    return;
+  }
+  postings_t* total = NULL; // the documents of the and sequences so far, NULL before the first ends
+  andterm_t* terms = memtag_malloc(MEMTAG_QUERY, (strlen(line) / 2 + 1) * sizeof(andterm_t), "Error allocating memory");
+  int n = 0; // the terms of the and sequence so far
+  char* rest = line;
+  while(true){
+    char* term = nextterm(&rest); // continue to take the next term (word or phrase) until no more terms
+    if(term == NULL || strcmp(term, "or") == 0){ // end of the and sequence
+      bool owned;
+      postings_t* docs = pageplan(qi, terms, n, &owned); // the documents with every term of the sequence
+      total = pageor(total, docs, owned); // puts information from the sequence into total
+      n = 0;
+      if(term == NULL){
+        break;
       }
-      while((word = strtok(NULL, " ")) != NULL){ // continue to take the next word until no more words
-        if(wordA == NULL){
-          hasWord = true;
-          if((wordA = hashtable_find(index, word)) == NULL){ // if the word isnt in the set
-            hasWord = false;
-            wordA = mem_assert(counters_new(), "Error allocating memory");
-          }
+    } else if(strcmp(term, "and") != 0){ // term is not an opperator
+      terms[n++].term = term;
+    }
+  }
+  memtag_free(terms);
+  pagerankprint(total, qi->topk, pageDirectory, qi->urls, fp); // print the ranked list of information and delete total
+}
+
+
+
+/* ****************** querykey ********************** */
+/*
+ * returns the canonical form of a (normalized) query line, the key of its result in the cache:
+ * the terms of each and sequence sorted, without 'and', and the sequences joined by 'or',
+ * so "dog and cat or fish" and "cat dog or fish" have the same key; caller must free it
+ */
+
+static char*
+querykey(const char* line){
+  char* copy = mem_malloc_assert(strlen(line) + 1, "Error allocating memory");
+  strcpy(copy, line);
+  char* key = mem_malloc_assert(strlen(line) + 1, "Error allocating memory");
+  key[0] = '\0';
+  char** terms = mem_malloc_assert((strlen(line) / 2 + 1) * sizeof(char*), "Error allocating memory");
+  int n = 0;
+  char* rest = copy;
+  while(true){
+    char* term = nextterm(&rest);
+    if(term == NULL || strcmp(term, "or") == 0){ // end of an and sequence
+      qsort(terms, n, sizeof(char*), term_cmp);
+      if(key[0] != '\0'){
+        strcat(key, " or");
+      }
+      for(int t = 0; t < n; t++){
+        if(key[0] != '\0'){
+          strcat(key, " ");
         }
-        if(strcmp(word, "or") == 0){ // word after wordA is or
-          total = pageor(total, wordA); // puts information from wordA into total
-          if(!hasWord){
-            counters_delete(wordA);
-          }
-          wordA = NULL;
-        } else if(strcmp(word, "and") != 0){ // word after wordA is not an opperator
-          if(hashtable_find(index, word) != NULL){ // if the word is in the index
-            wordA = pageand(wordA, hashtable_find(index, word), hasWord);
-            hasWord = false;
-          } else{ // if not in the index, there will be no results in the and chain, clean up
-            if(!hasWord){
-              counters_delete(wordA);
-            }
-            wordA = mem_assert(counters_new(), "Error allocating memory");
-            hasWord = false;
-          }
+        strcat(key, terms[t]);
+      }
+      n = 0;
+      if(term == NULL){
+        break;
+      }
+    } else if(strcmp(term, "and") != 0){
+      terms[n++] = term;
+    }
+  }
+  mem_free(terms);
+  mem_free(copy);
+  return key;
+}
+
+
+
+/* ****************** term_cmp ********************** */
+/*
+ * Helper function for qsort to order terms (char*) as strcmp does
+ */
+
+static int
+term_cmp(const void* a, const void* b){
+  return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+
+
+/* ****************** querybm25 ********************** */
+/*
+ * score the (normalized) query line with BM25 and print the ranked documents
+ * the scores of the terms of an and sequence are added up in group, with hits counting
+ * how many of the terms each document has; at the end of the sequence the documents
+ * that have every term add the group score to their total (so 'or' sums sequences)
+ * the arrays are indexed by docID, so each posting costs one multiply-add
+ */
+
+static void
+querybm25(char* line, queryindex_t* qi, const char* pageDirectory, FILE* fp){
+  if(qi->topk > 0){
+    querytopk(line, qi, pageDirectory, fp);
+    return;
+  }
+  int maxDoc = bm25_maxDoc(qi->bm);
+  double* total = memtag_calloc(MEMTAG_QUERY, maxDoc + 1, sizeof(double), "Error allocating memory");
+  double* group = memtag_calloc(MEMTAG_QUERY, maxDoc + 1, sizeof(double), "Error allocating memory");
+  int* hits = memtag_calloc(MEMTAG_QUERY, maxDoc + 1, sizeof(int), "Error allocating memory");
+  int terms = 0;          // terms in the current and sequence
+  bool missing = false;   // a term of the current and sequence is in no document
+  char* rest = line;
+  char* term = nextterm(&rest);
+  while(true){
+    if(term == NULL || strcmp(term, "or") == 0){ // end of an and sequence
+      for(int docID = 1; docID <= maxDoc; docID++){
+        if(!missing && hits[docID] == terms){
+          total[docID] += group[docID];
+        }
+        group[docID] = 0;
+        hits[docID] = 0;
+      }
+      terms = 0;
+      missing = false;
+      if(term == NULL){
+        break;
+      }
+    } else if(strcmp(term, "and") != 0){
+      terms++;
+      bool owned;
+      postings_t* postings = missing ? NULL : termpostings(qi, term, &owned);
+      if(postings == NULL){ // no document can have the whole sequence
+        missing = true;
+      } else{ // a prefix or fuzzy term is scored as one term, by the documents of all its words
+        double idf = termexpands(term) ? bm25_dfIdf(qi->bm, postings_size(postings)) : bm25_idf(qi->bm, term, postings);
+        bm25_accumulate(qi->bm, idf, postings, group, hits);
+        if(owned){
+          postings_delete(postings);
+        }
+      }
+    }
+    term = nextterm(&rest);
+  }
+  memtag_free(group);
+  memtag_free(hits);
+  bm25rankprint(total, maxDoc, qi->topk, pageDirectory, qi->urls, fp);
+}
+
+
+
+/* ****************** querytopk ********************** */
+/*
+ * score a query with BM25 a document at a time, keeping only the best qi->topk
+ * documents in a heap, and print them
+ * a query of one and sequence is scored by topand, and a query with 'or' by topor
+ */
+
+static void
+querytopk(char* line, queryindex_t* qi, const char* pageDirectory, FILE* fp){
+  char* copy = mem_malloc_assert(strlen(line) + 1, "Error allocating memory");
+  strcpy(copy, line);
+  topterm_t* terms = memtag_malloc(MEMTAG_QUERY, (strlen(line) / 2 + 1) * sizeof(topterm_t), "Error allocating memory");
+  int* starts = memtag_malloc(MEMTAG_QUERY, (strlen(line) / 2 + 2) * sizeof(int), "Error allocating memory");
+  int n = 0;
+  int m = 0;
+  topterms(copy, qi, terms, &n, starts, &m);
+  mem_free(copy);
+  int topk = qi->topk < bm25_maxDoc(qi->bm) ? qi->topk : bm25_maxDoc(qi->bm); // no more documents than that
+  docscore_t* heap = memtag_malloc(MEMTAG_QUERY, (topk + 1) * sizeof(docscore_t), "Error allocating memory");
+  int found = 0;
+  if(m == 1){
+    topand(qi, terms, n, heap, &found, topk);
+  } else{
+    topor(qi, terms, starts, m, heap, &found, topk);
+  }
+  for(int t = 0; t < n; t++){
+    if(terms[t].owned){
+      postings_delete(terms[t].postings);
+    }
+  }
+  memtag_free(terms);
+  memtag_free(starts);
+  docscoreprint(heap, found, qi->topk, pageDirectory, qi->urls, fp);
+}
+
+
+
+/* ****************** topterms ********************** */
+/*
+ * Helper function for querytopk to find the block postings and idf of each term of a
+ * (copy of a normalized) query line, into terms[0..*n); a term in no document has NULL postings
+ * words use the block postings of the index; a phrase, prefix or fuzzy term gets block postings of its own
+ * the and sequences of the query are terms[starts[s]..starts[s + 1]) for s in [0..*m)
+ */
+
+static void
+topterms(char* line, queryindex_t* qi, topterm_t* terms, int* n, int* starts, int* m){
+  char* rest = line;
+  char* term;
+  *n = 0;
+  *m = 0;
+  starts[(*m)++] = 0;
+  while((term = nextterm(&rest)) != NULL){
+    if(strcmp(term, "or") == 0){
+      starts[(*m)++] = *n;
+      continue;
+    }
+    if(strcmp(term, "and") == 0){
+      continue;
+    }
+    topterm_t* tt = &terms[(*n)++];
+    tt->at = 0;
+    tt->owned = false;
+    tt->postings = NULL;
+    tt->idf = 0;
+    tt->postings = termpostings(qi, term, &tt->owned);
+    if(termexpands(term)){ // scored as one term, by the documents of all its words
+      tt->idf = bm25_dfIdf(qi->bm, postings_size(tt->postings));
+    } else{
+      tt->idf = bm25_idf(qi->bm, term, tt->postings);
+    }
+  }
+  starts[*m] = *n;
+}
+
+
+
+/* ****************** topand ********************** */
+/*
+ * Helper function for querytopk to score a query of one and sequence, the n terms,
+ * into the heap of the best topk documents (*found of them)
+ * the cursors of the terms move together through their block postings, the term
+ * with the fewest postings leading; a seek for a docID steps over every block
+ * whose last docID is before it, and once the heap is full, a candidate whose
+ * blocks cannot add up to more than the worst score in the heap (by the largest
+ * count of each block) is skipped along with the rest of those blocks
+ */
+
+static void
+topand(queryindex_t* qi, topterm_t* terms, const int n, docscore_t* heap, int* found, const int topk){
+  int lead = 0; // the term with the fewest postings
+  bool empty = n == 0;
+  for(int t = 0; t < n; t++){
+    empty = empty || terms[t].postings == NULL;
+    if(!empty && postings_size(terms[t].postings) < postings_size(terms[lead].postings)){
+      lead = t;
+    }
+  }
+  postings_t* leader = empty ? NULL : terms[lead].postings;
+  while(!empty && terms[lead].at < postings_size(leader)){
+    // line every cursor up on the docID of the leader, or find that it is missing
+    int docID = postings_doc(leader, terms[lead].at);
+    bool aligned = true;
+    for(int t = 0; t < n && aligned; t++){
+      terms[t].at = postings_seek(terms[t].postings, terms[t].at, docID);
+      if(terms[t].at == postings_size(terms[t].postings)){
+        empty = true; // no more documents have this term
+        aligned = false;
+      } else if(postings_doc(terms[t].postings, terms[t].at) > docID){
+        terms[lead].at = postings_seek(leader, terms[lead].at, postings_doc(terms[t].postings, terms[t].at));
+        aligned = false;
+      }
+    }
+    if(!aligned){
+      continue;
+    }
+    if(*found == topk){ // could the blocks beat the worst of the best so far?
+      double bound = 0;
+      int blockEnd = postings_blockLast(leader, terms[lead].at);
+      for(int t = 0; t < n; t++){
+        bound += bm25_bound(qi->bm, terms[t].idf, postings_blockMax(terms[t].postings, terms[t].at));
+        int last = postings_blockLast(terms[t].postings, terms[t].at);
+        if(last < blockEnd){
+          blockEnd = last;
         }
       }
-      total = pageor(total, wordA); // puts information from wordA into total
-      if(!hasWord){
-        counters_delete(wordA);
+      if(bound < heap[0].score){ // no document up to the end of the first block to end can
+        terms[lead].at = postings_seek(leader, terms[lead].at, blockEnd + 1);
+        continue;
       }
-      pagerankprint(total, pageDirectory); // print the ranked list of information and delete total
-      mem_free(line);
     }
+    double score = 0;
+    for(int t = 0; t < n; t++){ // in query order, adding up as querybm25 does
+      score += bm25_score(qi->bm, terms[t].idf, docID, postings_count(terms[t].postings, terms[t].at));
+    }
+    if(score > 0){
+      docscore_t doc = { docID, score };
+      topk_push(heap, found, topk, doc);
+    }
+    terms[lead].at++;
   }
 }
 
 
 
+/* ****************** topor ********************** */
+/*
+ * Helper function for querytopk to score a query with 'or', the m and sequences of
+ * terms starting at starts, into the heap of the best topk documents (*found of them),
+ * by MaxScore: each sequence has a bound, the sum of the largest score of each of its
+ * terms (by its largest count), and the sequences are ordered by their bounds
+ * once the heap is full, the sequences with the smallest bounds, as many as add up to
+ * less than the worst score in the heap, cannot put a document in the heap by themselves,
+ * so only the documents of the others are candidates; the sequences left out are looked
+ * up for a candidate from the largest bound down, and the candidate is dropped as soon
+ * as what it has plus what it could still get cannot beat the worst score in the heap
+ * the score of a document is added up in query order, as querybm25 does
+ */
+
+static void
+topor(queryindex_t* qi, topterm_t* terms, const int* starts, const int m, docscore_t* heap, int* found, const int topk){
+  topclause_t* clauses = memtag_malloc(MEMTAG_QUERY, m * sizeof(topclause_t), "Error allocating memory");
+  topclause_t** order = memtag_malloc(MEMTAG_QUERY, m * sizeof(topclause_t*), "Error allocating memory");
+  double* below = memtag_malloc(MEMTAG_QUERY, (m + 1) * sizeof(double), "Error allocating memory");
+  for(int s = 0; s < m; s++){
+    topclause_t* tc = &clauses[s];
+    tc->terms = &terms[starts[s]];
+    tc->n = starts[s + 1] - starts[s];
+    tc->bound = 0;
+    for(int t = 0; t < tc->n; t++){
+      tc->bound += bm25_bound(qi->bm, tc->terms[t].idf, postings_maxCount(tc->terms[t].postings));
+    }
+    tc->doc = -1;
+    topclause_seek(tc, 0);
+    order[s] = tc;
+  }
+  qsort(order, m, sizeof(topclause_t*), topclause_cmp); // smallest bound first
+  below[0] = 0;
+  for(int s = 0; s < m; s++){
+    below[s + 1] = below[s] + order[s]->bound; // the most from order[0..s]
+  }
+  int first = 0; // the sequences before order[first] are left out
+  while(true){
+    while(*found == topk && first < m && below[first + 1] < heap[0].score){
+      first++;
+    }
+    int docID = INT_MAX; // the next candidate
+    for(int s = first; s < m; s++){
+      if(order[s]->doc < docID){
+        docID = order[s]->doc;
+      }
+    }
+    if(docID == INT_MAX){
+      break;
+    }
+    double bound = below[first]; // what the candidate has, plus what it could still get
+    for(int s = first; s < m; s++){
+      order[s]->score = order[s]->doc == docID ? topclause_score(qi, order[s]) : 0;
+      bound += order[s]->score;
+    }
+    for(int s = first - 1; s >= 0 && bound >= heap[0].score; s--){
+      bound -= order[s]->bound;
+      topclause_seek(order[s], docID);
+      order[s]->score = order[s]->doc == docID ? topclause_score(qi, order[s]) : 0;
+      bound += order[s]->score;
+    }
+    if(first == 0 || bound >= heap[0].score){ // every sequence was scored
+      double score = 0;
+      for(int s = 0; s < m; s++){ // in query order
+        score += clauses[s].score;
+      }
+      if(score > 0){
+        docscore_t doc = { docID, score };
+        topk_push(heap, found, topk, doc);
+      }
+    }
+    for(int s = first; s < m; s++){
+      if(order[s]->doc == docID){
+        topclause_seek(order[s], docID + 1);
+      }
+    }
+  }
+  memtag_free(clauses);
+  memtag_free(order);
+  memtag_free(below);
+}
+
+
+
+/* ****************** topclause_seek ********************** */
+/*
+ * Helper function for topor to move the cursors of an and sequence to the first docID
+ * at or after docID that all of its terms have (tc->doc), or past the end (INT_MAX)
+ */
+
+static void
+topclause_seek(topclause_t* tc, int docID){
+  if(tc->doc >= docID){
+    return;
+  }
+  bool aligned = false;
+  while(!aligned){
+    aligned = true;
+    for(int t = 0; t < tc->n; t++){
+      topterm_t* tt = &tc->terms[t];
+      tt->at = postings_seek(tt->postings, tt->at, docID);
+      if(tt->at == postings_size(tt->postings)){
+        tc->doc = INT_MAX; // no more documents have this term
+        return;
+      }
+      if(postings_doc(tt->postings, tt->at) > docID){
+        docID = postings_doc(tt->postings, tt->at);
+        aligned = false;
+      }
+    }
+  }
+  tc->doc = docID;
+}
+
+
+
+/* ****************** topclause_score ********************** */
+/*
+ * Helper function for topor to score the document an and sequence is lined up on,
+ * adding up its terms in query order, as querybm25 does
+ */
+
+static double
+topclause_score(queryindex_t* qi, topclause_t* tc){
+  double score = 0;
+  for(int t = 0; t < tc->n; t++){
+    topterm_t* tt = &tc->terms[t];
+    score += bm25_score(qi->bm, tt->idf, tc->doc, postings_count(tt->postings, tt->at));
+  }
+  return score;
+}
+
+
+
+/* ****************** topclause_cmp ********************** */
+/*
+ * Helper function for qsort to order and sequences by increasing bound
+ */
+
+static int
+topclause_cmp(const void* a, const void* b){
+  double boundA = (*(topclause_t* const*)a)->bound;
+  double boundB = (*(topclause_t* const*)b)->bound;
+  return boundA < boundB ? -1 : boundA > boundB ? 1 : 0;
+}
+
+
+
+/* ****************** nextterm ********************** */
+/*
+ * Helper function to take the next term from a normalized query line, like strtok:
+ * a word, or a whole phrase with its quotes; *rest is moved past the term
+ * returns NULL when there are no more terms
+ */
+
+static char*
+nextterm(char** rest){
+  char* term = *rest;
+  while(*term == ' '){
+    term++;
+  }
+  if(*term == '\0'){
+    return NULL;
+  }
+  char* end = term;
+  if(*term == '"'){ // a phrase runs to its closing quote (normalize_line made sure there is one)
+    end = strchr(term + 1, '"') + 1;
+  } else{
+    while(*end != '\0' && *end != ' '){
+      end++;
+    }
+  }
+  if(*end != '\0'){
+    *end++ = '\0';
+  }
+  *rest = end;
+  return term;
+}
+
+
+
+/* ****************** termpostings ********************** */
+/*
+ * Helper function to find the postings (sorted arrays of docID and count) of a term
+ * for a word, its postings in the index (*owned is false)
+ * for a phrase, new postings of docID -> times the phrase occurs, from the positional
+ * index (*owned is true, so the caller must delete them); the words of 2 letters or less
+ * are not in the index, so they are skipped, keeping their place
+ * for a prefix or fuzzy term, new postings of its words (see expandpostings; *owned is true)
+ * returns NULL if no document has the term (or a phrase is asked without a positional index)
+ */
+
+static postings_t*
+termpostings(queryindex_t* qi, char* term, bool* owned){
+  *owned = false;
+  if(termexpands(term)){
+    *owned = true;
+    return expandpostings(qi, term);
+  }
+  if(term[0] != '"'){
+    return termindex_find(qi->index, term);
+  }
+  int n = 0;
+  int place = 0;
+  char* save = NULL;
+  const char** words = mem_malloc_assert(strlen(term) * sizeof(char*), "Error allocating memory");
+  int* offsets = mem_malloc_assert(strlen(term) * sizeof(int), "Error allocating memory");
+  char* phrase = mem_malloc_assert(strlen(term) + 1, "Error allocating memory");
+  strcpy(phrase, term + 1);
+  phrase[strlen(phrase) - 1] = '\0'; // drop the quotes
+  for(char* word = strtok_r(phrase, " ", &save); word != NULL; word = strtok_r(NULL, " ", &save)){
+    if(strlen(word) > 2){
+      words[n] = word;
+      offsets[n] = place;
+      n++;
+    }
+    place++;
+  }
+  postings_t* docs = NULL;
+  if(n == 1){ // one indexed word: the phrase is in every document the word is in
+    docs = termindex_find(qi->index, words[0]);
+  } else if(n > 1){
+    if(qi->positions == NULL){
+      fprintf(stderr, "*** phrase queries need a positional index (indexer -p)\n");
+    }
+    counters_t* ctrs = positions_phrase(qi->positions, words, offsets, n);
+    if(ctrs != NULL){
+      docs = postings_new(ctrs, NULL, 0);
+      *owned = true;
+      counters_delete(ctrs);
+    }
+  }
+  mem_free(words);
+  mem_free(offsets);
+  mem_free(phrase);
+  return docs;
+}
+
+
+
+/* ****************** termexpands ********************** */
+/*
+ * Helper function to tell whether a term of a normalized query line expands to words of
+ * the index: a prefix term, word*, or a fuzzy term, word~1 or word~2 (normalize_line lets
+ * those end only a word outside of phrases)
+ */
+
+static bool
+termexpands(const char* term){
+  size_t len = strlen(term);
+  return term[len - 1] == '*' || (len > 2 && term[len - 2] == '~');
+}
+
+
+
+/* ****************** expandpostings ********************** */
+/*
+ * Helper function to find the postings of a prefix or fuzzy term: the documents of every
+ * word of the index it expands to, with the sum of their counts, as if the words were or'ed
+ * for word*, the words that start with word, a range of the sorted dictionary (termindex_prefix)
+ * for word~1 or word~2, the words within 1 or 2 edits of word (termindex_fuzzy, which walks
+ * the dictionary with a Levenshtein automaton instead of comparing word with every word)
+ * their postings are merged in one pass (postings_merge); a term of more than
+ * EXPAND_TERMS words is cut to EXPAND_TERMS of them (the first for a prefix, the closest for
+ * a fuzzy term), with a note on stderr
+ * returns new postings (the caller must delete them), or NULL if the term has no words
+ */
+
+static postings_t*
+expandpostings(queryindex_t* qi, const char* term){
+  size_t len = strlen(term);
+  int maxEdits = term[len - 1] == '*' ? -1 : term[len - 1] - '0'; // -1 for a prefix term
+  len -= maxEdits < 0 ? 1 : 2; // without the '*' or '~n'
+  char* word = mem_malloc_assert(len + 1, "Error allocating memory");
+  memcpy(word, term, len);
+  word[len] = '\0';
+  expansion_t words = { NULL, 0, 0 };
+  int matched;
+  if(maxEdits < 0){
+    int end;
+    int first = termindex_prefix(qi->index, word, &end);
+    matched = end - first;
+    for(int ordinal = first; ordinal < end && ordinal - first < EXPAND_TERMS; ordinal++){
+      expand_helper(&words, ordinal, NULL, 0);
+    }
+  } else{
+    termindex_fuzzy(qi->index, word, maxEdits, &words, expand_helper);
+    matched = words.n;
+    if(matched > EXPAND_TERMS){ // keep the closest
+      qsort(words.words, words.n, sizeof(expandword_t), expandword_cmp);
+    }
+  }
+  mem_free(word);
+  if(matched > EXPAND_TERMS){
+    fprintf(stderr, "*** %s matches %d words; only %d of them are used\n", term, matched, EXPAND_TERMS);
+    words.n = EXPAND_TERMS;
+  }
+  postings_t* docs = NULL;
+  if(words.n > 0){
+    postings_t** lists = memtag_malloc(MEMTAG_QUERY, words.n * sizeof(postings_t*), "Error allocating memory");
+    for(int w = 0; w < words.n; w++){
+      lists[w] = termindex_postings(qi->index, words.words[w].ordinal);
+    }
+    docs = postings_merge(lists, words.n);
+    memtag_free(lists);
+  }
+  memtag_free(words.words);
+  return docs;
+}
+
+
+
+/* ****************** expand_helper ********************** */
+/*
+ * Helper function for expandpostings (and termindex_fuzzy) to add a word of the index,
+ * by its ordinal, to the expansion_t given as arg
+ */
+
+static void
+expand_helper(void* arg, const int ordinal, const char* word, const int edits){
+  expansion_t* words = arg;
+  if(words->n == words->cap){
+    words->cap = words->cap == 0 ? 16 : 2 * words->cap;
+    words->words = memtag_realloc(MEMTAG_QUERY, words->words, words->cap * sizeof(expandword_t), "Error allocating memory");
+  }
+  words->words[words->n].ordinal = ordinal;
+  words->words[words->n].edits = edits;
+  words->n++;
+}
+
+
+
+/* ****************** expandword_cmp ********************** */
+/*
+ * Helper function for qsort to order the words of a fuzzy term by their edits, fewest first,
+ * then by their ordinal
+ */
+
+static int
+expandword_cmp(const void* a, const void* b){
+  const expandword_t* wa = a;
+  const expandword_t* wb = b;
+  if(wa->edits != wb->edits){
+    return wa->edits - wb->edits;
+  }
+  return wa->ordinal - wb->ordinal;
+}
+
+
+
+/* ****************** pageplan ********************** */
+/*
+ * returns the documents with every one of the n terms of an and sequence, or NULL if there
+ * are none (*owned is true if the postings were made for the query, so the caller must delete them)
+ * plans the sequence before intersecting anything: the postings of every word are found
+ * first, so a word in no document ends it before any phrase is worked out from the positional
+ * index (or the words of a prefix or fuzzy term merged), and the terms are then intersected from the
+ * fewest postings up, so each result is no larger than the rarest term (the smaller count is kept, so the order does not change it);
+ * the intersecting stops as soon as no document is left
+ */
+
+static postings_t*
+pageplan(queryindex_t* qi, andterm_t* terms, const int n, bool* owned){
+  *owned = false;
+  bool missing = n == 0;
+  for(int t = 0; t < n; t++){
+    terms[t].docs = NULL;
+    terms[t].owned = false;
+  }
+  for(int pass = 0; pass < 2 && !missing; pass++){ // the words, then the phrases, prefix and fuzzy terms
+    for(int t = 0; t < n && !missing; t++){
+      if((terms[t].term[0] == '"' || termexpands(terms[t].term)) == (pass == 1)){
+        terms[t].docs = termpostings(qi, terms[t].term, &terms[t].owned);
+        missing = terms[t].docs == NULL;
+      }
+    }
+  }
+  postings_t* docs = NULL;
+  if(!missing){
+    qsort(terms, n, sizeof(andterm_t), andterm_cmp); // rarest first
+    docs = terms[0].docs;
+    *owned = terms[0].owned;
+    for(int t = 1; t < n && postings_size(docs) > 0; t++){
+      docs = pageand(docs, *owned, terms[t].docs, terms[t].owned);
+      *owned = true;
+      terms[t].owned = false; // pageand took it
+    }
+  }
+  for(int t = missing ? 0 : 1; t < n; t++){ // the postings made for the query that were not used
+    if(terms[t].owned){
+      postings_delete(terms[t].docs);
+    }
+  }
+  return docs;
+}
+
+
+
+/* ****************** andterm_cmp ********************** */
+/*
+ * Helper function for qsort to order the terms of an and sequence by increasing number of postings
+ */
+
+static int
+andterm_cmp(const void* a, const void* b){
+  return postings_size(((const andterm_t*)a)->docs) - postings_size(((const andterm_t*)b)->docs);
+}
+
+
+
 /* ****************** pageor ********************** */
 /*
- * creates a copy to modify ctrsA such that it includes keys that are in both ctrsA and ctrsB
- * and if the key is in both counters, the count is the sum of the two counts
- * returns the modified counters
+ * returns new postings of the documents in total or docsA (either may be NULL, for none),
+ * and if the document is in both, the count is the sum of the two counts;
+ * the two are merged in one pass (postings_or)
  * NOTE:
- *      This method deletes ctrsA! The user is meant replace ctrsA with the returned counters.
+ *      This method deletes total, and docsA if ownedA! The user is meant replace total with the returned postings.
  */
 
-static counters_t*
-pageor(counters_t* ctrsA, counters_t* ctrsB){
-  if(ctrsA != NULL && ctrsB != NULL){
-    counters_t* newCtrs = mem_assert(counters_new(), "Error allocating memory");
-    counters_iterate(ctrsA, newCtrs, counters_copy_helper); // copy ctrsA into new
-    counters_delete(ctrsA);
-    counters_iterate(ctrsB, newCtrs, counters_or_helper); // copy ctrsB into new combining count when overlapping
-    return newCtrs;
+static postings_t*
+pageor(postings_t* total, postings_t* docsA, const bool ownedA){
+  postings_t* merged = postings_or(total, docsA);
+  postings_delete(total);
+  if(ownedA){
+    postings_delete(docsA);
   }
-  return NULL;
+  return merged;
 }
 
 
 
 /* ****************** pageand ********************** */
 /*
- * creates a new counters to return that is the interesction of ctrsA and ctrsB
- * and the count of the keys that are added is the minimum of the two counts
+ * returns new postings of the documents in both docsA and docsB (either may be NULL, for none),
+ * and the count of the documents that are added is the minimum of the two counts;
+ * each document of the shorter is found in the longer by galloping (postings_and)
  * NOTE:
- *      This method deletes ctrsA! The user is meant replace ctrsA with the returned counters.
+ *      This method deletes docsA if ownedA, and docsB if ownedB! The user is meant replace docsA with the returned postings.
  */
 
-static counters_t*
-pageand(counters_t* ctrsA, counters_t* ctrsB, bool hasWord){
-  if(ctrsA != NULL && ctrsB != NULL){
-    counters_t* newCtrs = mem_assert(counters_new(), "Error allocating memory");
-    counterspair_t* pair = mem_assert(counterspair_new(ctrsA, newCtrs), "Error allocating memory");
-    counters_iterate(ctrsB, pair, counters_and_helper);
-    if(!hasWord){
-      counters_delete(ctrsA);
-    }
-    mem_free(pair);
-    return newCtrs;
+static postings_t*
+pageand(postings_t* docsA, const bool ownedA, postings_t* docsB, const bool ownedB){
+  postings_t* both = postings_and(docsA, docsB);
+  if(ownedA){
+    postings_delete(docsA);
   }
-  return NULL;
+  if(ownedB){
+    postings_delete(docsB);
+  }
+  return both;
 }
 
 
 
 /* ****************** pagerankprint ********************** */
 /*
- * interates through the given counters to find the docID with the highest score
- * and prints to stdout the score of the docID, the DocID, and the URL of the docID 
- * it "removes" that key from the counters by setting the score to 0 then it repeats until the counters is "empty" 
+ * copies the documents of the given postings into an array of docscores, ranks them from
+ * highest to lowest score (lowest docID first on ties), and prints to stdout the score,
+ * the DocID, and the URL of each, only the first topk of them unless topk is 0
  * NOTE:
- *      This deletes the given counters.
+ *      This deletes the given postings.
  */
 
 static void
-pagerankprint(counters_t* ctrs, const char* pageDirectory){
-  bool empty = true;
-  intpair_t* maxPair = mem_assert(intpair_new(0,0), "Error allocating memory"); // docID as 0 so can enter while loop
-  while(maxPair->docID >= 0){  // while the docID is an actual docID number
-    maxPair->docID = -1;   // make sure if all docIDs have 0 score, loop breaks
-    maxPair->score = 0;
-    counters_iterate(ctrs, maxPair, counters_maxscore_helper); // find the docID with max score
-    if(maxPair->docID >= 0){
-      empty = false; // so does not print no documents match
-      char* path = mem_malloc_assert(strlen(pageDirectory) + sizeof(maxPair->docID) + 1, "Error allocating memory");
-      sprintf(path, "%s/%d", pageDirectory, maxPair->docID);
-      FILE* fp = mem_assert(fopen(path, "r"), "Error allocating memory");
-      char* url = mem_assert(file_readLine(fp), "Error allocating memory"); // grab url from file
-      fclose(fp);
-      printf("Score:%d  DocID:%d  URL:%s\n", maxPair->score, maxPair->docID, url); // print info
-      mem_free(path);
+pagerankprint(postings_t* docs, const int topk, const char* pageDirectory, urlmap_t* urls, FILE* fp){
+  int size = postings_size(docs);
+  docscore_t* ranked = memtag_malloc(MEMTAG_QUERY, (size + 1) * sizeof(docscore_t), "Error allocating memory");
+  docscore_t* next = ranked;
+  postings_iterate(docs, &next, pagerank_helper);
+  postings_delete(docs);
+  int n = rankselect(ranked, size, topk);
+  for(int i = 0; i < n; i++){
+    char* url = pageurl(pageDirectory, urls, ranked[i].docID); // grab url from the URL table or file
+    fprintf(fp, "Score:%d  DocID:%d%s%s\n", (int)ranked[i].score, ranked[i].docID,
+            url == NULL ? "" : "  URL:", url == NULL ? "" : url); // print info (without a URL if there is none)
+    if(url != NULL){
       mem_free(url);
-      if(!counters_set(ctrs, maxPair->docID, 0)){ // make sure this docID is not used again
-        mem_assert(NULL, "Error allocating memory");
-      }
     }
   }
-  mem_free(maxPair);
-  if(empty){
-    printf("No documents match\n");
+  if(n == 0){
+    fprintf(fp, "No documents match\n");
   }
-  counters_delete(ctrs); // delete the virtually empty counters
+  memtag_free(ranked);
 }
 
 
 
-/* Helper function to use counters_iterate to create a new counters in the pair the intersection of
- * the the other counters in the pair and the one being iterated through
- * and setting the count to the minimum of the two counts if they both have the key
+/* ****************** pagerank_helper ********************** */
+/*
+ * Helper function for postings_iterate to copy a document and its count into the
+ * next docscore of the array being filled (arg points to it)
  */
-static void 
-counters_and_helper(void* arg, const int key, int count)
-{
-  counterspair_t* pair = arg;  
-  // find the same key in ctrsA
-  int countA = counters_get(pair->ctrsA, key);
-  if (countA == 0) {
-    // not found: do nothing
-  } else {
-    // add key to orCtrs with the minimus of the counts
-    if(counters_get(pair->ctrsA, key) <= count){
-      if(!counters_set(pair->orCtrs, key, counters_get(pair->ctrsA, key))){
-        mem_assert(NULL, "Error allocating memory");
-      }
-    } else{
-      if(!counters_set(pair->orCtrs, key, count)){
-        mem_assert(NULL, "Error allocating memory");
-      }
+
+static void
+pagerank_helper(void* arg, const int docID, const int count){
+  docscore_t** next = arg;
+  (*next)->docID = docID;
+  (*next)->score = count;
+  (*next)++;
+}
+
+
+
+/* ****************** bm25rankprint ********************** */
+/*
+ * prints the documents with a positive score from highest to lowest score (lowest docID first on ties),
+ * only the first topk of them unless topk is 0
+ * NOTE:
+ *      This frees the given scores.
+ */
+
+static void
+bm25rankprint(double* scores, const int maxDoc, const int topk, const char* pageDirectory, urlmap_t* urls, FILE* fp){
+  docscore_t* ranked = memtag_malloc(MEMTAG_QUERY, (maxDoc + 1) * sizeof(docscore_t), "Error allocating memory");
+  int n = 0;
+  for(int docID = 1; docID <= maxDoc; docID++){
+    if(scores[docID] > 0){
+      ranked[n].docID = docID;
+      ranked[n].score = scores[docID];
+      n++;
     }
   }
+  memtag_free(scores);
+  docscoreprint(ranked, n, topk, pageDirectory, urls, fp);
 }
 
 
-/* Helper function to use counters_iterate to add the keys from one counters to another
- * and summing their counts if they both have the key
+
+/* ****************** docscoreprint ********************** */
+/*
+ * ranks the scored documents from highest to lowest score (lowest docID first on ties)
+ * with rankselect and prints them, only the first topk of them unless topk is 0
+ * NOTE:
+ *      This frees ranked.
  */
-static void 
-counters_or_helper(void* arg, const int key, int count)
-{
-  counters_t* ctrsA = arg;  
-  // find the same key in ctrsA
-  int countA = counters_get(ctrsA, key);
-  if (countA == 0) {
-    // not found: insert it
-    if(!counters_set(ctrsA, key, count)){
-      mem_assert(NULL, "Error allocating memory");
-    }
-  } else {
-    // set count of key = to the sum of the two counts
-    countA += count;
-    if(!counters_set(ctrsA, key, countA)){
-      mem_assert(NULL, "Error allocating memory");
+
+static void
+docscoreprint(docscore_t* ranked, const int n, const int topk, const char* pageDirectory, urlmap_t* urls, FILE* fp){
+  int shown = rankselect(ranked, n, topk);
+  for(int i = 0; i < shown; i++){
+    char* url = pageurl(pageDirectory, urls, ranked[i].docID);
+    fprintf(fp, "Score:%.3f  DocID:%d%s%s\n", ranked[i].score, ranked[i].docID,
+            url == NULL ? "" : "  URL:", url == NULL ? "" : url);
+    if(url != NULL){
+      mem_free(url);
     }
   }
+  if(n == 0){
+    fprintf(fp, "No documents match\n");
+  }
+  memtag_free(ranked);
 }
 
 
-/* Helper function to use counters_iterate to copy a counters
+
+/* ****************** rankselect ********************** */
+/*
+ * Puts the best topk of the n documents (all of them if topk is 0), ranked by docscore_cmp,
+ * at the front of ranked, and returns how many that is; when there are more than topk, they
+ * are picked with a heap of topk documents (topk_push), which costs n log topk instead of
+ * n log n for sorting them all, and only those are sorted
  */
-static void 
-counters_copy_helper(void* arg, const int key, int count)
-{
-  counters_t* ctrsA = arg;  
-  if(!counters_set(ctrsA, key, count)){ // add key/count to the set (for a copy)
-      mem_assert(NULL, "Error allocating memory");
-  }  
+
+static int
+rankselect(docscore_t* ranked, const int n, const int topk){
+  if(topk == 0 || n <= topk){
+    qsort(ranked, n, sizeof(docscore_t), docscore_cmp);
+    return n;
+  }
+  int kept = 0;
+  for(int i = 0; i < n; i++){ // the heap is ranked[0 .. kept), and kept <= i, so ranked[i] is not in it yet
+    topk_push(ranked, &kept, topk, ranked[i]);
+  }
+  qsort(ranked, kept, sizeof(docscore_t), docscore_cmp);
+  return kept;
 }
 
 
 
-/* ****************** counters_maxscore_helper ********************** */
+/* ****************** topk_push ********************** */
 /*
- * Helper function for counters_iterate to find the docID of the max score
+ * Helper function to offer a document to a heap of at most topk docscores whose
+ * root, heap[0], is the one that ranks last (by docscore_cmp); once the heap is
+ * full, doc replaces the root only if it ranks before it
  */
+
 static void
-counters_maxscore_helper(void* arg, const int key, const int count)
-{
-  intpair_t* pair = arg;
-  if(pair->score < count){
-    pair->docID = key;
-    pair->score = count;
+topk_push(docscore_t* heap, int* n, const int topk, docscore_t doc){
+  int i;
+  if(*n < topk){ // room: sift up from the end
+    i = (*n)++;
+    while(i > 0 && docscore_cmp(&doc, &heap[(i - 1) / 2]) > 0){
+      heap[i] = heap[(i - 1) / 2];
+      i = (i - 1) / 2;
+    }
+    heap[i] = doc;
+    return;
+  }
+  if(docscore_cmp(&doc, &heap[0]) >= 0){ // ranks no better than the worst kept
+    return;
+  }
+  i = 0; // sift down from the root
+  while(2 * i + 1 < *n){
+    int child = 2 * i + 1;
+    if(child + 1 < *n && docscore_cmp(&heap[child + 1], &heap[child]) > 0){
+      child++;
+    }
+    if(docscore_cmp(&heap[child], &doc) <= 0){
+      break;
+    }
+    heap[i] = heap[child];
+    i = child;
+  }
+  heap[i] = doc;
+}
+
+
+
+/* ****************** docscore_cmp ********************** */
+/*
+ * Helper function for qsort to order docscores by decreasing score, then increasing docID
+ */
+
+static int
+docscore_cmp(const void* a, const void* b){
+  const docscore_t* docA = a;
+  const docscore_t* docB = b;
+  if(docA->score != docB->score){
+    return docA->score < docB->score ? 1 : -1;
   }
+  return docA->docID - docB->docID;
 }
 
 
+
+/* ****************** pageurl ********************** */
+/*
+ * returns the URL of docID from the URL table the indexer wrote beside the index, or, for an
+ * index without one (or a docID it does not have), the first line of its file in pageDirectory;
+ * caller must free it
+ * returns NULL, after an error on stderr, if the page file cannot be read, so the result is
+ * printed without a URL rather than ending the querier (or the server, with -s)
+ */
+
+static char*
+pageurl(const char* pageDirectory, urlmap_t* urls, const int docID){
+  char* url = urls_get(urls, docID, NULL, NULL);
+  if(url != NULL){
+    return url;
+  }
+  char* path = mem_malloc_assert(strlen(pageDirectory) + 12, "Error allocating memory"); // room for '/', the digits of docID, and '\0'
+  sprintf(path, "%s/%d", pageDirectory, docID);
+  FILE* fp = fopen(path, "r");
+  if(fp != NULL){
+    url = file_readLine(fp); // grab url from file
+    fclose(fp);
+  }
+  if(url == NULL){
+    fprintf(stderr, "*** no URL for docID %d: could not read the page file %s\n", docID, path);
+  }
+  mem_free(path);
+  return url;
+}
+
+
+
 /* ****************** normalize_line ********************** */
 /*
  * Helper function to normalize all the words from a line
  * also checks if the line starts or ends with "and" or "or" or has two of those back to back, if bad, return NULL
+ * a phrase in double quotes is kept in quotes, and 'and' and 'or' inside it are words, not operators;
+ * a quote that is not closed (or a phrase inside a phrase) is bad too
+ * "Bad Query" (or a blank line, for an empty query) is printed to fp
  * NOTE:
  *      deletes the given string
  */
 static char*
-normalize_line(char* line)
+normalize_line(char* line, FILE* fp)
 {
   if (line == NULL){
     return NULL;
@@ -386,76 +1505,75 @@ normalize_line(char* line)
   }
   char* normLine = mem_malloc_assert((strlen(line)+1)*sizeof(char), "Error allocating memory");
   strcpy(normLine, "");
-  char* word = strtok(line, " ");
-  if(word == NULL){
-    printf("\n"); // empty query, do nothing
-    return NULL;
-  }
-  for(int i = 0; i<strlen(word); i++){ // loops through each character in a word to make sure it is just letters
-    if(isalpha(word[i]) == 0){ // if not a letter, bad input
-      mem_free(word);
-      mem_free(normLine);
-      printf("Bad Query\n");
-      return NULL;
+  bool bad = false;
+  bool empty = true;      // no words yet
+  bool inPhrase = false;  // between the quotes of a phrase
+  bool lastOp = true;     // the last word was "and" or "or" (or there was none), so no operator can come next
+  char* save = NULL;
+  for(char* word = strtok_r(line, " ", &save); word != NULL && !bad; word = strtok_r(NULL, " ", &save)){
+    bool opens = word[0] == '"';
+    if(opens){
+      word++;
     }
-  }
-  word = word_normalize(word);
-  char* last = mem_malloc_assert((strlen(word)+1)*sizeof(char), "Error allocating memory"); // last word in the string
-  strcpy(last, "");
-  strcpy(last, word);
-  if(strcmp(word, "or") == 0 || strcmp(word, "and") == 0){ // if the line starts with and or or, bad query
-    mem_free(line);
-    mem_free(normLine);
-    mem_free(word);
-    mem_free(last);
-    printf("Bad Query\n");
-    return NULL;
-  }
-  strcat(normLine, word);
-  mem_free(word);
-  while((word = strtok(NULL, " ")) != NULL){ // continue to take the next word until no more words
-    for(int i = 0; i<strlen(word); i++){ // loops through each character in a word to make sure it is just letters
-      if(isalpha(word[i]) == 0){ // if not a letter, bad input
-        mem_free(word);
-        mem_free(normLine);
-        printf("Bad Query\n");
-        return NULL;
+    size_t len = strlen(word);
+    bool closes = len > 0 && word[len-1] == '"';
+    if(closes){
+      word[--len] = '\0';
+    }
+    if(len == 0 || (opens && inPhrase) || (closes && !inPhrase && !opens)){ // stray quote
+      bad = true;
+      break;
+    }
+    const char* expand = NULL; // word* or word~1 or word~2, outside of phrases: kept after the word is normalized
+    if(!inPhrase && !opens && len > 1 && word[len-1] == '*'){
+      expand = "*";
+      word[--len] = '\0';
+    } else if(!inPhrase && !opens && len > 2 && word[len-2] == '~' && (word[len-1] == '1' || word[len-1] == '2')){
+      expand = word[len-1] == '1' ? "~1" : "~2";
+      len -= 2;
+      word[len] = '\0';
+    }
+    if(!lexer_isWord(word)){ // just letters (ASCII or UTF-8), as the indexer finds words, or bad input
+      bad = true;
+      break;
+    }
+    char* norm = word_normalize(word);
+    bool isOp = !inPhrase && !opens && expand == NULL && (strcmp(norm, "or") == 0 || strcmp(norm, "and") == 0);
+    if(isOp && lastOp){ // the line starts with and or or, or has two in a row
+      bad = true;
+    } else{
+      if(!empty){
+        strcat(normLine, " ");
       }
+      if(opens){
+        strcat(normLine, "\"");
+      }
+      strcat(normLine, norm);
+      if(expand != NULL){
+        strcat(normLine, expand);
+      }
+      if(closes){
+        strcat(normLine, "\"");
+      }
+      inPhrase = (inPhrase || opens) && !closes;
+      lastOp = isOp;
+      empty = false;
     }
-    word = word_normalize(word);
-    if((strcmp(word, "or") == 0 || strcmp(word, "and") == 0) && (strcmp(last, "or") == 0 || strcmp(last, "and") == 0)){ // if the line has two and or ors in a row, bad query
-      mem_free(normLine);
-      mem_free(line);
-      mem_free(last);
-      mem_free(word);
-      printf("Bad Query\n");
-      return NULL;
-    }
-    strcat(normLine, " ");
-    strcat(normLine, word);
-    last = mem_assert(realloc(last, (strlen(word)+1)*sizeof(char)), "Error allocating memory");
-    strcpy(last, "");
-    strcpy(last, word);
-    mem_free(word);
+    memtag_free(norm);
   }
   mem_free(line);
-  if(strcmp(last, "or") == 0 || strcmp(last, "and") == 0){ // if the line ends with and or or, bad query
+  if(!bad && !empty && (inPhrase || lastOp)){ // the line ends with and or or, or in an open phrase
+    bad = true;
+  }
+  if(bad){
     mem_free(normLine);
-    mem_free(last);
-    printf("Bad Query\n");
+    fprintf(fp, "Bad Query\n");
+    return NULL;
+  }
+  if(empty){
+    mem_free(normLine);
+    fprintf(fp, "\n"); // empty query, do nothing
     return NULL;
   }
-  mem_free(last);
   return normLine;
 }
-
-/* ****************** counters_delete_helper ********************** */
-/*
- * Helper function so I can use counters_delete on the items in the hashtable by casting the void* to counters_t*
- */
-
-static void
-counters_delete_helper(void* item){
-  counters_t* ctrs = item;
-  counters_delete(ctrs);
-}
\ No newline at end of file
@@ -0,0 +1,134 @@
+/*
+ * queryclient.c - a C script to send queries to a querier running as a server (querier -s)
+ * it reads queries from standard input until the EOF, sends each to the server over its
+ * Unix domain socket, and prints the answer, so its output is that of the querier
+ * without the prompts (as for querier -q)
+ * the server answers each query with the number of bytes of the answer on a line,
+ * then the answer
+ *
+ *
+ * Usage: ./queryclient socketPath
+ * where socketPath is the socket given to querier -s
+ * if the server is not listening yet, the client tries again for a few seconds
+ *
+ * Exit with 0 means succesful
+ * Exit with 1 means wrong number of inputs
+ * Exit with 2 means the server could not be reached
+ * Exit with 3 means the server went away in the middle of an answer
+ *
+ * Cooper LaPorte, March 2023
+ */
+
+#define _POSIX_C_SOURCE 200809L   // fdopen, nanosleep
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "mem.h"
+#include "file.h"
+
+
+/**************** file-local constants ****************/
+static const int CONNECT_TRIES = 50;        // tries to reach the server, 100ms apart
+
+
+static int clientConnect(const char* socketPath);
+static void clientAsk(FILE* server, const int fd, char* line);
+
+/* ***************** main ********************** */
+
+int
+main(const int argc, char* argv[])
+{
+if (argc == 2){
+    int fd = clientConnect(argv[1]);
+    FILE* server = mem_assert(fdopen(fd, "r"), "Error allocating memory");
+    char* line;
+    while((line = file_readLine(stdin)) != NULL){
+      clientAsk(server, fd, line);
+    }
+    fclose(server);   // closes fd
+  } else{
+    // too few or many arguments
+    fprintf(stderr,"*** need to pass exactly one argument\n");
+    exit(1);
+  }
+exit(0);
+}
+
+
+
+/* ****************** clientConnect ********************** */
+/*
+ * Returns a socket connected to the server at socketPath, trying again for a few seconds
+ * while there is no server there (it may be starting); exits if it cannot be reached
+ */
+
+static int
+clientConnect(const char* socketPath){
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if(strlen(socketPath) >= sizeof(addr.sun_path)){
+    fprintf(stderr,"*** the socket pathname is too long: %s\n", socketPath);
+    exit(2);
+  }
+  strcpy(addr.sun_path, socketPath);
+  for(int try = 0; try < CONNECT_TRIES; try++){
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd >= 0 && connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0){
+      return fd;
+    }
+    if(fd >= 0){
+      close(fd);
+    }
+    struct timespec pause = { 0, 100000000 };
+    nanosleep(&pause, NULL);
+  }
+  fprintf(stderr,"*** could not reach a querier at %s\n", socketPath);
+  exit(2);
+}
+
+
+
+/* ****************** clientAsk ********************** */
+/*
+ * Send the query line to the server (on fd), and print its answer (read from server),
+ * after a blank line as the querier prints it after its prompt; deletes the line
+ */
+
+static void
+clientAsk(FILE* server, const int fd, char* line){
+  size_t len = strlen(line);
+  line[len] = '\n';   // send the line with its newline in place of the '\0'
+  const char* p = line;
+  size_t left = len + 1;
+  while(left > 0){
+    ssize_t sent = write(fd, p, left);
+    if(sent <= 0){
+      fprintf(stderr,"*** the querier went away\n");
+      exit(3);
+    }
+    p += sent;
+    left -= sent;
+  }
+  mem_free(line);
+  size_t size;
+  if(fscanf(server, "%zu", &size) != 1 || fgetc(server) != '\n'){
+    fprintf(stderr,"*** the querier went away\n");
+    exit(3);
+  }
+  char* answer = mem_malloc_assert(size + 1, "Error allocating memory");
+  if(fread(answer, 1, size, server) != size){
+    fprintf(stderr,"*** the querier went away\n");
+    exit(3);
+  }
+  printf("\n");
+  fwrite(answer, 1, size, stdout);
+  fflush(stdout);
+  mem_free(answer);
+}
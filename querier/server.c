@@ -0,0 +1,402 @@
+/*
+ * server.c - CS50 'server' module
+ *
+ * see server.h for more information.
+ *
+ * Cooper LaPorte, March 2023
+ */
+
+#define _POSIX_C_SOURCE 200809L   // open_memstream, sysconf, sigaction, MSG_NOSIGNAL
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "mem.h"
+#include "memtag.h"
+#include "server.h"
+
+
+/**************** file-local constants ****************/
+static const size_t SERVER_LINE_MAX = 65536; // longest query a client may send, and most bytes of queries kept waiting
+static const int SERVER_READ = 4096;        // bytes read from a client at a time
+
+/**************** file-local global variables ****************/
+static volatile sig_atomic_t serverStop = 0; // SIGINT or SIGTERM asked the server to stop
+static int serverWake = -1;                  // write end of the pipe that wakes the server's poll
+
+
+/**************** local types ****************/
+/* client: a connection to the server */
+typedef struct client {
+  int fd;
+  char* buf;                // bytes read from it and not yet taken as queries
+  size_t len;
+  size_t cap;
+  bool busy;                // one of its queries is being answered
+  bool closed;              // it has sent all it will
+  char* query;              // the query being answered
+  char* out;                // the framed answer being sent to it, or NULL
+  size_t outLen;
+  size_t outSent;
+  struct client* next;      // in the queue of queries to answer, or of queries answered
+} client_t;
+
+/* server: the queues the server shares with its workers */
+typedef struct server {
+  void* arg;
+  void (*queryfunc)(void* arg, char* line, FILE* fp);
+  client_t* todo;           // clients with a query to answer, oldest first
+  client_t* todoLast;
+  client_t* done;           // clients whose query was answered
+  bool stop;                // the workers are to stop
+  pthread_mutex_t lock;     // guards all of the above but arg and queryfunc
+  pthread_cond_t work;      // a client was put in todo, or stop was set
+} server_t;
+
+
+static void server_signal(int sig);
+static void server_wake(void);
+static bool server_read(client_t* c);
+static void server_next(server_t* s, client_t* c);
+static void server_flush(server_t* s, client_t* c);
+static void* server_run(void* arg);
+
+
+/**************** server_listen ****************/
+/* see server.h for description */
+
+int
+server_listen(const char* socketPath){
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, socketPath); // the caller made sure it fits
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(socketPath); // the caller made sure it is a socket, if anything
+  if(listener < 0 || bind(listener, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, SOMAXCONN) != 0){
+    fprintf(stderr,"*** could not listen on the socket %s\n", socketPath);
+    exit(2);
+  }
+  return listener;
+}
+
+
+/**************** server_serve ****************/
+/* see server.h for description
+ *
+ * this thread polls the listener and the clients; a line from a client is put in the
+ * queue todo, the workers (server_run) answer it and put the client in the queue done
+ * with the framed answer, and this thread sends the answer and then takes the next line
+ * of the client, if it sent one, so the answers of a client go back in order; while an
+ * answer is waiting, the client is still read from, up to SERVER_LINE_MAX bytes of queries
+ *
+ * the workers and the signal handler wake the poll through a pipe; both ends of it do not
+ * block, so a full pipe (which will wake the poll anyway) never holds up a worker or the
+ * handler, and the poll drains all of it before it takes the queue done
+ */
+
+void
+server_serve(const int listener, int threads, void* arg,
+             void (*queryfunc)(void* arg, char* line, FILE* fp)){
+  if(threads <= 0){
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 0 ? (int)cpus : 1;
+  }
+  int wake[2];
+  mem_assert(pipe(wake) == 0 ? wake : NULL, "Error making a pipe");
+  fcntl(wake[0], F_SETFL, fcntl(wake[0], F_GETFL) | O_NONBLOCK);
+  fcntl(wake[1], F_SETFL, fcntl(wake[1], F_GETFL) | O_NONBLOCK);
+  serverWake = wake[1];
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = server_signal;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  server_t s = { arg, queryfunc, NULL, NULL, NULL, false };
+  pthread_mutex_init(&s.lock, NULL);
+  pthread_cond_init(&s.work, NULL);
+  pthread_t* workers = mem_malloc_assert(threads * sizeof(pthread_t), "Error allocating memory");
+  int started = 0;
+  for(int t = 0; t < threads; t++){
+    if(pthread_create(&workers[started], NULL, server_run, &s) == 0){
+      started++;
+    }
+  }
+  if(started == 0){
+    fprintf(stderr,"*** could not start the threads of the server\n");
+    exit(2);
+  }
+
+  int n = 0;          // clients connected
+  int cap = 16;
+  client_t** clients = memtag_malloc(MEMTAG_QUERY, cap * sizeof(client_t*), "Error allocating memory");
+  struct pollfd* fds = memtag_malloc(MEMTAG_QUERY, (cap + 2) * sizeof(struct pollfd), "Error allocating memory");
+  while(!serverStop){
+    // poll the listener, the pipe, and every client with room for queries or an answer to send
+    int nfds = 2;
+    fds[0] = (struct pollfd){ listener, POLLIN, 0 };
+    fds[1] = (struct pollfd){ wake[0], POLLIN, 0 };
+    for(int c = 0; c < n; c++){
+      short events = (!clients[c]->closed && clients[c]->len < SERVER_LINE_MAX ? POLLIN : 0)
+                     | (!clients[c]->busy && clients[c]->out != NULL ? POLLOUT : 0); // out is the worker's while busy
+      if(events != 0){
+        fds[nfds++] = (struct pollfd){ clients[c]->fd, events, 0 };
+      }
+    }
+    if(poll(fds, nfds, -1) < 0){
+      continue; // interrupted by a signal
+    }
+    if(fds[1].revents & POLLIN){ // queries were answered
+      char drain[64];
+      while(read(wake[0], drain, sizeof(drain)) > 0){
+        // every wake so far is for the answers taken below
+      }
+      pthread_mutex_lock(&s.lock);
+      client_t* done = s.done;
+      s.done = NULL;
+      pthread_mutex_unlock(&s.lock);
+      while(done != NULL){
+        client_t* c = done;
+        done = c->next;
+        c->busy = false;
+        server_flush(&s, c);
+      }
+    }
+    for(int f = 2; f < nfds; f++){
+      for(int c = 0; c < n && fds[f].revents != 0; c++){
+        if(clients[c]->fd == fds[f].fd){
+          if(!clients[c]->busy && clients[c]->out != NULL && (fds[f].revents & (POLLOUT | POLLERR | POLLHUP))){
+            server_flush(&s, clients[c]);
+          }
+          if(!clients[c]->closed && (fds[f].revents & (POLLIN | POLLERR | POLLHUP))){
+            clients[c]->closed = !server_read(clients[c]);
+            server_next(&s, clients[c]);
+          }
+          break;
+        }
+      }
+    }
+    // let go of the clients that sent all they will and have all their answers
+    for(int c = 0; c < n; c++){
+      if(clients[c]->closed && !clients[c]->busy && clients[c]->out == NULL && clients[c]->len == 0){
+        close(clients[c]->fd);
+        memtag_free(clients[c]->buf);
+        memtag_free(clients[c]);
+        clients[c--] = clients[--n];
+      }
+    }
+    if(fds[0].revents & POLLIN){ // a new client
+      int fd = accept(listener, NULL, NULL);
+      if(fd >= 0){
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK); // so a client that does not read cannot hold up the others
+        if(n == cap){
+          cap *= 2;
+          clients = memtag_realloc(MEMTAG_QUERY, clients, cap * sizeof(client_t*), "Error allocating memory");
+          fds = memtag_realloc(MEMTAG_QUERY, fds, (cap + 2) * sizeof(struct pollfd), "Error allocating memory");
+        }
+        client_t* c = memtag_calloc(MEMTAG_QUERY, 1, sizeof(client_t), "Error allocating memory");
+        c->fd = fd;
+        clients[n++] = c;
+      }
+    }
+  }
+
+  pthread_mutex_lock(&s.lock);
+  s.stop = true;
+  pthread_cond_broadcast(&s.work);
+  pthread_mutex_unlock(&s.lock);
+  for(int t = 0; t < started; t++){
+    pthread_join(workers[t], NULL);
+  }
+  for(client_t* c = s.todo; c != NULL; c = c->next){ // queries not answered
+    mem_free(c->query);
+  }
+  for(client_t* c = s.done; c != NULL; c = c->next){ // answers not sent
+    memtag_free(c->out);
+    c->out = NULL;
+  }
+  for(int c = 0; c < n; c++){
+    close(clients[c]->fd);
+    memtag_free(clients[c]->out);
+    memtag_free(clients[c]->buf);
+    memtag_free(clients[c]);
+  }
+  memtag_free(clients);
+  memtag_free(fds);
+  mem_free(workers);
+  serverWake = -1;
+  close(wake[0]);
+  close(wake[1]);
+  pthread_cond_destroy(&s.work);
+  pthread_mutex_destroy(&s.lock);
+}
+
+
+/**************** server_signal ****************/
+/* Handler of SIGINT and SIGTERM: ask the server to stop, and wake its poll */
+
+static void
+server_signal(int sig){
+  serverStop = 1;
+  server_wake();
+}
+
+
+/**************** server_wake ****************/
+/* Wake the server's poll with a byte on its pipe; if the pipe is full, the poll has
+ * wakes waiting already, so the byte is not needed and the write returns at once
+ * (safe in a signal handler)
+ */
+
+static void
+server_wake(void){
+  if(serverWake >= 0){
+    ssize_t ignored = write(serverWake, "w", 1);
+    (void)ignored;
+  }
+}
+
+
+/**************** server_read ****************/
+/* Read what a client sent into its buffer; returns false if it has closed its end
+ * (or failed, or sent a line longer than SERVER_LINE_MAX), so it sends no more
+ */
+
+static bool
+server_read(client_t* c){
+  if(c->len + SERVER_READ > c->cap){
+    c->cap = c->len + SERVER_READ;
+    c->buf = memtag_realloc(MEMTAG_QUERY, c->buf, c->cap, "Error allocating memory");
+  }
+  ssize_t got = read(c->fd, c->buf + c->len, SERVER_READ);
+  if(got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)){
+    return true;  // nothing to read after all
+  }
+  if(got <= 0){
+    return false;
+  }
+  c->len += got;
+  return c->len < SERVER_LINE_MAX || memchr(c->buf, '\n', c->len) != NULL;
+}
+
+
+/**************** server_next ****************/
+/* If a client is not waiting on an answer and has sent a whole line (or the rest of
+ * what it sent before closing), take it out of its buffer and queue it to be answered
+ */
+
+static void
+server_next(server_t* s, client_t* c){
+  if(c->busy || c->out != NULL || c->len == 0){
+    return;
+  }
+  char* end = memchr(c->buf, '\n', c->len);
+  if(end == NULL && !c->closed){
+    return;     // wait for the rest of the line
+  }
+  size_t len = end == NULL ? c->len : (size_t)(end - c->buf);
+  size_t taken = end == NULL ? c->len : len + 1;
+  c->query = mem_malloc_assert(len + 1, "Error allocating memory");
+  memcpy(c->query, c->buf, len);
+  c->query[len] = '\0';
+  memmove(c->buf, c->buf + taken, c->len - taken);
+  c->len -= taken;
+  c->busy = true;
+  c->next = NULL;
+  pthread_mutex_lock(&s->lock);
+  if(s->todo == NULL){
+    s->todo = c;
+  } else{
+    s->todoLast->next = c;
+  }
+  s->todoLast = c;
+  pthread_cond_signal(&s->work);
+  pthread_mutex_unlock(&s->lock);
+}
+
+
+/**************** server_run ****************/
+/* thread function: take the next client from todo, answer its query, frame the answer
+ * by its length, and put the client in done to have it sent, until the server stops;
+ * the poll is woken after the lock is let go, so it does not wait on the lock to drain
+ */
+
+static void*
+server_run(void* arg){
+  server_t* s = arg;
+  pthread_mutex_lock(&s->lock);
+  while(true){
+    while(!s->stop && s->todo == NULL){
+      pthread_cond_wait(&s->work, &s->lock);
+    }
+    if(s->stop){
+      break;
+    }
+    client_t* c = s->todo;
+    s->todo = c->next;
+    pthread_mutex_unlock(&s->lock);
+
+    char* result = NULL;
+    size_t size = 0;
+    FILE* fp = mem_assert(open_memstream(&result, &size), "Error allocating memory");
+    (*s->queryfunc)(s->arg, c->query, fp); // deletes the query
+    c->query = NULL;
+    fclose(fp);
+    char head[32];
+    int headLen = sprintf(head, "%zu\n", size);
+    c->out = memtag_malloc(MEMTAG_QUERY, headLen + size, "Error allocating memory");
+    memcpy(c->out, head, headLen);
+    memcpy(c->out + headLen, result, size);
+    c->outLen = headLen + size;
+    c->outSent = 0;
+    free(result);   // allocated by open_memstream
+
+    pthread_mutex_lock(&s->lock);
+    c->next = s->done;
+    s->done = c;
+    pthread_mutex_unlock(&s->lock);
+    server_wake();
+    pthread_mutex_lock(&s->lock);
+  }
+  pthread_mutex_unlock(&s->lock);
+  return NULL;
+}
+
+
+/**************** server_flush ****************/
+/* Send a client as much of its answer as it takes without blocking; once it is all
+ * sent, take the next query of the client; a client that has gone away is not an
+ * error: what it sent and what it was to get are dropped
+ */
+
+static void
+server_flush(server_t* s, client_t* c){
+  while(c->outSent < c->outLen){
+    ssize_t sent = send(c->fd, c->out + c->outSent, c->outLen - c->outSent, MSG_NOSIGNAL);
+    if(sent < 0 && errno == EINTR){
+      continue;
+    }
+    if(sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)){
+      return;   // the rest when the client has read some
+    }
+    if(sent <= 0){ // gone away
+      c->closed = true;
+      c->len = 0;
+      break;
+    }
+    c->outSent += sent;
+  }
+  memtag_free(c->out);
+  c->out = NULL;
+  server_next(s, c);
+}
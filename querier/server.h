@@ -0,0 +1,57 @@
+/*
+ * server.h - header file for the server (query socket) module
+ *
+ * answers queries sent by clients over a Unix domain socket, on a pool of
+ * threads that share whatever answers them (for the querier, the index, loaded
+ * once).  A client sends queries a line at a time, and gets back the answer to
+ * each, in order, framed as the number of bytes of the answer on a line and
+ * then the answer:
+ *
+ *   length "\n" answer
+ *
+ * One thread polls the socket and the clients and does all the reading and
+ * writing on them without blocking, so a client that sends many queries before
+ * it reads, or reads slowly, holds up nobody else.  The server runs until
+ * SIGINT or SIGTERM.
+ *
+ * Cooper LaPorte March 2023
+ */
+
+#ifndef __SERVER_H
+#define __SERVER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/**************** server_listen ****************/
+/* Return a Unix domain socket listening at socketPath.
+ *
+ * Caller provides:
+ *   a pathname short enough for a socket address, and not an existing file other
+ *   than a socket (a socket left there by a server before is replaced)
+ * We return:
+ *   the listening socket; we exit 2 if it cannot be made
+ * Notes:
+ *   clients can connect (and wait) as soon as it returns, so make it before
+ *   loading what answers the queries; caller must close it and unlink socketPath
+ */
+int server_listen(const char* socketPath);
+
+/**************** server_serve ****************/
+/* Answer the queries of the clients that connect to listener until SIGINT or SIGTERM.
+ *
+ * Caller provides:
+ *   a socket from server_listen, the number of threads (0 for one per CPU), and
+ *   queryfunc, which answers a query line (and deletes it), writing the answer to
+ *   fp, with its arg
+ * We do:
+ *   answer each line a client sends with queryfunc, on the threads, and send the
+ *   client what queryfunc wrote, framed by its length; return once SIGINT or SIGTERM
+ *   is caught, dropping the queries not yet answered and the clients
+ * Notes:
+ *   queryfunc is called from several threads at once; we exit 2 if no thread can be started
+ */
+void server_serve(const int listener, int threads, void* arg,
+                  void (*queryfunc)(void* arg, char* line, FILE* fp));
+
+#endif // __SERVER_H
@@ -41,6 +41,24 @@ chmod -wr ../data/no_reading
 ### Calling with two arguments with indexFilename not being readable
 ./querier  example_output/data/toscrape-depth-1 ../data/no_reading
 
+### Calling with an unknown option
+./querier  -x example_output/data/toscrape-depth-1 example_output/data/toscrape-index-1
+
+### Calling with a number of documents that is not positive, and that is not a number
+./querier  -b -k 0 example_output/data/toscrape-depth-1 example_output/data/toscrape-index-1
+./querier  -k three example_output/data/toscrape-depth-1 example_output/data/toscrape-index-1
+
+### Calling with a cache size that is not positive
+./querier  -c 0 example_output/data/toscrape-depth-1 example_output/data/toscrape-index-1
+
+### Calling with a file of queries that is not readable, and with -t but no file of queries or socket
+./querier  -q ../data/no_queries example_output/data/toscrape-depth-1 example_output/data/toscrape-index-1
+./querier  -t 2 example_output/data/toscrape-depth-1 example_output/data/toscrape-index-1
+
+### Calling with both a file of queries and a socket, and with a socket that is an existing file
+./querier  -q goodtestqueries -s ../data/querier.sock example_output/data/toscrape-depth-1 example_output/data/toscrape-index-1
+./querier  -s goodtestqueries example_output/data/toscrape-depth-1 example_output/data/toscrape-index-1
+
 
 
 # Second, run of valid command-line input and testing invalid queries using fuzztesting.
@@ -57,6 +75,117 @@ chmod -wr ../data/no_reading
 ### (11 - 15 (just 43) should be identical results and 16 - 18 should be the same as each other (13,42,43,70))
 ./querier  example_output/data/toscrape-depth-1 example_output/data/toscrape-index-1 < goodtestqueries
 
+### Calling with -k 3 without -b
+### (Each query should list the first three documents of the run above, in the same order)
+./querier  -k 3 example_output/data/toscrape-depth-1 example_output/data/toscrape-index-1 < goodtestqueries
+
+### Calling with a 1MB query cache
+### (The same output as the run without it; the queries asked again, also with their words in another order, are hits in the line printed at the end)
+./querier  -c 1 example_output/data/toscrape-depth-1 example_output/data/toscrape-index-1 < goodtestqueries
+
+### Calling with the valid queries as a batch on 4 threads
+### (The same output as the first run of them, in the same order, without the prompts)
+./querier  -q goodtestqueries -t 4 example_output/data/toscrape-depth-1 example_output/data/toscrape-index-1
+
+### Running the querier as a server, and asking it the valid queries from two clients at once
+### (Each client prints the same output as the batch above; the server stops on SIGTERM and removes its socket)
+mkdir -p ../data
+./querier  -s ../data/querier.sock example_output/data/toscrape-depth-1 example_output/data/toscrape-index-1 &
+server=$!
+./queryclient ../data/querier.sock < goodtestqueries > ../data/client1.out &
+client=$!
+./queryclient ../data/querier.sock < goodtestqueries > ../data/client2.out
+wait $client
+cat ../data/client1.out
+cmp ../data/client1.out ../data/client2.out && echo "the clients got the same answers"
+kill -TERM $server
+wait $server
+ls ../data/querier.sock
+
+
+
+### Calling with -b to rank the valid queries with BM25
+### (The same documents as above should be listed, scored by BM25; the given index has no document table, so it is worked out from the index)
+./querier  -b example_output/data/toscrape-depth-1 example_output/data/toscrape-index-1 < goodtestqueries
+
+
+
+### Calling with a positional index (indexer -p) and passing a file of phrase queries
+### (Phrases match only words next to each other; the last three have unclosed or nested quotes and should be "Bad Query")
+make -C ../indexer
+../indexer/indexer -p example_output/data/toscrape-depth-1 ../data/toscrape-index-1-pos
+./querier  example_output/data/toscrape-depth-1 ../data/toscrape-index-1-pos < phrasetestqueries
+
+### Calling with an empty page directory on the index with a URL table
+### (The URLs come from ../data/toscrape-index-1-pos.urls, so the results should be the same as the run above)
+mkdir -p ../data/empty_pagedir
+touch ../data/empty_pagedir/.crawler
+./querier  ../data/empty_pagedir ../data/toscrape-index-1-pos < phrasetestqueries
+
+### Calling with the same empty page directory on an index without a URL table
+### (Each result should be printed without its URL, after an error naming its page file, and the querier should go on)
+echo horror | ./querier  ../data/empty_pagedir example_output/data/toscrape-index-1
+
+### Calling with -b -k 3 on the index written with block metadata (indexer writes ../data/toscrape-index-1-pos.blocks)
+### (Each query, with 'or' or without, should list the first three documents of the -b ranking of the same query)
+./querier  -b -k 3 example_output/data/toscrape-depth-1 ../data/toscrape-index-1-pos < goodtestqueries
+
+### Calling with prefix queries (word*), by counts and then with -b -k 3
+### (horror* should match the documents of the second query, with the same counts; the last four are bad queries)
+./querier  example_output/data/toscrape-depth-1 example_output/data/toscrape-index-1 < prefixtestqueries
+./querier  -b -k 3 example_output/data/toscrape-depth-1 ../data/toscrape-index-1-pos < prefixtestqueries
+
+### Calling with fuzzy queries (word~1, word~2), by counts and then with -b -k 3
+### (horor~1 should match the documents of the second query, with the same counts; the last six are bad queries)
+./querier  example_output/data/toscrape-depth-1 example_output/data/toscrape-index-1 < fuzzytestqueries
+./querier  -b -k 3 example_output/data/toscrape-depth-1 ../data/toscrape-index-1-pos < fuzzytestqueries
+
+### Indexing 200 pages whose words are dense enough that their postings are bitmaps
+### (alpha in every page, beta in the even ones, gamma twice in every third, gamut in the pages after those;
+###  delta in pages 1-5 and omega in pages 1, 41, 81, 121 and 161 stay arrays)
+mkdir -p ../data/dense
+touch ../data/dense/.crawler
+for i in $(seq 1 200); do
+  words="alpha"
+  [ $((i % 2)) -eq 0 ] && words="$words beta"
+  [ $((i % 3)) -eq 0 ] && words="$words gamma gamma"
+  [ $((i % 3)) -eq 1 ] && words="$words gamut"
+  [ $i -le 5 ] && words="$words delta"
+  [ $((i % 40)) -eq 1 ] && words="$words omega"
+  printf 'http://cs50tse.cs.dartmouth.edu/tse/dense/%03d.html\n0\n<html><body>%s</body></html>\n' $i "$words" > ../data/dense/$i
+done
+../indexer/indexer ../data/dense ../data/denseindex
+
+### Calling with and, or and prefix queries on bitmaps, and on a bitmap with an array
+### (Each query prints "same" when its documents and counts are the ones the pages were written with:
+###  bitmap with bitmap, then bitmap with array, then a prefix of two bitmaps alone, with a bitmap and with an array)
+for query in "beta and gamma" "beta or gamma" "alpha beta gamma" "gamma and delta" "beta or omega" "gam*" "gam* and beta" "gam* or delta"; do
+  echo "$query" | ./querier ../data/dense ../data/denseindex 2>/dev/null | sed -n 's/^Score:\([0-9]*\)  DocID:\([0-9]*\).*/\2 \1/p' | sort -n > ../data/dense.out
+  seq 1 200 | awk -v q="$query" '{
+    a = 1; b = $1 % 2 == 0; g = $1 % 3 == 0 ? 2 : 0; u = $1 % 3 == 1; d = $1 <= 5; o = $1 % 40 == 1; p = g + u
+    if(q == "beta and gamma") c = b && g ? 1 : 0
+    if(q == "beta or gamma") c = b + g
+    if(q == "alpha beta gamma") c = b && g ? 1 : 0
+    if(q == "gamma and delta") c = g && d ? 1 : 0
+    if(q == "beta or omega") c = b + o
+    if(q == "gam*") c = p
+    if(q == "gam* and beta") c = p && b ? (p < b ? p : b) : 0
+    if(q == "gam* or delta") c = p + d
+    if(c > 0) print $1, c
+  }' > ../data/dense.want
+  cmp -s ../data/dense.out ../data/dense.want && echo "$query: same ($(wc -l < ../data/dense.out) documents)" || echo "$query: DIFFERENT"
+done
+
+### Calling with phrase queries on an index with no positional index
+### (Each phrase of more than one word should print an error and match no documents)
+./querier  example_output/data/toscrape-depth-1 example_output/data/toscrape-index-1 < phrasetestqueries
+
+### Calling with the positional index written above after a byte of it is changed
+### (It no longer matches the checksums the indexer wrote, ../data/toscrape-index-1-pos.crc, so the querier should exit 3 naming pos)
+printf 'X' | dd of=../data/toscrape-index-1-pos.pos bs=1 seek=100 conv=notrunc 2>/dev/null
+./querier  example_output/data/toscrape-depth-1 ../data/toscrape-index-1-pos < goodtestqueries
+echo "exit status $?"
+
 
 
 # Fourth, a run with valid inputs and some valid and invalid queries running valgrind.